@@ -2,8 +2,37 @@
 #include "SpinGenApi/SpinnakerGenApi.h"
 #include <opencv2/opencv.hpp>
 #include <iostream>
+#include <map>
 #include <sstream>
 #include <filesystem>
+#include <ctime>
+#include <iomanip>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "BufferArena.h"
+#include "CameraFeatures.h"
+#include "CameraSnapshot.h"
+#include "FrameGapDetector.h"
+#include "FrameHistory.h"
+#include "FrameMetadata.h"
+#include "FrameRing.h"
+#include "FrameSource.h"
+#include "HotplugMonitor.h"
+#include "ImageSaver.h"
+#include "LatencyHistogram.h"
+#include "Metrics.h"
+#include "Mono8Converter.h"
+#include "PreviewDecimator.h"
+#include "RoiPlanner.h"
+#include "SessionFile.h"
+#include "TriggeredCapture.h"
+#include "VideoRecorder.h"
 
 using namespace Spinnaker;
 using namespace Spinnaker::GenApi;
@@ -27,208 +56,1707 @@ const StreamMode chosenStreamMode = STREAM_MODE_TELEDYNE_GIGE_VISION;
 const StreamMode chosenStreamMode = STREAM_MODE_SOCKET;
 #endif
 
-// This function demonstrates how we can change stream modes.
-int SetStreamMode(CameraPtr pCam)
+// 是否使用自行分配的采集缓冲区（连续、页对齐、锁定内存）代替 SDK 默认缓冲，
+// 以及是否尝试使用大页（需要系统预留大页或相应权限，失败时自动退回普通页）
+const bool useUserBufferArena = false;
+const bool useHugePages = true;
+
+// 采集区域：视场宽高（传感器像素，0 为整个传感器，自动居中）、目标帧率（0 为尽可能快，同时关闭帧率限制）、
+// 允许的最大合并 / 抽取倍数（1 为不使用）和候选像素格式（按偏好排序，空为保持相机当前格式）。
+// 启动时按 DeviceLinkThroughputLimit 预测各组合的帧率并选出最合适的一个，打印预测值和实际的 AcquisitionResultingFrameRate
+const RoiTarget roiTarget = {2048, 2048, 0.0, 1, 1, {}};
+
+// 预览 / 抓拍：相机平时按 previewTarget 预览（整个视场合并 / 抽取到数据率上限以内、低帧率），按空格时停止预览，
+// 切到 roiTarget 的全分辨率配置，以软件触发（captureTriggerSelector / captureTriggerSource）取一帧交给写盘线程，再切回预览。
+// 两套配置启动时规划好，切换时只写变化的节点；打印切换、触发、恢复各阶段和按键到入队的耗时
+const bool previewCapture = false;
+const RoiTarget previewTarget = {0, 0, 10.0, 4, 4, {}, 20e6};
+const char *const captureTriggerSelector = "FrameStart";
+const char *const captureTriggerSource = "Software";
+const uint64_t captureTimeoutMs = 1000;
+
+// 相机 chunk 数据：配置时打开 ChunkModeActive 并启用时间戳、FrameID、曝光、增益和 CRC，抓图线程逐帧解析。
+// 会话录制的每帧曝光 / 增益、存图元数据和指标（相机与主机的帧间隔、CRC 错误、解析耗时）都以此为准
+const bool enableChunkData = true;
+
+// 相机配置快照（CFeatureBag，保存在 cameraSnapshotFolder/<DeviceID>.txt）：
+// CAMERA_SNAPSHOT_SAVE 在配置完成后保存；CAMERA_SNAPSHOT_RESTORE 在配置前恢复（只写入与相机当前值不同的特征），
+// 快照不存在时改为配置完成后保存。快照中的设置先生效，上面的 ROI 等配置再在其基础上调整
+enum CameraSnapshotMode
 {
-	int result = 0;
+	CAMERA_SNAPSHOT_OFF,
+	CAMERA_SNAPSHOT_SAVE,
+	CAMERA_SNAPSHOT_RESTORE
+};
+
+const CameraSnapshotMode cameraSnapshotMode = CAMERA_SNAPSHOT_OFF;
+const char *const cameraSnapshotFolder = "camera_config";
+
+// 帧来源：真实相机，或无需硬件的合成帧 / 回放文件（用于基准测试和回归测试）
+enum FrameSourceKind
+{
+	FRAME_SOURCE_CAMERA,
+	FRAME_SOURCE_SYNTHETIC,
+	FRAME_SOURCE_REPLAY
+};
+
+const FrameSourceKind chosenFrameSource = FRAME_SOURCE_CAMERA;
 
-	// Retrieve Stream nodemap
-	const INodeMap &sNodeMap = pCam->GetTLStreamNodeMap();
+// 相机取帧方式：true 为事件驱动（ImageEventHandler 回调交付图像，无轮询和超时异常），
+// false 为抓图线程轮询 GetNextImage
+const bool useImageEvents = true;
 
+// 合成帧参数（分辨率、位深、Bayer 排列、帧率、噪声）与回放帧率
+const SyntheticConfig syntheticConfig;
+const double replayFrameRate = 30.0;
+
+// 故障注入：按概率注入不完整帧和超时（对所有帧来源生效，0 表示关闭）
+const FaultConfig faultConfig;
+
+// 热插拔：相机掉线（拔线、断电）时取完已到达的帧、放开所有缓冲并释放相机；同一 DeviceID 的相机重新接入后
+// 重新初始化，恢复启动时缓存的配置并继续采集（保存序号、录制和窗口不变），打印从掉线到恢复第一帧的时间。
+// reconnectConfig.simulatedUptime > 0 时按设定间隔模拟掉线和重新接入（合成帧 / 回放同样有效），无需拔线即可测试
+const bool reconnectCameras = true;
+const ReconnectConfig reconnectConfig;
+
+// This function demonstrates how we can change stream modes.
+int SetStreamMode(CameraFeatures &features)
+{
 	// The node "StreamMode" is only available for GEV cameras.
 	// Skip setting stream mode if the node is inaccessible.
-	const CEnumerationPtr ptrStreamMode = sNodeMap.GetNode("StreamMode");
-	if (!IsReadable(ptrStreamMode) || !IsWritable(ptrStreamMode))
+	if (!features.IsReadable(FEATURE_STREAM_MODE) || !features.IsWritable(FEATURE_STREAM_MODE))
+	{
+		return 0;
+	}
+
+	std::string streamMode;
+	switch (chosenStreamMode)
+	{
+	case STREAM_MODE_PGRLWF:
+		streamMode = "LWF";
+		break;
+	case STREAM_MODE_SOCKET:
+		streamMode = "Socket";
+		break;
+	case STREAM_MODE_TELEDYNE_GIGE_VISION:
+	default:
+		streamMode = "TeledyneGigeVision";
+	}
+
+	// The entry values were cached when the features were resolved
+	if (!features.HasEntry(FEATURE_STREAM_MODE, streamMode))
+	{
+		cout << "Stream mode " + streamMode + " not available.  Aborting..." << endl;
+		return -1;
+	}
+	if (!features.Set(FEATURE_STREAM_MODE, streamMode))
+	{
+		return -1;
+	}
+
+	// Print out the current stream mode
+	cout << endl
+		 << "Stream Mode set to " + features.Get(FEATURE_STREAM_MODE) << "..." << endl;
+
+	return 0;
+}
+
+// 帧环中保留的最近帧数，以及显示 / 保存等消费者可同时额外持有的帧数。
+// 两者之和必须小于相机的流缓冲数量（SDK 默认约 10 个），否则相机没有空闲缓冲可写。
+const size_t kRingCapacity = 4;
+const size_t kRingMaxHeld = 4;
+
+// 同时在写盘队列中零拷贝持有帧环帧的上限（显示帧还占一个持有名额），超出时复制后再入队，
+// 否则连续按空格会占满帧环，新帧只能被丢弃
+const size_t kMaxZeroCopySaves = kRingMaxHeld - 1;
+
+// 存图队列长度（超过后按空格会等待写盘线程）
+const size_t kSaveQueueCapacity = 16;
+
+// 存图格式：SAVE_PNG / SAVE_TIFF / SAVE_PGM / SAVE_RAW / SAVE_JPEG，及 PNG 压缩级别和策略、TIFF 压缩方式、JPEG 质量、
+// PNG 编码线程数（0 为全部核心按条带并行压缩，1 为 OpenCV 单线程编码）。
+// 每张图的编码耗时和文件大小会打印出来，可用 acquisition_bench 比较各格式在实际分辨率下的开销
+const SaveFormat saveFormat = {SAVE_PNG, 1, cv::IMWRITE_PNG_STRATEGY_DEFAULT, 1, 95, 0};
+
+// 每张保存的图像另写一个同名 .json 元数据文件（FrameID、相机时间戳、曝光、增益、CRC 等），删除键一并删除
+const bool saveSidecars = true;
+
+// 预览缩小倍数（整数，每 N x N 个像素取平均；4 相当于 0.25 缩放）。
+// Bayer 帧只在偶数倍时直接从原始缓冲缩小，奇数倍时每帧先整帧转换为 Mono8，彩色相机应保持偶数
+const int kPreviewFactor = 4;
+
+// 相机流缓冲策略（TL 流节点 StreamBufferHandlingMode / StreamBufferCountMode / StreamBufferCountManual）
+enum StreamBufferPreset
+{
+	STREAM_BUFFER_SDK_DEFAULT, // 不修改，沿用 SDK 默认值
+	STREAM_BUFFER_LOW_LATENCY, // NewestOnly：总是交付最新一帧，来不及取走的旧帧由 SDK 丢弃
+	STREAM_BUFFER_NO_LOSS,	   // OldestFirst + 深队列：尽量不丢帧，积压时延迟增大
+	STREAM_BUFFER_CUSTOM	   // 使用 streamBufferCustom
+};
+
+struct StreamBufferPolicy
+{
+	const char *handlingMode; // NewestOnly / NewestFirst / OldestFirst / OldestFirstOverwrite
+	int64_t bufferCount;	  // 0 表示 StreamBufferCountMode = Auto
+};
+
+const StreamBufferPreset chosenStreamBufferPreset = STREAM_BUFFER_SDK_DEFAULT;
+const StreamBufferPolicy streamBufferCustom = {"OldestFirst", 32};
+
+// 预设的缓冲数量都要大于帧环和消费者可能同时持有的帧数
+const StreamBufferPolicy kLowLatencyPolicy = {"NewestOnly", static_cast<int64_t>(kRingCapacity + kRingMaxHeld + 2)};
+const StreamBufferPolicy kNoLossPolicy = {"OldestFirst", 100};
+
+// 预触发：按空格时额外保存显示帧之前和之后各 N 帧（0 表示只保存显示的那一帧）。
+// N > 0 时每个相机把最近的原始帧复制到一块不超过 preTriggerBudgetBytes 的历史缓冲中
+const int preTriggerBurst = 0;
+const size_t preTriggerBudgetBytes = size_t(512) << 20;
+
+// 等待显示帧之后的 N 帧到齐的最长时间，超时则只保存已有的帧
+const std::chrono::seconds kBurstTimeout(2);
+
+// 连续录像（按 V 键开始 / 停止）：编码方式、帧率（0 为相机实际帧率）、MJPEG 质量、H.264 码率、
+// 单个文件上限（MB，超过后自动切换新文件）、排队帧数及队列满时的丢帧策略。编码在独立线程进行，不会拖慢抓图
+const VideoConfig videoConfig = {VIDEO_MJPG, 0.0f, 75, 10000000, 2048, 16, VIDEO_DROP_NEWEST};
+
+// 周期性打印吞吐量和流统计的间隔
+const std::chrono::seconds kReportInterval(5);
+
+// 指标导出：每个报告周期打印一行各阶段延迟摘要，并把全部指标写入保存目录下的 metrics.json
+// （METRICS_PROMETHEUS 时为 metrics.prom，可交给 node_exporter 的 textfile 收集器）
+const bool exportMetrics = true;
+const MetricsFormat metricsFormat = METRICS_JSON;
+
+// This function configures the TL stream buffer handling and count according to the chosen preset.
+int SetStreamBufferPolicy(CameraFeatures &features)
+{
+	StreamBufferPolicy policy;
+	switch (chosenStreamBufferPreset)
+	{
+	case STREAM_BUFFER_LOW_LATENCY:
+		policy = kLowLatencyPolicy;
+		break;
+	case STREAM_BUFFER_NO_LOSS:
+		policy = kNoLossPolicy;
+		break;
+	case STREAM_BUFFER_CUSTOM:
+		policy = streamBufferCustom;
+		break;
+	case STREAM_BUFFER_SDK_DEFAULT:
+	default:
+		return 0;
+	}
+
+	int result = 0;
+	if (features.Set(FEATURE_STREAM_BUFFER_HANDLING_MODE, policy.handlingMode))
+	{
+		cout << "Stream buffer handling mode set to " << policy.handlingMode << "..." << endl;
+	}
+	else
+	{
+		cout << "Warning: cannot set StreamBufferHandlingMode to " << policy.handlingMode << endl;
+		result = -1;
+	}
+
+	features.Set(FEATURE_STREAM_BUFFER_COUNT_MODE, policy.bufferCount > 0 ? "Manual" : "Auto");
+
+	if (policy.bufferCount > 0)
+	{
+		if (policy.bufferCount <= static_cast<int64_t>(kRingCapacity + kRingMaxHeld))
+		{
+			cout << "Warning: " << policy.bufferCount << " stream buffers leave no free buffer while the frame ring is full" << endl;
+		}
+
+		// 超出范围时取最近的合法值
+		int64_t count = 0;
+		if (features.Set(FEATURE_STREAM_BUFFER_COUNT_MANUAL, policy.bufferCount, &count))
+		{
+			cout << "Stream buffer count set to " << count << "..." << endl;
+		}
+		else
+		{
+			cout << "Warning: StreamBufferCountManual not writable" << endl;
+			result = -1;
+		}
+	}
+
+	return result;
+}
+
+// TransportLayerStream 中的丢帧 / 缓冲计数，节点不可读时为 -1
+struct StreamCounters
+{
+	int64_t lost = -1;			// StreamLostFrameCount：传输中丢失的帧
+	int64_t dropped = -1;		// StreamDroppedFrameCount：因没有空闲缓冲被丢弃的帧
+	int64_t inputBuffers = -1;	// StreamInputBufferCount：等待相机写入的空闲缓冲
+	int64_t announced = -1;		// StreamAnnouncedBufferCount：已向驱动登记的缓冲总数
+};
+
+StreamCounters ReadStreamCounters(const CameraFeatures &features)
+{
+	StreamCounters counters;
+	counters.lost = features.Get(FEATURE_STREAM_LOST_FRAMES);
+	counters.dropped = features.Get(FEATURE_STREAM_DROPPED_FRAMES);
+	counters.inputBuffers = features.Get(FEATURE_STREAM_INPUT_BUFFERS);
+	counters.announced = features.Get(FEATURE_STREAM_ANNOUNCED_BUFFERS);
+	return counters;
+}
+
+// 自 start 起经过的纳秒数，用于各阶段延迟直方图
+uint64_t ElapsedNs(std::chrono::steady_clock::time_point start)
+{
+	return static_cast<uint64_t>(
+		std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+}
+
+// 抓图线程统计
+struct GrabStats
+{
+	std::atomic<uint64_t> grabbed{0};
+	std::atomic<uint64_t> bytes{0};
+	std::atomic<uint64_t> incomplete{0};
+	std::atomic<uint64_t> timeouts{0};
+	std::atomic<uint64_t> errors{0};
+	std::atomic<uint64_t> chunkErrors{0}; // GetChunkData() 失败的帧
+	std::atomic<uint64_t> crcErrors{0};
+};
+
+// 读取当前曝光时间（us）和增益（dB），不可读时为 -1
+void ReadExposureAndGain(const CameraFeatures &features, double &exposureUs, double &gainDb)
+{
+	exposureUs = features.Get(FEATURE_EXPOSURE_TIME);
+	gainDb = features.Get(FEATURE_GAIN);
+}
+
+// 相机当前的实际帧率（AcquisitionResultingFrameRate），读取不到时返回 0
+float ReadResultingFrameRate(const CameraFeatures &features)
+{
+	return static_cast<float>(features.Get(FEATURE_RESULTING_FRAME_RATE, 0.0));
+}
+
+// 启动各阶段的耗时：每个阶段记录相对启动时刻的开始时间和持续时间，各相机的配置线程可同时记录
+class StartupTrace
+{
+public:
+	StartupTrace() : m_start(std::chrono::steady_clock::now()) {}
+
+	std::chrono::steady_clock::time_point Start() const { return m_start; }
+
+	// 记录从 phaseStart 到现在的一个阶段
+	void Record(const std::string &phase, std::chrono::steady_clock::time_point phaseStart)
+	{
+		const auto now = std::chrono::steady_clock::now();
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_phases.push_back(Phase{phase, std::chrono::duration<double, std::milli>(phaseStart - m_start).count(),
+								 std::chrono::duration<double, std::milli>(now - phaseStart).count()});
+	}
+
+	void Print() const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		std::vector<Phase> phases = m_phases;
+		std::stable_sort(phases.begin(), phases.end(), [](const Phase &a, const Phase &b) { return a.begin < b.begin; });
+
+		// 启动完成以最后一个来源收到第一帧为准（后台打印设备信息不算在内）
+		const std::string firstFrame = "first frame";
+		cout << "Startup phases (ms from start / duration):" << endl;
+		double end = 0.0;
+		for (const Phase &phase : phases)
+		{
+			cout << "  " << std::left << std::setw(40) << phase.name << std::right << std::fixed << std::setprecision(1)
+				 << std::setw(9) << phase.begin << std::setw(9) << phase.duration << endl;
+			if (phase.name.size() >= firstFrame.size() &&
+				phase.name.compare(phase.name.size() - firstFrame.size(), firstFrame.size(), firstFrame) == 0)
+			{
+				end = std::max(end, phase.begin + phase.duration);
+			}
+		}
+		cout << "Startup to first frame: " << end << " ms" << std::defaultfloat << std::setprecision(6) << endl;
+	}
+
+private:
+	struct Phase
+	{
+		std::string name;
+		double begin;
+		double duration;
+	};
+
+	std::chrono::steady_clock::time_point m_start;
+	mutable std::mutex m_mutex;
+	std::vector<Phase> m_phases;
+};
+
+// 参与采集的一个帧来源。id 为相机 DeviceID，多个来源时用作窗口标题和保存子目录
+struct AcquisitionSource
+{
+	FrameSource *source;
+	std::string id;
+	CameraFeatures *features = nullptr; // 相机来源的节点句柄，非空时周期性读取曝光、帧率和流统计
+	StartupTrace *startup = nullptr; // 非空时记录开始采集和第一帧到达的时间
+	unsigned chunkFields = 0;		 // 相机已启用的 chunk 项（ChunkField），非 0 时逐帧解析
+	double frameRate = 0.0;			 // 非相机来源的设定帧率（丢帧检测的期望值），0 为未知
+	TriggeredCapture *capture = nullptr; // 非空时空格键改为全分辨率抓拍
+};
+
+struct SourcePipeline;
+void GrabLoop(SourcePipeline &pipeline);
+
+// 每个帧来源一条独立的流水线：自己的抓图线程、帧环和预览 / 转换状态，
+// 相机之间互不等待，只共享主线程的显示循环和写盘线程池。
+struct SourcePipeline
+{
+	SourcePipeline(const AcquisitionSource &target, const std::string &windowName, const std::string &saveFolder)
+		: source(*target.source), id(target.id), features(target.features), startup(target.startup),
+		  chunkFields(target.chunkFields), frameRate(target.frameRate), capture(target.capture),
+		  logPrefix(target.id.empty() ? "" : "[" + target.id + "] "), window(windowName), folder(saveFolder),
+		  ring(kRingCapacity, kRingMaxHeld, [this](const ImagePtr &image) { source.Release(image); }),
+		  converter(SPINNAKER_COLOR_PROCESSING_ALGORITHM_HQ_LINEAR), decimator(kPreviewFactor)
+	{
+		if (preTriggerBurst > 0)
+		{
+			history.reset(new FrameHistory(preTriggerBudgetBytes));
+		}
+	}
+
+	~SourcePipeline() { StopGrabbing(); }
+
+	void StartGrabbing()
+	{
+		grabbing = true;
+		grabThread = std::thread(GrabLoop, std::ref(*this));
+	}
+
+	void StopGrabbing()
+	{
+		grabbing = false;
+		if (grabThread.joinable())
+		{
+			grabThread.join();
+		}
+	}
+
+	FrameSource &source;
+	std::string id;
+	CameraFeatures *features;
+	StartupTrace *startup;
+	unsigned chunkFields;
+	double frameRate;
+	TriggeredCapture *capture;
+	std::string logPrefix; // 多个来源时为 "[DeviceID] "
+	std::chrono::steady_clock::time_point acquisitionStart; // source.Start() 返回的时间
+	std::string window;
+	std::string folder;
+	FrameRing ring;
+	std::unique_ptr<FrameHistory> history; // 仅在启用预触发时创建
+	SessionWriter recorder;				   // 按 R 键开始 / 停止录制原始会话文件
+	VideoRecorder video;				   // 按 V 键开始 / 停止连续录像
+	std::atomic<double> exposureUs{-1.0};  // 录制时写入每帧元数据，由主线程定期刷新
+	std::atomic<double> gainDb{-1.0};
+	GrabStats stats;
+	FrameGapDetector gaps; // 按 FrameID / 相机时间戳检测从未到达的帧
+	std::atomic<bool> sourceLost{false}; // 来源掉线，显示循环应放开当前显示的帧
+	std::atomic<bool> grabbing{false};
+	std::thread grabThread;
+
+	// 初始化图像处理器（原生 Mono8 时不做转换）
+	Mono8Converter converter;
+	// 预览直接从原始帧整数倍缩小；Mono8 / Bayer 等格式无需先转换整帧
+	PreviewDecimator decimator;
+
+	// 当前显示的帧，按空格时保存的就是它（整帧转换推迟到保存时才做）
+	FrameRef shownFrame;
+	Mono8Frame shown;
+	cv::Mat cvImage;
+	uint64_t shownSeq = FrameRing::kInvalidSeq;
+	uint64_t shownFrames = 0;
+	uint64_t fusedFrames = 0;
+	bool fusedNoted = false; // 已提示过当前格式不能直接缩小
+
+	// 已按空格、正在等待后续帧的预触发保存
+	struct PendingBurst
+	{
+		int groupId;
+		uint64_t centerSeq;
+		std::chrono::steady_clock::time_point deadline;
+	};
+	std::vector<PendingBurst> pendingBursts;
+
+	// 帧到达（相机回调或 GetNextImage 返回）到显示循环取到它的延迟
+	LatencyHistogram consumerLatency;
+	// 各阶段耗时：抓图等待、整帧转换、预览缩小、显示
+	LatencyHistogram grabWait;
+	LatencyHistogram convertLatency;
+	LatencyHistogram resizeLatency;
+	LatencyHistogram displayLatency;
+	// 全分辨率抓拍：按键到抓到的帧进入写盘队列
+	LatencyHistogram captureLatency;
+
+	// chunk 解析耗时，以及相邻两帧的相机时间戳间隔和主机到达间隔（仅抓图线程写入）
+	LatencyHistogram chunkParse;
+	LatencyHistogram cameraInterval;
+	LatencyHistogram hostInterval;
+	uint64_t lastCameraTimestamp = 0;
+	std::chrono::steady_clock::time_point lastHostTime;
+
+	// 上次打印吞吐量时的计数
+	uint64_t reportedFrames = 0;
+	uint64_t reportedBytes = 0;
+	uint64_t reportedVideoFrames = 0;
+	uint64_t reportedMissing = 0;
+	StreamCounters reportedCounters;
+
+	// 录制时刷新写入会话文件的曝光和增益；chunk 中有的项由抓图线程逐帧更新
+	void RefreshCameraSettings()
+	{
+		if (features)
+		{
+			double exposure, gain;
+			ReadExposureAndGain(*features, exposure, gain);
+			if ((chunkFields & CHUNK_EXPOSURE_TIME) == 0)
+			{
+				exposureUs = exposure;
+			}
+			if ((chunkFields & CHUNK_GAIN) == 0)
+			{
+				gainDb = gain;
+			}
+		}
+	}
+};
+
+// 抓图线程中记录一帧的 chunk 数据：更新曝光 / 增益，并统计相机时间戳与主机到达时间各自的帧间隔
+void RecordChunk(SourcePipeline &pipeline, const Frame &frame)
+{
+	if (!frame.chunk.crcOk)
+	{
+		pipeline.stats.crcErrors++;
+	}
+	if (pipeline.chunkFields & CHUNK_EXPOSURE_TIME)
+	{
+		pipeline.exposureUs.store(frame.chunk.exposureUs, std::memory_order_relaxed);
+	}
+	if (pipeline.chunkFields & CHUNK_GAIN)
+	{
+		pipeline.gainDb.store(frame.chunk.gainDb, std::memory_order_relaxed);
+	}
+
+	// 相机重连后时间戳重新计数，不计这一段
+	if ((pipeline.chunkFields & CHUNK_TIMESTAMP) && pipeline.lastCameraTimestamp != 0 &&
+		frame.timestamp > pipeline.lastCameraTimestamp)
+	{
+		pipeline.cameraInterval.Record(frame.timestamp - pipeline.lastCameraTimestamp);
+		pipeline.hostInterval.Record(static_cast<uint64_t>(
+			std::chrono::duration_cast<std::chrono::nanoseconds>(frame.hostTime - pipeline.lastHostTime).count()));
+	}
+	pipeline.lastCameraTimestamp = frame.timestamp;
+	pipeline.lastHostTime = frame.hostTime;
+}
+
+// 抓图线程：只从帧来源取帧并把帧句柄推入帧环，不做转换、显示或保存，
+// 这样预览窗口或存图再慢也不会拖住相机的缓冲队列。
+// 启用预触发或录制时，每帧推入帧环后再复制一份到历史缓冲 / 会话文件的写入块
+// （只占用抓图线程内存复制的时间，磁盘 I/O 在各自的后台线程）。
+void GrabLoop(SourcePipeline &pipeline)
+{
+	FrameSource &source = pipeline.source;
+	FrameRing &ring = pipeline.ring;
+	GrabStats &stats = pipeline.stats;
+
+	while (pipeline.grabbing.load(std::memory_order_relaxed))
+	{
+		// 抓图（50ms 超时）
+		Frame frame;
+		std::string message;
+		const auto waitStart = std::chrono::steady_clock::now();
+		switch (source.Grab(50, frame, message))
+		{
+		case GRAB_OK:
+			pipeline.grabWait.Record(ElapsedNs(waitStart));
+			stats.bytes += frame.image->GetImageSize();
+
+			// 丢帧检测统一用图像头的 FrameID / 时间戳（不完整帧只有这一份，chunk 的 FrameID 是另一个计数器），
+			// 须在 chunk 覆盖之前记录
+			pipeline.gaps.Record(frame.frameId, frame.timestamp);
+
+			// 相机时间戳、FrameID、曝光和增益以 chunk 为准
+			if (pipeline.chunkFields != 0)
+			{
+				const auto parseStart = std::chrono::steady_clock::now();
+				if (ReadChunkData(frame.image, pipeline.chunkFields, frame))
+				{
+					pipeline.chunkParse.Record(ElapsedNs(parseStart));
+					RecordChunk(pipeline, frame);
+				}
+				else
+				{
+					stats.chunkErrors++;
+				}
+			}
+			// 推入帧环，缓冲由最后一个持有者负责归还
+			{
+				const uint64_t seq = ring.Head();
+				if (ring.Push(std::move(frame)) &&
+					(pipeline.history || pipeline.recorder.IsOpen() || pipeline.video.IsRecording()))
+				{
+					FrameRef ref = ring.Acquire(seq);
+					if (ref && pipeline.history)
+					{
+						pipeline.history->Record(*ref);
+					}
+					if (ref && pipeline.recorder.IsOpen())
+					{
+						SessionFrameInfo info;
+						info.exposureUs = pipeline.exposureUs.load(std::memory_order_relaxed);
+						info.gainDb = pipeline.gainDb.load(std::memory_order_relaxed);
+						pipeline.recorder.Append(*ref, info);
+					}
+					if (ref && pipeline.video.IsRecording())
+					{
+						// 只复制入队，编码在录像线程中进行
+						pipeline.video.Submit(*ref);
+					}
+				}
+			}
+			if (stats.grabbed++ == 0 && pipeline.startup)
+			{
+				const std::string prefix = pipeline.id.empty() ? "" : "[" + pipeline.id + "] ";
+				pipeline.startup->Record(prefix + "first frame", pipeline.acquisitionStart);
+				cout << prefix << "First frame " << ElapsedNs(pipeline.startup->Start()) / 1e6 << " ms after startup" << endl;
+			}
+			break;
+		case GRAB_INCOMPLETE:
+			cout << "Image incomplete (" << source.Name() << "): " << message << endl;
+			stats.incomplete++;
+			pipeline.gaps.Record(frame.frameId, frame.timestamp);
+
+			// 释放图像缓冲
+			source.Release(frame.image);
+			break;
+		case GRAB_TIMEOUT:
+			stats.timeouts++;
+			break;
+		case GRAB_DISCONNECTED:
+			// 放开帧环中的帧，显示帧由主线程放开，相机缓冲全部归还后来源才能重新连接
+			cout << "Source disconnected (" << source.Name() << "): " << message << endl;
+			ring.Clear();
+			pipeline.sourceLost = true;
+			break;
+		case GRAB_ERROR:
+		default:
+			cout << "Image error (" << source.Name() << "): " << message << endl;
+			stats.errors++;
+		}
+	}
+}
+
+// 取帧环中最新的一帧更新预览窗口，来不及显示的帧直接跳过
+void UpdatePreview(SourcePipeline &pipeline)
+{
+	FrameRef frame = pipeline.ring.Latest();
+	if (!frame || frame->seq == pipeline.shownSeq)
+	{
+		return;
+	}
+
+	// 先放开上一帧，转换目标才能被复用
+	pipeline.cvImage = cv::Mat();
+	pipeline.shown = Mono8Frame();
+	pipeline.shownSeq = frame->seq;
+	pipeline.consumerLatency.Record(static_cast<uint64_t>(
+		std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - frame->hostTime).count()));
+
+	// 缩小显示图像：支持的格式直接从 SDK 缓冲生成预览，否则先转换为 8 位灰度
+	const cv::Mat *pPreview;
+	if (pipeline.decimator.SupportsFused(frame->image->GetPixelFormat()))
+	{
+		const auto start = std::chrono::steady_clock::now();
+		pPreview = &pipeline.decimator.Decimate(frame->image);
+		pipeline.resizeLatency.Record(ElapsedNs(start));
+		pipeline.fusedFrames++;
+	}
+	else
+	{
+		if (!pipeline.fusedNoted && PreviewDecimator::IsBayer(frame->image->GetPixelFormat()))
+		{
+			cout << pipeline.logPrefix << "Note: preview factor " << kPreviewFactor
+				 << " is odd, Bayer frames are converted in full before decimating (use an even factor)" << endl;
+			pipeline.fusedNoted = true;
+		}
+		auto start = std::chrono::steady_clock::now();
+		pipeline.shown = pipeline.converter.Convert(frame);
+		pipeline.cvImage = pipeline.shown.mat;
+		pipeline.convertLatency.Record(ElapsedNs(start));
+		start = std::chrono::steady_clock::now();
+		pPreview = &pipeline.decimator.Decimate(pipeline.cvImage);
+		pipeline.resizeLatency.Record(ElapsedNs(start));
+	}
+	pipeline.shownFrame = std::move(frame);
+
+	// 显示缩小后的图像
+	if (!pPreview->empty())
+	{
+		const auto start = std::chrono::steady_clock::now();
+		cv::imshow(pipeline.window, *pPreview);
+		pipeline.displayLatency.Record(ElapsedNs(start));
+		pipeline.shownFrames++;
+	}
+	else
+	{
+		std::cerr << "Preview image is empty!" << std::endl;
+	}
+}
+
+// 丢帧检测的期望帧率：设置了目标帧率时为 AcquisitionFrameRate，否则为相机按当前配置给出的
+// AcquisitionResultingFrameRate（开始采集后读取，反映最终配置）；非相机来源为设定帧率
+double ConfiguredFrameRate(const SourcePipeline &pipeline)
+{
+	if (!pipeline.features)
+	{
+		return pipeline.frameRate;
+	}
+	if ((pipeline.capture ? previewTarget.frameRate : roiTarget.frameRate) > 0.0)
+	{
+		return pipeline.features->Get(FEATURE_ACQUISITION_FRAME_RATE, 0.0);
+	}
+	return pipeline.features->Get(FEATURE_RESULTING_FRAME_RATE, 0.0);
+}
+
+// 把各流水线、写盘线程池和 SDK 流节点的指标登记到注册表，之后只在导出时读取
+void RegisterMetrics(MetricsRegistry &metrics, std::vector<std::unique_ptr<SourcePipeline>> &pipelines,
+					 const ImageSaver &saver)
+{
+	for (auto &pipeline : pipelines)
+	{
+		SourcePipeline *p = pipeline.get();
+		const std::string source = p->id.empty() ? p->source.Name() : p->id;
+
+		metrics.AddHistogram("grab_wait", source, p->grabWait);
+		metrics.AddHistogram("convert", source, p->convertLatency);
+		metrics.AddHistogram("resize", source, p->resizeLatency);
+		metrics.AddHistogram("display", source, p->displayLatency);
+		metrics.AddHistogram("frame_age", source, p->consumerLatency);
+
+		metrics.AddCounter("frames", source, p->stats.grabbed);
+		metrics.AddCounter("bytes", source, p->stats.bytes);
+		metrics.AddCounter("incomplete", source, p->stats.incomplete);
+		metrics.AddCounter("timeouts", source, p->stats.timeouts);
+		metrics.AddCounter("grab_errors", source, p->stats.errors);
+		metrics.AddCounter("ring_dropped", source, [p] { return static_cast<double>(p->ring.Dropped()); });
+		metrics.AddCounter("session_dropped", source, [p] { return static_cast<double>(p->recorder.Dropped()); });
+		metrics.AddCounter("video_dropped", source, [p] { return static_cast<double>(p->video.Dropped()); });
+		if (p->history)
+		{
+			metrics.AddCounter("history_overruns", source, [p] { return static_cast<double>(p->history->Overruns()); });
+		}
+		metrics.AddHistogram("frame_jitter", source, p->gaps.Jitter());
+		metrics.AddCounter("missing_frames", source, [p] { return static_cast<double>(p->gaps.Missing()); });
+		metrics.AddCounter("drop_bursts", source, [p] { return static_cast<double>(p->gaps.Bursts()); });
+		metrics.AddCounter("frame_stalls", source, [p] { return static_cast<double>(p->gaps.Stalls()); });
+		for (size_t i = 0; i < p->gaps.StageCount(); i++)
+		{
+			metrics.AddCounter("drop_bursts_" + p->gaps.StageName(i), source,
+							   [p, i] { return static_cast<double>(p->gaps.StageBursts(i)); });
+		}
+		if (p->chunkFields != 0)
+		{
+			metrics.AddHistogram("chunk_parse", source, p->chunkParse);
+			metrics.AddHistogram("frame_interval_camera", source, p->cameraInterval);
+			metrics.AddHistogram("frame_interval_host", source, p->hostInterval);
+			metrics.AddCounter("chunk_errors", source, p->stats.chunkErrors);
+			metrics.AddCounter("crc_errors", source, p->stats.crcErrors);
+			metrics.AddGauge("exposure_us", source, [p] { return p->exposureUs.load(std::memory_order_relaxed); });
+			metrics.AddGauge("gain_db", source, [p] { return p->gainDb.load(std::memory_order_relaxed); });
+		}
+		if (const ReconnectingSource *reconnecting = dynamic_cast<const ReconnectingSource *>(&p->source))
+		{
+			metrics.AddHistogram("recovery", source, reconnecting->RecoveryLatency());
+			metrics.AddCounter("reconnects", source, [reconnecting] { return static_cast<double>(reconnecting->Reconnects()); });
+		}
+		if (const TriggeredCapture *capture = p->capture)
+		{
+			metrics.AddHistogram("capture_switch", source, capture->SwitchLatency());
+			metrics.AddHistogram("capture_trigger", source, capture->TriggerLatency());
+			metrics.AddHistogram("capture_restore", source, capture->RestoreLatency());
+			metrics.AddHistogram("capture_total", source, p->captureLatency);
+			metrics.AddCounter("captures", source, [capture] { return static_cast<double>(capture->Captures()); });
+			metrics.AddCounter("capture_failures", source, [capture] { return static_cast<double>(capture->Failures()); });
+		}
+
+		if (!p->features)
+		{
+			continue;
+		}
+
+		// SDK 流统计；不同传输层提供的节点不同，只登记当前可读的
+		const CameraFeatures *features = p->features;
+		static const std::pair<const char *, IntegerFeature> kStreamCounters[] = {
+			{"stream_lost", FEATURE_STREAM_LOST_FRAMES},
+			{"stream_dropped", FEATURE_STREAM_DROPPED_FRAMES},
+		};
+		static const std::pair<const char *, IntegerFeature> kStreamGauges[] = {
+			{"stream_blocks_reception_time_last", FEATURE_STREAM_RECEPTION_TIME_LAST},
+			{"stream_blocks_reception_time_min", FEATURE_STREAM_RECEPTION_TIME_MIN},
+			{"stream_blocks_reception_time_max", FEATURE_STREAM_RECEPTION_TIME_MAX},
+			{"stream_blocks_processing_time_last", FEATURE_STREAM_PROCESSING_TIME_LAST},
+			{"stream_blocks_processing_time_min", FEATURE_STREAM_PROCESSING_TIME_MIN},
+			{"stream_blocks_processing_time_max", FEATURE_STREAM_PROCESSING_TIME_MAX},
+			{"stream_input_buffers", FEATURE_STREAM_INPUT_BUFFERS},
+		};
+		for (const auto &node : kStreamCounters)
+		{
+			const IntegerFeature feature = node.second;
+			if (features->IsReadable(feature))
+			{
+				metrics.AddCounter(node.first, source, [features, feature] { return static_cast<double>(features->Get(feature)); });
+			}
+		}
+		for (const auto &node : kStreamGauges)
+		{
+			const IntegerFeature feature = node.second;
+			if (features->IsReadable(feature))
+			{
+				metrics.AddGauge(node.first, source, [features, feature] { return static_cast<double>(features->Get(feature)); });
+			}
+		}
+	}
+
+	const ImageSaver *pSaver = &saver;
+	metrics.AddHistogram("save_queue", "saver", saver.QueueLatency());
+	metrics.AddHistogram("save_encode", "saver", saver.EncodeLatency());
+	metrics.AddHistogram("save_write", "saver", saver.WriteLatency());
+	metrics.AddCounter("saved", "saver", [pSaver] { return static_cast<double>(pSaver->SavedCount()); });
+	metrics.AddCounter("save_failed", "saver", [pSaver] { return static_cast<double>(pSaver->FailedCount()); });
+	metrics.AddGauge("save_queue_depth", "saver", [pSaver] { return static_cast<double>(pSaver->QueueDepth()); });
+}
+
+// 周期性报告：多个来源时打印各自的吞吐量，相机来源打印流缓冲统计（括号内为自上次报告以来的增量）
+void PrintPeriodicStats(std::vector<std::unique_ptr<SourcePipeline>> &pipelines, double seconds)
+{
+	for (auto &pipeline : pipelines)
+	{
+		const std::string prefix = pipeline->id.empty() ? "" : "[" + pipeline->id + "] ";
+		if (pipelines.size() > 1)
+		{
+			const uint64_t frames = pipeline->stats.grabbed;
+			const uint64_t bytes = pipeline->stats.bytes;
+			cout << prefix << (frames - pipeline->reportedFrames) / seconds << " fps, "
+				 << (bytes - pipeline->reportedBytes) / seconds / (1024.0 * 1024.0) << " MB/s" << endl;
+			pipeline->reportedFrames = frames;
+			pipeline->reportedBytes = bytes;
+		}
+
+		// 相机出帧速率（按相机时间戳，含丢失的帧）偏离配置帧率，以及新出现的丢帧
+		const FrameGapDetector::RateCheck rate = pipeline->gaps.CheckRate();
+		if (rate.flagged)
+		{
+			cout << prefix << "Warning: camera frame rate " << rate.measuredFps << " fps, configured " << rate.expectedFps
+				 << " fps (" << std::showpos << rate.deviation * 100.0 << std::noshowpos << "%)" << endl;
+		}
+		const uint64_t missing = pipeline->gaps.Missing();
+		if (missing != pipeline->reportedMissing)
+		{
+			cout << prefix << "Missing frames " << missing << " (+" << missing - pipeline->reportedMissing << ") in "
+				 << pipeline->gaps.Bursts() << " bursts, jitter p99 " << pipeline->gaps.Jitter().Percentile(0.99) / 1e6
+				 << " ms" << endl;
+			pipeline->reportedMissing = missing;
+		}
+
+		if (pipeline->recorder.IsOpen())
+		{
+			pipeline->RefreshCameraSettings();
+			cout << prefix << "Recording " << pipeline->recorder.FrameCount() << " frames, "
+				 << pipeline->recorder.BytesWritten() / (1024 * 1024) << " MB written, dropped " << pipeline->recorder.Dropped()
+				 << endl;
+		}
+
+		if (pipeline->video.IsRecording())
+		{
+			const uint64_t encoded = pipeline->video.Encoded();
+			cout << prefix << "Video " << (encoded - pipeline->reportedVideoFrames) / seconds << " fps encoded, backlog "
+				 << pipeline->video.Backlog() << ", dropped " << pipeline->video.Dropped() << endl;
+			pipeline->reportedVideoFrames = encoded;
+		}
+
+		if (pipeline->features)
+		{
+			const StreamCounters counters = ReadStreamCounters(*pipeline->features);
+			if (counters.lost < 0 && counters.dropped < 0)
+			{
+				continue;
+			}
+			// 相机重连后 SDK 流统计从 0 重新计数
+			const StreamCounters &last = pipeline->reportedCounters;
+			const int64_t lastLost = counters.lost >= last.lost ? std::max<int64_t>(last.lost, 0) : 0;
+			const int64_t lastDropped = counters.dropped >= last.dropped ? std::max<int64_t>(last.dropped, 0) : 0;
+			cout << prefix << "Stream lost " << counters.lost << " (+" << counters.lost - lastLost << "), dropped "
+				 << counters.dropped << " (+" << counters.dropped - lastDropped << "), input buffers " << counters.inputBuffers << "/" << counters.announced << endl;
+			pipeline->reportedCounters = counters;
+		}
+	}
+}
+
+// 启动前由用户输入的命名和保存设置
+struct SessionSettings
+{
+	std::string groupName;
+	int groupId = 0;
+	std::string saveFolder;
+};
+
+// 相机启动之前询问，这样启动到第一帧的计时不包含等待输入的时间
+SessionSettings PromptSessionSettings()
+{
+	SessionSettings settings;
+
+	std::cout << "图片命名前置标志字符(默认为空)：";
+	std::getline(std::cin, settings.groupName);
+
+	// 如果用户直接回车，groupName 就是空字符串
+	if (settings.groupName.empty())
+	{
+		std::cout << "使用默认空前缀" << std::endl;
+	}
+
+	std::cout << "图片起始序号ID：";
+	std::cin >> settings.groupId;
+	std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+
+	std::cout << "图片要保存的文件夹名称：";
+	std::cin >> settings.saveFolder;
+
+	return settings;
+}
+
+// This function acquires images continuously from one or more frame sources and saves the displayed ones on demand.
+int RunAcquisitionLoop(const std::vector<AcquisitionSource> &targets, const SessionSettings &settings,
+					   StartupTrace *startup = nullptr)
+{
+	int result = 0;
+
+	try
+	{
+		int group_id = settings.groupId;
+		const std::string group_name = settings.groupName;
+		const std::string save_folder = settings.saveFolder;
+
+		// 多个相机时每个相机保存到以 DeviceID 命名的子目录，按空格同时保存各相机当前显示的帧
+		std::vector<std::unique_ptr<SourcePipeline>> pipelines;
+		for (const AcquisitionSource &target : targets)
+		{
+			const bool multiple = targets.size() > 1;
+			const std::string folder = multiple ? save_folder + "/" + target.id : save_folder;
+			const std::string window = multiple ? "Live View - " + target.id : "Live View";
+			std::error_code ec;
+			fs::create_directories(folder, ec);
+			pipelines.emplace_back(new SourcePipeline(target, window, folder));
+		}
+
+		// 后台写盘线程池（所有相机共用）
+		ImageSaver saver(std::max(1u, std::thread::hardware_concurrency() / 2), kSaveQueueCapacity, saveFormat);
+
+		// 指标注册表在流水线和写盘线程池之后创建，先于它们销毁
+		MetricsRegistry metrics;
+		// 丢帧归因用的各阶段累计耗时（多个写盘线程的耗时相加）
+		for (auto &pipeline : pipelines)
+		{
+			SourcePipeline *p = pipeline.get();
+			const ImageSaver *pSaver = &saver;
+			p->gaps.AddStage("chunk_parse", [p] { return p->chunkParse.Sum(); });
+			p->gaps.AddStage("convert", [p] { return p->convertLatency.Sum(); });
+			p->gaps.AddStage("resize", [p] { return p->resizeLatency.Sum(); });
+			p->gaps.AddStage("display", [p] { return p->displayLatency.Sum(); });
+			p->gaps.AddStage("save_encode", [pSaver] { return pSaver->EncodeLatency().Sum(); });
+			p->gaps.AddStage("save_write", [pSaver] { return pSaver->WriteLatency().Sum(); });
+		}
+		RegisterMetrics(metrics, pipelines, saver);
+		const std::string metricsPath =
+			save_folder + (metricsFormat == METRICS_PROMETHEUS ? "/metrics.prom" : "/metrics.json");
+
+		// suffix 用于预触发连拍中显示帧之前 / 之后的帧，例如 "_-2"、"_+1"
+		auto make_burst_filename = [&](const SourcePipeline &pipeline, int id, const std::string &suffix)
+		{
+			std::ostringstream filename;
+			if (group_name.empty())
+				filename << pipeline.folder << "/" << id << suffix << saver.Format().Extension();
+			else
+				filename << pipeline.folder << "/" << group_name << "_" << id << suffix << saver.Format().Extension();
+			return filename.str();
+		};
+		auto make_filename = [&](const SourcePipeline &pipeline, int id) { return make_burst_filename(pipeline, id, ""); };
+		auto source_name = [](const SourcePipeline &pipeline) { return pipeline.id.empty() ? pipeline.source.Name() : pipeline.id; };
+
+		// 每组实际保存的文件，删除键按组删除
+		std::map<int, std::vector<std::string>> groupFiles;
+
+		// 显示帧之后的帧到齐（或超时、或 force）时，把整组从历史缓冲交给写盘线程
+		auto flush_bursts = [&](bool force)
+		{
+			const auto now = std::chrono::steady_clock::now();
+			for (auto &pipeline : pipelines)
+			{
+				auto &pending = pipeline->pendingBursts;
+				for (auto it = pending.begin(); it != pending.end();)
+				{
+					const uint64_t lastSeq = it->centerSeq + preTriggerBurst;
+					const uint64_t newest = pipeline->history->NewestSeq();
+					const bool complete = newest != FrameRing::kInvalidSeq && newest >= lastSeq;
+					if (!force && !complete && now < it->deadline)
+					{
+						++it;
+						continue;
+					}
+
+					const uint64_t firstSeq = it->centerSeq - std::min<uint64_t>(it->centerSeq, preTriggerBurst);
+					const std::vector<FrameHistory::Pin> frames = pipeline->history->Range(firstSeq, lastSeq);
+					for (const FrameHistory::Pin &pin : frames)
+					{
+						const int64_t offset = static_cast<int64_t>(pin->seq) - static_cast<int64_t>(it->centerSeq);
+						const std::string suffix = offset == 0 ? "" : (offset > 0 ? "_+" : "_") + std::to_string(offset);
+						const std::string filename = make_burst_filename(*pipeline, it->groupId, suffix);
+
+						// 历史槽由 keepAlive 持有到写完为止，原生 Mono8 不复制
+						const auto start = std::chrono::steady_clock::now();
+						Mono8Frame mono = pipeline->converter.Convert(pin->image, pin);
+						pipeline->convertLatency.Record(ElapsedNs(start));
+						saver.Submit(it->groupId, filename, mono.mat, mono.keepAlive,
+									 saveSidecars ? FormatSidecar(*pin, source_name(*pipeline), it->groupId) : std::string());
+						groupFiles[it->groupId].push_back(filename);
+					}
+					cout << "Queued burst: " << it->groupId << " (" << frames.size() << " frames";
+					if (!pipeline->id.empty())
+					{
+						cout << ", " << pipeline->id;
+					}
+					cout << ")" << endl;
+					it = pending.erase(it);
+				}
+			}
+		};
+
+		// 全分辨率抓拍：暂停抓图线程，切到全分辨率以软件触发取一帧，切回预览后恢复抓图。
+		// 调用前主线程已放开显示中的帧；预览帧不会交给写盘线程，放开帧环后相机缓冲就全部归还了
+		auto capture_full = [&](SourcePipeline &pipeline, Frame &frame)
+		{
+			pipeline.StopGrabbing();
+			bool captured = false;
+			const ReconnectingSource *reconnecting = dynamic_cast<const ReconnectingSource *>(&pipeline.source);
+			if (reconnecting && !reconnecting->IsConnected())
+			{
+				cout << pipeline.logPrefix << "Source disconnected, capture skipped" << endl;
+			}
+			else
+			{
+				pipeline.ring.Clear();
+				CaptureTiming timing;
+				try
+				{
+					captured = pipeline.capture->Capture(pipeline.source, pipeline.chunkFields, captureTimeoutMs, frame, timing);
+				}
+				catch (std::exception &e)
+				{
+					// Capture() 只处理 Spinnaker 异常，其余（内存不足、OpenCV 等）按本次抓拍失败处理，仍要恢复抓图
+					cout << pipeline.logPrefix << "Error: " << e.what() << endl;
+					captured = false;
+				}
+				cout << pipeline.logPrefix << "Capture ";
+				if (captured)
+				{
+					cout << frame.image->GetWidth() << "x" << frame.image->GetHeight();
+				}
+				else
+				{
+					cout << "failed";
+				}
+				cout << ": switch " << timing.switchMs << " ms, trigger to frame " << timing.triggerMs << " ms, restore "
+					 << timing.restoreMs << " ms" << endl;
+
+				// 抓拍过程中掉线时 GRAB_DISCONNECTED 已被抓拍取走，这里代抓图线程通知显示循环
+				if (reconnecting && !reconnecting->IsConnected())
+				{
+					pipeline.sourceLost = true;
+				}
+			}
+
+			// 有意停止的这一段不计为丢帧或帧间隔。StartGrabbing() 的异常由调用方收集后再抛出
+			pipeline.gaps.Resync();
+			pipeline.lastCameraTimestamp = 0;
+			pipeline.StartGrabbing();
+			return captured;
+		};
+
+		// 启动采集和各自的抓图线程，之后主线程只作为显示 / 保存的消费者。
+		// 多个相机时 BeginAcquisition() 并行调用，第一个失败的异常在全部返回后再抛出
+		auto start_source = [&](SourcePipeline &pipeline)
+		{
+			const auto phaseStart = std::chrono::steady_clock::now();
+			pipeline.source.Start();
+			pipeline.acquisitionStart = std::chrono::steady_clock::now();
+			pipeline.gaps.SetExpectedFrameRate(ConfiguredFrameRate(pipeline));
+			if (startup)
+			{
+				startup->Record((pipeline.id.empty() ? "" : "[" + pipeline.id + "] ") + "BeginAcquisition", phaseStart);
+			}
+		};
+		if (pipelines.size() > 1)
+		{
+			std::vector<std::exception_ptr> errors(pipelines.size());
+			std::vector<std::thread> startThreads;
+			for (size_t i = 0; i < pipelines.size(); i++)
+			{
+				startThreads.emplace_back(
+					[&, i]
+					{
+						try
+						{
+							start_source(*pipelines[i]);
+						}
+						catch (...)
+						{
+							errors[i] = std::current_exception();
+						}
+					});
+			}
+			for (std::thread &thread : startThreads)
+			{
+				thread.join();
+			}
+			for (const std::exception_ptr &error : errors)
+			{
+				if (error)
+				{
+					std::rethrow_exception(error);
+				}
+			}
+		}
+		else
+		{
+			start_source(*pipelines.front());
+		}
+		for (auto &pipeline : pipelines)
+		{
+			pipeline->StartGrabbing();
+			cout << "Start acquiring images from " << pipeline->source.Name() << "..." << endl;
+		}
+		cout << "Press ESC to exit" << endl;
+
+		cout << "Preview decimation 1/" << kPreviewFactor << " (" << PreviewDecimator::InstructionSet() << ")" << endl;
+
+		for (auto &pipeline : pipelines)
+		{
+			cv::namedWindow(pipeline->window, cv::WINDOW_AUTOSIZE); // 确保窗口创建
+		}
+
+		const auto startTime = std::chrono::steady_clock::now();
+		auto lastReport = startTime;
+		bool videoRecording = false;
+		bool startupReported = startup == nullptr;
+
+		// 实时显示循环
+		while (true)
+		{
+			try
+			{
+				for (auto &pipeline : pipelines)
+				{
+					if (pipeline->sourceLost.exchange(false))
+					{
+						pipeline->cvImage = cv::Mat();
+						pipeline->shown = Mono8Frame();
+						pipeline->shownFrame.Reset();
+					}
+					UpdatePreview(*pipeline);
+					pipeline->gaps.Poll(pipeline->logPrefix);
+				}
+				if (preTriggerBurst > 0)
+				{
+					flush_bursts(false);
+				}
+
+				// 所有来源都收到第一帧后打印一次启动各阶段耗时
+				if (!startupReported &&
+					std::all_of(pipelines.begin(), pipelines.end(), [](const std::unique_ptr<SourcePipeline> &p) { return p->stats.grabbed > 0; }))
+				{
+					startup->Print();
+					startupReported = true;
+				}
+
+				// 定期打印各相机的吞吐量和流缓冲统计
+				const auto now = std::chrono::steady_clock::now();
+				if (now - lastReport >= kReportInterval)
+				{
+					PrintPeriodicStats(pipelines, std::chrono::duration<double>(now - lastReport).count());
+					metrics.PrintSummary(cout);
+					if (exportMetrics && !metrics.Export(metricsPath, metricsFormat))
+					{
+						cout << "Failed to write metrics: " << metricsPath << endl;
+					}
+					lastReport = now;
+				}
+
+				// 检查是否按下 ESC 键
+				int key = cv::waitKey(1);
+
+				if (key == 27) // ESC 键
+				{
+					cout << "ESC pressed, exiting..." << endl;
+					break;
+				}
+				else if (key == 'r' || key == 'R') // 开始 / 停止录制原始会话
+				{
+					const bool recording = !pipelines.empty() && pipelines.front()->recorder.IsOpen();
+					for (auto &pipeline : pipelines)
+					{
+						if (recording)
+						{
+							pipeline->recorder.Close();
+							continue;
+						}
+
+						std::ostringstream path;
+						const std::time_t now = std::time(nullptr);
+						path << pipeline->folder << "/" << (group_name.empty() ? "session" : group_name) << "_"
+							 << std::put_time(std::localtime(&now), "%Y%m%d_%H%M%S") << ".spr";
+						pipeline->RefreshCameraSettings();
+						if (pipeline->recorder.Open(path.str(), pipeline->id.empty() ? pipeline->source.Name() : pipeline->id))
+						{
+							cout << "Recording to " << path.str() << " (press R to stop)" << endl;
+						}
+					}
+				}
+				else if (key == 'v' || key == 'V') // 开始 / 停止连续录像
+				{
+					videoRecording = !videoRecording;
+					for (auto &pipeline : pipelines)
+					{
+						if (!videoRecording)
+						{
+							pipeline->video.Stop();
+							continue;
+						}
+
+						std::ostringstream path;
+						const std::time_t now = std::time(nullptr);
+						path << pipeline->folder << "/" << (group_name.empty() ? "video" : group_name) << "_"
+							 << std::put_time(std::localtime(&now), "%Y%m%d_%H%M%S");
+						const float frameRate = videoConfig.frameRate > 0.0f
+													? videoConfig.frameRate
+													: (pipeline->features ? ReadResultingFrameRate(*pipeline->features) : 0.0f);
+						pipeline->reportedVideoFrames = 0;
+						if (pipeline->video.Start(path.str(), videoConfig, frameRate))
+						{
+							cout << "Recording video to " << path.str() << " (press V to stop)" << endl;
+						}
+					}
+				}
+				else if (key == 32) // space 保存图像
+				{
+					const auto pressed = std::chrono::steady_clock::now();
+
+					// 预览 / 抓拍模式的相机各自切换、触发，多个相机时并行
+					std::vector<Frame> captures(pipelines.size());
+					std::vector<char> captured(pipelines.size(), 0);
+					std::vector<std::exception_ptr> captureErrors(pipelines.size());
+					std::vector<std::thread> captureThreads;
+					for (size_t i = 0; i < pipelines.size(); i++)
+					{
+						SourcePipeline &pipeline = *pipelines[i];
+						if (!pipeline.capture)
+						{
+							continue;
+						}
+						pipeline.cvImage = cv::Mat();
+						pipeline.shown = Mono8Frame();
+						pipeline.shownFrame.Reset();
+						captureThreads.emplace_back(
+							[&, i]
+							{
+								try
+								{
+									captured[i] = capture_full(*pipelines[i], captures[i]);
+								}
+								catch (...)
+								{
+									captured[i] = 0;
+									captureErrors[i] = std::current_exception();
+								}
+							});
+					}
+					for (std::thread &thread : captureThreads)
+					{
+						thread.join();
+					}
+					// 与并行启动相同：全部返回后再抛出第一个错误（抓图线程没能恢复，不能继续采集）
+					for (const std::exception_ptr &error : captureErrors)
+					{
+						if (error)
+						{
+							std::rethrow_exception(error);
+						}
+					}
+
+					size_t queued = 0;
+					for (size_t i = 0; i < pipelines.size(); i++)
+					{
+						auto &pipeline = pipelines[i];
+						if (pipeline->capture)
+						{
+							if (!captured[i])
+							{
+								continue;
+							}
+							// 抓到的帧已是副本，原生 Mono8 直接交给写盘线程
+							const Frame &frame = captures[i];
+							const auto start = std::chrono::steady_clock::now();
+							Mono8Frame mono = pipeline->converter.Convert(frame.image, std::make_shared<ImagePtr>(frame.image));
+							pipeline->convertLatency.Record(ElapsedNs(start));
+							saver.Submit(group_id, make_filename(*pipeline, group_id), mono.mat, mono.keepAlive,
+										 saveSidecars ? FormatSidecar(frame, source_name(*pipeline), group_id) : std::string());
+							groupFiles[group_id].push_back(make_filename(*pipeline, group_id));
+							pipeline->captureLatency.Record(ElapsedNs(pressed));
+							cout << pipeline->logPrefix << "Capture queued " << ElapsedNs(pressed) / 1e6 << " ms after key press" << endl;
+							queued++;
+							continue;
+						}
+						if (!pipeline->shownFrame)
+						{
+							continue;
+						}
+						if (pipeline->history)
+						{
+							// 以显示帧为中心，等后续帧到齐后从历史缓冲保存
+							pipeline->pendingBursts.push_back(
+								{group_id, pipeline->shownSeq, std::chrono::steady_clock::now() + kBurstTimeout});
+							queued++;
+							continue;
+						}
+						if (pipeline->cvImage.empty())
+						{
+							// 转换为 8 位灰度图像（原生 Mono8 直接包装 SDK 缓冲）
+							const auto start = std::chrono::steady_clock::now();
+							pipeline->shown = pipeline->converter.Convert(pipeline->shownFrame);
+							pipeline->convertLatency.Record(ElapsedNs(start));
+							pipeline->cvImage = pipeline->shown.mat;
+						}
+						// 交给写盘线程，通常不做深拷贝：帧缓冲或转换结果由 keepAlive 保持到写完为止
+						const Mono8Frame saved = pipeline->converter.Detach(pipeline->shown, kMaxZeroCopySaves);
+						saver.Submit(group_id, make_filename(*pipeline, group_id), saved.mat, saved.keepAlive,
+									 saveSidecars ? FormatSidecar(*pipeline->shownFrame, source_name(*pipeline), group_id) : std::string());
+						groupFiles[group_id].push_back(make_filename(*pipeline, group_id));
+						queued++;
+					}
+					if (queued == 0)
+					{
+						cout << "No image to save yet" << endl;
+						continue;
+					}
+					cout << "Queued: " << group_id << " (" << queued << (preTriggerBurst > 0 ? " bursts" : " images")
+						 << ", queue " << saver.QueueDepth() << ")" << endl;
+
+					group_id++;
+				}
+				else if (key == 8 || key == 127) // 删除键
+				{
+					if (group_id > 0)
+					{
+						int delete_id = group_id - 1;
+						bool deleted = false;
+
+						// 还在等后续帧的连拍直接取消
+						for (auto &pipeline : pipelines)
+						{
+							auto &pending = pipeline->pendingBursts;
+							const size_t before = pending.size();
+							pending.erase(std::remove_if(pending.begin(), pending.end(),
+														 [delete_id](const SourcePipeline::PendingBurst &burst) { return burst.groupId == delete_id; }),
+										  pending.end());
+							if (pending.size() != before)
+							{
+								cout << "Cancelled burst: " << delete_id << endl;
+								deleted = true;
+							}
+						}
+
+						// 本次运行保存的组按记录的文件删除，否则按命名规则推算
+						std::vector<std::string> filenames;
+						auto found = groupFiles.find(delete_id);
+						if (found != groupFiles.end())
+						{
+							filenames.swap(found->second);
+							groupFiles.erase(found);
+						}
+						else
+						{
+							for (auto &pipeline : pipelines)
+							{
+								filenames.push_back(make_filename(*pipeline, delete_id));
+							}
+						}
+
+						// 上一组可能还在排队或正在写入，由 saver 负责取消或等写完再删
+						for (const std::string &filename : filenames)
+						{
+							switch (saver.Delete(filename))
+							{
+							case ImageSaver::DELETE_CANCELLED:
+								cout << "Cancelled: " << filename << endl;
+								deleted = true;
+								break;
+							case ImageSaver::DELETE_REMOVED:
+								cout << "Deleted: " << filename << endl;
+								deleted = true;
+								break;
+							case ImageSaver::DELETE_NOT_FOUND:
+							default:
+								cout << "No such file to delete: " << filename << endl;
+							}
+						}
+						if (deleted)
+						{
+							group_id--;
+						}
+					}
+					else
+					{
+						cout << "No images to delete" << endl;
+					}
+				}
+			}
+			catch (cv::Exception &e)
+			{
+				std::cerr << "OpenCV error: " << e.what() << std::endl;
+				break; // 或者 return -1;
+			}
+			catch (Spinnaker::Exception &e)
+			{
+				cout << "Image error: " << e.what() << endl;
+			}
+			catch (std::exception &e)
+			{
+				// 如抓拍后抓图线程无法重新启动：结束采集，照常收尾
+				cout << "Error: " << e.what() << endl;
+				break;
+			}
+		}
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+		// 先停所有抓图线程，再归还仍被持有的缓冲
+		for (auto &pipeline : pipelines)
+		{
+			pipeline->StopGrabbing();
+		}
+
+		// 结束录制，写入索引；录像编码完队列中剩余的帧
+		for (auto &pipeline : pipelines)
+		{
+			pipeline->recorder.Close();
+			pipeline->video.Stop();
+		}
+
+		// 还在等后续帧的连拍，保存已有的部分
+		if (preTriggerBurst > 0)
+		{
+			flush_bursts(true);
+		}
+		for (auto &pipeline : pipelines)
+		{
+			pipeline->cvImage = cv::Mat();
+			pipeline->shown = Mono8Frame();
+			pipeline->shownFrame.Reset();
+		}
+
+		// 等待队列中剩余的图像写完（写完后帧环中的缓冲才全部空闲）
+		saver.Stop();
+		saver.PrintStats();
+		if (exportMetrics)
+		{
+			metrics.Export(metricsPath, metricsFormat);
+		}
+
+		for (auto &pipeline : pipelines)
+		{
+			pipeline->ring.Clear();
+
+			const SourcePipeline &p = *pipeline;
+			cout << (p.id.empty() ? "" : "[" + p.id + "] ") << "Grabbed " << p.stats.grabbed << " images ("
+				 << (seconds > 0.0 ? p.stats.grabbed / seconds : 0.0) << " fps, "
+				 << (seconds > 0.0 ? p.stats.bytes / seconds / (1024.0 * 1024.0) : 0.0) << " MB/s), displayed "
+				 << p.shownFrames << " (fused preview " << p.fusedFrames << ", zero-copy " << p.converter.ZeroCopyCount()
+				 << ", converted " << p.converter.ConvertedCount() << "), incomplete " << p.stats.incomplete
+				 << ", timeouts " << p.stats.timeouts << ", ring drops " << p.ring.Dropped() << endl;
+			cout << "  Arrival to display latency: p50 " << p.consumerLatency.Percentile(0.5) / 1e6 << " ms, p99 "
+				 << p.consumerLatency.Percentile(0.99) / 1e6 << " ms, max " << p.consumerLatency.Max() / 1e6 << " ms" << endl;
+			if (p.features)
+			{
+				const StreamCounters counters = ReadStreamCounters(*p.features);
+				cout << "  Stream lost " << counters.lost << ", dropped " << counters.dropped << endl;
+			}
+			p.gaps.PrintSummary();
+			if (p.chunkFields != 0)
+			{
+				cout << "  Chunk parse p50 " << p.chunkParse.Percentile(0.5) / 1000.0 << " us, p99 "
+					 << p.chunkParse.Percentile(0.99) / 1000.0 << " us, max " << p.chunkParse.Max() / 1000.0 << " us, errors "
+					 << p.stats.chunkErrors << ", CRC errors " << p.stats.crcErrors << endl;
+				cout << "  Frame interval camera p50/p99 " << p.cameraInterval.Percentile(0.5) / 1e6 << "/"
+					 << p.cameraInterval.Percentile(0.99) / 1e6 << " ms, host p50/p99 " << p.hostInterval.Percentile(0.5) / 1e6
+					 << "/" << p.hostInterval.Percentile(0.99) / 1e6 << " ms" << endl;
+			}
+			if (p.history)
+			{
+				cout << "  Pre-trigger history " << p.history->SlotCount() << " frames, overruns " << p.history->Overruns() << endl;
+			}
+			if (p.capture && p.capture->Captures() + p.capture->Failures() > 0)
+			{
+				const TriggeredCapture &capture = *p.capture;
+				cout << "  Captures " << capture.Captures() << " (failed " << capture.Failures() << "), switch p50 "
+					 << capture.SwitchLatency().Percentile(0.5) / 1e6 << " ms, trigger p50 "
+					 << capture.TriggerLatency().Percentile(0.5) / 1e6 << " ms, restore p50 "
+					 << capture.RestoreLatency().Percentile(0.5) / 1e6 << " ms, key to queued p50/max "
+					 << p.captureLatency.Percentile(0.5) / 1e6 << "/" << p.captureLatency.Max() / 1e6 << " ms" << endl;
+			}
+
+			// 停止采集
+			pipeline->source.Stop();
+		}
+		cv::destroyAllWindows();
+	}
+	catch (Spinnaker::Exception &e)
+	{
+		cout << "Error: " << e.what() << endl;
+		result = -1;
+	}
+
+	return result;
+}
+
+// 按配置为帧来源加上故障注入
+std::unique_ptr<FrameSource> WithFaultInjection(std::unique_ptr<FrameSource> source)
+{
+	if (faultConfig.incompleteRate > 0.0 || faultConfig.timeoutRate > 0.0)
 	{
-		return 0;
+		return std::unique_ptr<FrameSource>(new FaultInjector(std::move(source), faultConfig));
 	}
+	return source;
+}
 
-	gcstring streamMode;
-	switch (chosenStreamMode)
+// 按配置创建相机帧来源（事件驱动或轮询，可选故障注入）
+std::unique_ptr<FrameSource> MakeCameraSource(CameraPtr pCam, const BufferArena *pArena)
+{
+	std::unique_ptr<FrameSource> source;
+	if (useImageEvents)
 	{
-	case STREAM_MODE_PGRLWF:
-		streamMode = "LWF";
-		break;
-	case STREAM_MODE_SOCKET:
-		streamMode = "Socket";
-		break;
-	case STREAM_MODE_TELEDYNE_GIGE_VISION:
-	default:
-		streamMode = "TeledyneGigeVision";
+		source.reset(new EventCameraSource(pCam, pArena));
 	}
-
-	// Retrieve the desired entry node from the enumeration node
-	const CEnumEntryPtr ptrStreamModeCustom = ptrStreamMode->GetEntryByName(streamMode);
-	if (!IsReadable(ptrStreamModeCustom))
+	else
 	{
-		// Failed to get custom node
-		cout << "Stream mode " + streamMode + " not available.  Aborting..." << endl;
-		return -1;
+		source.reset(new CameraSource(pCam, pArena));
 	}
-	// Retrieve the integer value from the entry node
-	const int64_t streamModeCustom = ptrStreamModeCustom->GetValue();
+	return WithFaultInjection(std::move(source));
+}
 
-	// Set integer as new value for enumeration node
-	ptrStreamMode->SetIntValue(streamModeCustom);
+// 无相机时运行：合成帧或回放文件驱动同一条采集流水线
+int RunOfflineSource()
+{
+	std::string replay_folder;
+	if (chosenFrameSource == FRAME_SOURCE_REPLAY)
+	{
+		std::cout << "回放图片所在文件夹：";
+		std::getline(std::cin, replay_folder);
+	}
+	auto make_source = [replay_folder]
+	{
+		std::unique_ptr<FrameSource> source;
+		if (chosenFrameSource == FRAME_SOURCE_REPLAY)
+		{
+			source.reset(new ReplaySource(replay_folder, replayFrameRate, true));
+		}
+		else
+		{
+			source.reset(new SyntheticSource(syntheticConfig));
+		}
+		return WithFaultInjection(std::move(source));
+	};
+	std::unique_ptr<FrameSource> source = make_source();
 
-	// Print out the current stream mode
-	cout << endl
-		 << "Stream Mode set to " + ptrStreamMode->GetCurrentEntry()->GetSymbolic() << "..." << endl;
+	// 模拟掉线：每次“重新接入”都新建一个来源
+	if (reconnectCameras && reconnectConfig.simulatedUptime > 0.0)
+	{
+		std::unique_ptr<FrameSource> initial = std::move(source);
+		source.reset(new ReconnectingSource(std::move(initial), make_source, nullptr, reconnectConfig));
+	}
 
-	return 0;
+	const SessionSettings settings = PromptSessionSettings();
+	cout << "Running example for " << source->Name() << "..." << endl;
+	AcquisitionSource target{source.get(), ""};
+	target.frameRate = chosenFrameSource == FRAME_SOURCE_REPLAY ? replayFrameRate : syntheticConfig.frameRate;
+	return RunAcquisitionLoop({target}, settings);
 }
 
-// This function acquires and saves 10 images from a device.
-int AcquireImages(CameraPtr pCam, INodeMap &nodeMap, INodeMap &nodeMapTLDevice)
+int PrintDeviceInfo(INodeMap &nodeMap, std::ostream &out)
 {
 	int result = 0;
+	out << endl
+		 << "*** DEVICE INFORMATION ***" << endl
+		 << endl;
 
 	try
 	{
-		int group_id;
-		std::string group_name;
-
-		std::cout << "图片命名前置标志字符(默认为空)：";
-		std::getline(std::cin, group_name); 
+		FeatureList_t features;
+		const CCategoryPtr category = nodeMap.GetNode("DeviceInformation");
+		if (IsReadable(category))
+		{
+			category->GetFeatures(features);
 
-		// 如果用户直接回车，group_name 就是空字符串
-		if (group_name.empty())
+			for (auto it = features.begin(); it != features.end(); ++it)
+			{
+				const CNodePtr pfeatureNode = *it;
+				out << pfeatureNode->GetName() << " : ";
+				CValuePtr pValue = static_cast<CValuePtr>(pfeatureNode);
+				out << (IsReadable(pValue) ? pValue->ToString() : "Node not readable");
+				out << endl;
+			}
+		}
+		else
 		{
-			std::cout << "使用默认空前缀" << std::endl;
+			out << "Device control information not available." << endl;
 		}
+	}
+	catch (Spinnaker::Exception &e)
+	{
+		out << "Error: " << e.what() << endl;
+		result = -1;
+	}
 
-		std::cout << "图片起始序号ID：";
-		std::cin >> group_id;
-		std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n'); 
+	return result;
+}
 
-		std::string save_folder;
-		std::cout << "图片要保存的文件夹名称：";
-		std::cin >> save_folder;
+// 初始化并配置单个相机：解析节点句柄、分辨率、流模式、可选用户缓冲区和连续采集模式。
+// capture 非空时最后切到预览配置，全分辨率配置留给抓拍
+int ConfigureCamera(CameraPtr pCam, CameraFeatures &features, BufferArena &arena, StartupTrace &startup,
+					unsigned &chunkFields, TriggeredCapture *capture)
+{
+	int result = 0;
+	const auto start = std::chrono::steady_clock::now();
 
-		// 设置采集模式为连续
-		CEnumerationPtr ptrAcquisitionMode = nodeMap.GetNode("AcquisitionMode");
-		CEnumEntryPtr ptrAcquisitionModeContinuous = ptrAcquisitionMode->GetEntryByName("Continuous");
-		const int64_t acquisitionModeContinuous = ptrAcquisitionModeContinuous->GetValue();
-		ptrAcquisitionMode->SetIntValue(acquisitionModeContinuous);
-		cout << "Acquisition mode set to continuous..." << endl;
-
-		// 启动采集
-		pCam->BeginAcquisition();
-		cout << "Start acquiring images (press ESC to exit)..." << endl;
-
-		// 初始化图像处理器
-		ImageProcessor processor;
-		processor.SetColorProcessing(SPINNAKER_COLOR_PROCESSING_ALGORITHM_HQ_LINEAR);
-
-		cv::namedWindow("Live View", cv::WINDOW_AUTOSIZE); // 确保窗口创建
-		// 实时图像采集循环
-		while (true)
-		{
-			try
-			{
-				// 抓图（50ms 超时）
-				ImagePtr pResultImage = pCam->GetNextImage(50);
+	try
+	{
+		const std::string deviceId = pCam->GetDeviceID().c_str();
+		const std::string prefix = "[" + deviceId + "] ";
 
-				if (pResultImage->IsIncomplete())
-				{
-					cout << "Image incomplete: " << Image::GetImageStatusDescription(pResultImage->GetImageStatus()) << endl;
-				}
-				else
-				{
-					// 转换为 8 位灰度图像
-					ImagePtr convertedImage = processor.Convert(pResultImage, PixelFormat_Mono8);
+		// Initialize camera
+		auto phaseStart = std::chrono::steady_clock::now();
+		pCam->Init();
+		startup.Record(prefix + "Init", phaseStart);
 
-					// 转换为 OpenCV Mat
-					cv::Mat cvImage(
-						static_cast<int>(convertedImage->GetHeight()), // 将 size_t 转为 int，确保不会丢失数据
-						static_cast<int>(convertedImage->GetWidth()),
-						CV_8UC1,
-						convertedImage->GetData());
+		// 一次性解析之后要用到的节点，运行中的读写不再按名称查找
+		phaseStart = std::chrono::steady_clock::now();
+		if (!features.Resolve(pCam))
+		{
+			result = -1;
+		}
+		startup.Record(prefix + "resolve features", phaseStart);
+
+		// 恢复上次保存的配置快照，只写入变化的特征
+		const std::string snapshotPath = std::string(cameraSnapshotFolder) + "/" + deviceId + ".txt";
+		bool saveSnapshot = cameraSnapshotMode == CAMERA_SNAPSHOT_SAVE;
+		bool restored = false;
+		SnapshotNotes notes;
+		if (cameraSnapshotMode == CAMERA_SNAPSHOT_RESTORE)
+		{
+			SnapshotRestoreStats restoreStats;
+			phaseStart = std::chrono::steady_clock::now();
+			if (!fs::exists(snapshotPath))
+			{
+				cout << "No camera snapshot at " << snapshotPath << ", saving one after configuration..." << endl;
+				saveSnapshot = true;
+			}
+			else if (!RestoreCameraSnapshot(pCam, snapshotPath, restoreStats, &notes))
+			{
+				result = -1;
+			}
+			else
+			{
+				restored = true;
+			}
+			startup.Record(prefix + "snapshot restore", phaseStart);
+		}
 
-					// 缩小显示图像
-					cv::Mat resizedImage;
-					cv::resize(cvImage, resizedImage, cv::Size(), 0.2, 0.2); // 缩放比例根据需要设置
+		// 快照恢复成功且带有保存时的规划结果（和启用的 chunk）时，ROI 和 chunk 已由快照写好，不再探测和写入
+		phaseStart = std::chrono::steady_clock::now();
+		RoiPlan capturePlan;
+		const auto roiNote = notes.find("roi");
+		const auto chunkNote = notes.find("chunks");
+		const bool fromSnapshot = restored && roiNote != notes.end() && ParseRoiPlan(roiNote->second, capturePlan) &&
+								  (!enableChunkData || chunkNote != notes.end());
+		if (fromSnapshot)
+		{
+			cout << "ROI from snapshot: " << capturePlan.width << "x" << capturePlan.height << " "
+				 << capturePlan.pixelFormat << " bin " << capturePlan.binning << " dec " << capturePlan.decimation << endl;
+			if (enableChunkData)
+			{
+				chunkFields = static_cast<unsigned>(std::strtoul(chunkNote->second.c_str(), nullptr, 0));
+			}
+		}
+		else
+		{
+			// 按传感器实际尺寸和链路带宽选择 ROI、合并 / 抽取和像素格式，ROI 居中
+			result = result | ConfigureRoi(pCam, roiTarget, &capturePlan);
 
-					// 显示缩小后的图像
+			// chunk 会增大 PayloadSize，须在分配用户缓冲区之前启用
+			if (enableChunkData)
+			{
+				chunkFields = ConfigureChunkData(pCam);
+			}
+		}
 
-					try
-					{
-						// 显示图像
-						if (!cvImage.empty())
-						{
-							cv::imshow("Live View", resizedImage);
-						}
-						else
-						{
-							std::cerr << "cvImage is empty!" << std::endl;
-						}
+		// Set stream mode
+		result = result | SetStreamMode(features);
 
-						// 检查是否按下 ESC 键
-						int key = cv::waitKey(1);
-						auto make_filename = [&](int id)
-						{
-							std::ostringstream filename;
-							if (group_name.empty())
-								filename << save_folder << "/" << id << ".png";
-							else
-								filename << save_folder << "/" << group_name << "_" << id << ".png";
-							return filename.str();
-						};
-
-						if (key == 27) // ESC 键
-						{
-							cout << "ESC pressed, exiting..." << endl;
-							break;
-						}
-						else if (key == 32) // space 保存图像
-						{
-							cv::imwrite(make_filename(group_id), cvImage);
-							cout << "Saved: " << group_id << endl;
+		// 流缓冲策略（须在配置用户缓冲区之前，缓冲区按这里的数量分配）
+		result = result | SetStreamBufferPolicy(features);
 
-							group_id++;
-						}
-						else if (key == 8 || key == 127) // 删除键
-						{
-							if (group_id > 0)
-							{
-								int delete_id = group_id - 1;
+		// 可选：使用自行分配的采集缓冲区
+		if (useUserBufferArena && ConfigureUserBuffers(pCam, arena, useHugePages) != 0)
+		{
+			cout << "Falling back to library-owned buffers..." << endl;
+		}
 
-								if (fs::exists(make_filename(delete_id)))
-								{
-									fs::remove(make_filename(delete_id));
-									cout << "Deleted: " << make_filename(delete_id) << endl;
-									group_id--;
-								}
-								else
-								{
-									cout << "No such file to delete: " << make_filename(delete_id) << endl;
-								}
-							}
-							else
-							{
-								cout << "No images to delete" << endl;
-							}
-						}
-					}
-					catch (cv::Exception &e)
-					{
-						std::cerr << "OpenCV error: " << e.what() << std::endl;
-						break; // 或者 return -1;
-					}
-				}
+		// 设置采集模式为连续
+		if (features.Set(FEATURE_ACQUISITION_MODE, "Continuous"))
+		{
+			cout << "Acquisition mode set to continuous..." << endl;
+		}
+		else
+		{
+			cout << "Error: cannot set acquisition mode to continuous." << endl;
+			result = -1;
+		}
 
-				// 释放图像缓冲
-				pResultImage->Release();
+		// 快照保存全分辨率配置（切到预览之前），附带规划结果，恢复时可跳过规划
+		if (saveSnapshot)
+		{
+			SnapshotNotes saveNotes;
+			saveNotes["roi"] = FormatRoiPlan(capturePlan);
+			if (enableChunkData)
+			{
+				saveNotes["chunks"] = std::to_string(chunkFields);
 			}
-			catch (Spinnaker::Exception &e)
+			if (!SaveCameraSnapshot(pCam, snapshotPath, saveNotes))
 			{
-				cout << "Image error: " << e.what() << endl;
+				result = -1;
 			}
 		}
 
-		// 停止采集
-		pCam->EndAcquisition();
-		cv::destroyAllWindows();
+		// 用户缓冲区已按全分辨率的 PayloadSize 分配，抓拍时不必重新分配
+		if (capture != nullptr)
+		{
+			result = result | capture->Prepare(pCam, capturePlan, previewTarget);
+		}
+
+		startup.Record(prefix + "configure", phaseStart);
+
+		cout << "Camera " << deviceId << " configured in "
+			 << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() << " ms" << endl;
 	}
 	catch (Spinnaker::Exception &e)
 	{
@@ -239,34 +1767,71 @@ int AcquireImages(CameraPtr pCam, INodeMap &nodeMap, INodeMap &nodeMapTLDevice)
 	return result;
 }
 
-int PrintDeviceInfo(INodeMap &nodeMap)
+// 相机重新接入后重新初始化：恢复启动时缓存的配置快照（没有缓存时按 roiTarget 重新配置，再切到预览配置），
+// 再设置流模式和流缓冲。allowUserBuffers 为 false 时还有帧引用着原来的用户缓冲区，改用 SDK 缓冲
+int ReconnectCamera(CameraPtr pCam, CameraFeatures &features, BufferArena &arena, const std::string &cachedConfig,
+					bool allowUserBuffers, TriggeredCapture *capture)
 {
 	int result = 0;
-	cout << endl
-		 << "*** DEVICE INFORMATION ***" << endl
-		 << endl;
+	const auto start = std::chrono::steady_clock::now();
 
 	try
 	{
-		FeatureList_t features;
-		const CCategoryPtr category = nodeMap.GetNode("DeviceInformation");
-		if (IsReadable(category))
+		if (!pCam->IsInitialized())
 		{
-			category->GetFeatures(features);
+			pCam->Init();
+		}
+		if (!features.Resolve(pCam))
+		{
+			result = -1;
+		}
 
-			for (auto it = features.begin(); it != features.end(); ++it)
+		if (!cachedConfig.empty())
+		{
+			SnapshotRestoreStats restoreStats;
+			if (!ApplyCameraSnapshot(pCam, cachedConfig, restoreStats))
 			{
-				const CNodePtr pfeatureNode = *it;
-				cout << pfeatureNode->GetName() << " : ";
-				CValuePtr pValue = static_cast<CValuePtr>(pfeatureNode);
-				cout << (IsReadable(pValue) ? pValue->ToString() : "Node not readable");
-				cout << endl;
+				result = -1;
 			}
 		}
 		else
 		{
-			cout << "Device control information not available." << endl;
+			RoiPlan capturePlan;
+			result = result | ConfigureRoi(pCam, roiTarget, &capturePlan);
+			if (!features.Set(FEATURE_ACQUISITION_MODE, "Continuous"))
+			{
+				cout << "Error: cannot set acquisition mode to continuous." << endl;
+				result = -1;
+			}
+			if (capture != nullptr)
+			{
+				result = result | capture->Prepare(pCam, capturePlan, previewTarget);
+			}
+		}
+
+		if (enableChunkData)
+		{
+			ConfigureChunkData(pCam);
+		}
+
+		// 流节点不在快照中
+		result = result | SetStreamMode(features);
+		result = result | SetStreamBufferPolicy(features);
+
+		if (useUserBufferArena)
+		{
+			if (!allowUserBuffers)
+			{
+				cout << "Previous user buffers still in use, keeping library-owned buffers..." << endl;
+			}
+			else if (ConfigureUserBuffers(pCam, arena, useHugePages) != 0)
+			{
+				cout << "Falling back to library-owned buffers..." << endl;
+			}
 		}
+
+		cout << "Camera " << pCam->GetDeviceID() << " reinitialized in "
+			 << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() << " ms" << endl;
 	}
 	catch (Spinnaker::Exception &e)
 	{
@@ -277,62 +1842,189 @@ int PrintDeviceInfo(INodeMap &nodeMap)
 	return result;
 }
 
-int RunSingleCamera(CameraPtr pCam)
+// 同时运行所有检测到的相机：并行初始化，每个相机独立抓图，共用显示循环和写盘线程池。
+// 设备信息的打印不在启动路径上，放到后台线程
+int RunCameras(SystemPtr system, CameraList &camList, const SessionSettings &settings, StartupTrace &startup)
 {
-	int result;
+	int result = 0;
+	const unsigned int numCameras = camList.GetSize();
+
+	std::vector<CameraPtr> cameras(numCameras);
+	std::vector<std::string> deviceIds(numCameras);
+	std::vector<int> configResults(numCameras, -1);
+	std::vector<unsigned> chunkFields(numCameras, 0);
+
+	// 用户缓冲区必须在 DeInit() 之后才能释放，每个相机一块
+	std::unique_ptr<BufferArena[]> arenas(new BufferArena[numCameras]);
+	std::unique_ptr<CameraFeatures[]> features(new CameraFeatures[numCameras]);
+	// 预览 / 抓拍切换，持有 cameras[i] 的地址（重连时替换的 CameraPtr 也能看到）
+	std::vector<std::unique_ptr<TriggeredCapture>> captures(numCameras);
+	std::thread deviceInfoThread;
+	int deviceInfoResult = 0;
+
+	// 重连用的配置快照在后台缓存；重连时抓图线程会替换 cameras[i]
+	std::vector<std::string> cachedConfigs(numCameras);
+	std::mutex configMutex;
+	std::thread snapshotThread;
+	std::vector<ReconnectingSource *> reconnecting(numCameras, nullptr);
+	std::vector<CameraPtr> arrivedCameras(numCameras);
+	std::mutex arrivedMutex;
 
 	try
 	{
-		// Retrieve TL device nodemap and print device information
-		INodeMap &nodeMapTLDevice = pCam->GetTLDeviceNodeMap();
-		result = PrintDeviceInfo(nodeMapTLDevice);
+		for (unsigned int i = 0; i < numCameras; i++)
+		{
+			cameras[i] = camList.GetByIndex(i);
+			deviceIds[i] = cameras[i]->GetDeviceID().c_str();
+			cout << "Camera " << i << ": " << deviceIds[i] << endl;
+			if (previewCapture)
+			{
+				captures[i].reset(new TriggeredCapture(features[i], captureTriggerSelector, captureTriggerSource));
+			}
+		}
 
-		// Initialize camera
-		pCam->Init();
+		// Retrieve TL device nodemaps and print device information in one block once all are read
+		deviceInfoThread = std::thread(
+			[&, cameras]
+			{
+				const auto phaseStart = std::chrono::steady_clock::now();
+				std::ostringstream info;
+				for (unsigned int i = 0; i < numCameras; i++)
+				{
+					info << endl << "Camera " << i << ": " << deviceIds[i];
+					deviceInfoResult = deviceInfoResult | PrintDeviceInfo(cameras[i]->GetTLDeviceNodeMap(), info);
+				}
+				startup.Record("device info (background)", phaseStart);
+				cout << info.str();
+			});
 
-		// Retrieve GenICam nodemap
-		INodeMap &nodeMap = pCam->GetNodeMap();
-		//===========================================================================
-		// 设置分辨率为 2048x2048
-		CIntegerPtr ptrWidth = nodeMap.GetNode("Width");
-		CIntegerPtr ptrHeight = nodeMap.GetNode("Height");
-		CIntegerPtr ptrOffsetX = nodeMap.GetNode("OffsetX");
-		CIntegerPtr ptrOffsetY = nodeMap.GetNode("OffsetY");
+		// 各相机的 Init() 和节点配置互不依赖，并行进行
+		std::vector<std::thread> configThreads;
+		for (unsigned int i = 0; i < numCameras; i++)
+		{
+			configThreads.emplace_back(
+				[&, i] { configResults[i] = ConfigureCamera(cameras[i], features[i], arenas[i], startup, chunkFields[i], captures[i].get()); });
+		}
+		for (std::thread &thread : configThreads)
+		{
+			thread.join();
+		}
 
-		if (IsWritable(ptrWidth) && IsWritable(ptrHeight))
+		if (reconnectCameras)
 		{
-			// 设置宽度和高度为 2048
-			ptrWidth->SetValue(2048);
-			ptrHeight->SetValue(2048);
-			cout << "Resolution set to 2048x2048..." << endl;
+			snapshotThread = std::thread(
+				[&, cameras]
+				{
+					for (unsigned int i = 0; i < numCameras; i++)
+					{
+						std::lock_guard<std::mutex> lock(configMutex);
+						if (cameras[i]->IsInitialized() && !CaptureCameraSnapshot(cameras[i], cachedConfigs[i]))
+						{
+							cout << "Cannot cache configuration of " << deviceIds[i] << ", it will be reconfigured from defaults on reconnect" << endl;
+						}
+					}
+				});
+		}
 
-			// 设置 偏移量，保证选取的 2048×2048 在传感器中心
-			if (IsWritable(ptrOffsetX) && IsWritable(ptrOffsetY))
+		// 只要初始化成功就参与采集（与单相机时一致，部分设置失败只影响返回值）
+		std::vector<std::unique_ptr<FrameSource>> sources;
+		std::vector<AcquisitionSource> targets;
+		for (unsigned int i = 0; i < numCameras; i++)
+		{
+			result = result | configResults[i];
+			if (!cameras[i]->IsInitialized())
 			{
-				// 计算居中偏移：(2448 - 2048) / 2 = 200, (2048 - 2048) / 2 = 0
-				ptrOffsetX->SetValue(200); // 水平居中
-				ptrOffsetY->SetValue(0);   // 垂直居中（高度无需偏移）
-				cout << "Offset set to X: " << ptrOffsetX->GetValue() << ", Y: " << ptrOffsetY->GetValue() << "..." << endl;
+				cout << "Skipping camera " << deviceIds[i] << " (initialization failed)" << endl;
+				continue;
 			}
-			else
+			std::unique_ptr<FrameSource> source = MakeCameraSource(cameras[i], &arenas[i]);
+			if (reconnectCameras)
+			{
+				// 掉线后在抓图线程中释放相机，重新接入时换成新的 CameraPtr 并恢复缓存的配置
+				auto connect = [&, i]() -> std::unique_ptr<FrameSource>
+				{
+					{
+						std::lock_guard<std::mutex> lock(arrivedMutex);
+						if (arrivedCameras[i])
+						{
+							cameras[i] = arrivedCameras[i];
+							arrivedCameras[i] = nullptr;
+						}
+					}
+					std::lock_guard<std::mutex> lock(configMutex);
+					ReconnectCamera(cameras[i], features[i], arenas[i], cachedConfigs[i], reconnecting[i]->Outstanding() == 0,
+									captures[i] && captures[i]->IsPrepared() ? captures[i].get() : nullptr);
+					if (!cameras[i]->IsInitialized())
+					{
+						return nullptr;
+					}
+					return MakeCameraSource(cameras[i], &arenas[i]);
+				};
+				auto disconnect = [&, i]
+				{
+					std::lock_guard<std::mutex> lock(configMutex);
+					features[i].Reset();
+					try
+					{
+						if (cameras[i]->IsInitialized())
+						{
+							cameras[i]->DeInit();
+						}
+					}
+					catch (Spinnaker::Exception &e)
+					{
+						cout << "Error: " << e.what() << endl;
+					}
+				};
+				reconnecting[i] = new ReconnectingSource(std::move(source), connect, disconnect, reconnectConfig);
+				source.reset(reconnecting[i]);
+			}
+			sources.push_back(std::move(source));
+			targets.push_back(AcquisitionSource{sources.back().get(), deviceIds[i], &features[i], &startup, chunkFields[i]});
+			if (captures[i] && captures[i]->IsPrepared())
 			{
-				cout << "Warning: OffsetX or OffsetY not writable, ROI may not be centered." << endl;
+				targets.back().capture = captures[i].get();
 			}
 		}
-		else
+
+		// 设备接入 / 移除事件按 DeviceID 通知对应的来源，必须在来源销毁之前注销
+		std::unique_ptr<HotplugMonitor> monitor;
+		if (reconnectCameras && !targets.empty())
 		{
-			cout << "Error: Width or Height not writable, cannot set resolution to 2048x2048." << endl;
-			result = -1;
+			const auto phaseStart = std::chrono::steady_clock::now();
+			monitor.reset(new HotplugMonitor(system));
+			for (unsigned int i = 0; i < numCameras; i++)
+			{
+				ReconnectingSource *source = reconnecting[i];
+				if (source == nullptr)
+				{
+					continue;
+				}
+				monitor->Watch(
+					deviceIds[i],
+					[&, i, source](CameraPtr pCam)
+					{
+						{
+							std::lock_guard<std::mutex> lock(arrivedMutex);
+							arrivedCameras[i] = pCam;
+						}
+						source->NotifyArrival();
+					},
+					[source] { source->NotifyRemoval(); });
+			}
+			startup.Record("hot-plug events", phaseStart);
 		}
-		//===========================================================================
-		// Set stream mode
-		result = result | SetStreamMode(pCam);
 
-		// Acquire images
-		result = result | AcquireImages(pCam, nodeMap, nodeMapTLDevice);
-
-		// Deinitialize camera
-		pCam->DeInit();
+		if (targets.empty())
+		{
+			result = -1;
+		}
+		else
+		{
+			result = result | RunAcquisitionLoop(targets, settings, &startup);
+		}
+		monitor.reset();
+		sources.clear();
 	}
 	catch (Spinnaker::Exception &e)
 	{
@@ -340,6 +2032,35 @@ int RunSingleCamera(CameraPtr pCam)
 		result = -1;
 	}
 
+	if (deviceInfoThread.joinable())
+	{
+		deviceInfoThread.join();
+	}
+	if (snapshotThread.joinable())
+	{
+		snapshotThread.join();
+	}
+	result = result | deviceInfoResult;
+	arrivedCameras.clear();
+
+	// Deinitialize cameras
+	for (CameraPtr &pCam : cameras)
+	{
+		try
+		{
+			if (pCam && pCam->IsInitialized())
+			{
+				pCam->DeInit();
+			}
+		}
+		catch (Spinnaker::Exception &e)
+		{
+			cout << "Error: " << e.what() << endl;
+			result = -1;
+		}
+		pCam = nullptr;
+	}
+
 	return result;
 }
 
@@ -364,8 +2085,26 @@ int main(int /*argc*/, char ** /*argv*/)
 	cout << "Application build date: " << __DATE__ << " " << __TIME__ << endl
 		 << endl;
 
+	// 无相机模式不需要初始化 System
+	if (chosenFrameSource != FRAME_SOURCE_CAMERA)
+	{
+		int result = RunOfflineSource();
+
+		cout << endl
+			 << "Done! Press Enter to exit..." << endl;
+		getchar();
+
+		return result;
+	}
+
+	// 先询问命名和保存目录，启动计时从这里开始
+	const SessionSettings settings = PromptSessionSettings();
+	StartupTrace startup;
+
 	// Retrieve singleton reference to system object
+	auto phaseStart = std::chrono::steady_clock::now();
 	SystemPtr system = System::GetInstance();
+	startup.Record("System::GetInstance", phaseStart);
 
 	// Print out current library version
 	const LibraryVersion spinnakerLibraryVersion = system->GetLibraryVersion();
@@ -373,8 +2112,15 @@ int main(int /*argc*/, char ** /*argv*/)
 		 << "." << spinnakerLibraryVersion.type << "." << spinnakerLibraryVersion.build << endl
 		 << endl;
 
-	// Retrieve list of cameras from the system
-	CameraList camList = system->GetCameras();
+	// Retrieve list of cameras from the system. GetInstance() has already enumerated the interfaces,
+	// so only the cameras are updated; fall back to a full interface update if none are found
+	phaseStart = std::chrono::steady_clock::now();
+	CameraList camList = system->GetCameras(false, true);
+	if (camList.GetSize() == 0)
+	{
+		camList = system->GetCameras(true, true);
+	}
+	startup.Record("GetCameras", phaseStart);
 
 	const unsigned int numCameras = camList.GetSize();
 
@@ -397,21 +2143,10 @@ int main(int /*argc*/, char ** /*argv*/)
 		return -1;
 	}
 
-	CameraPtr pCam = nullptr;
-
-	int result = 0;
-
-	// 获取相机列表中的第一个相机
-	pCam = camList.GetByIndex(0);
-
-	cout << "Running example for camera 0..." << endl;
-
-	// 运行相机示例
-	result = RunSingleCamera(pCam);
-
-	cout << "Camera 0 example complete." << endl;
-
-	pCam = nullptr;
+	// 运行所有相机
+	cout << "Running example for " << numCameras << " camera(s)..." << endl;
+	int result = RunCameras(system, camList, settings, startup);
+	cout << "Camera example complete." << endl;
 
 	// Clear camera list before releasing system
 	camList.Clear();
@@ -0,0 +1,545 @@
+﻿#include "Spinnaker.h"
+#include "FrameRing.h"
+#include "FrameSource.h"
+#include "ImageSaver.h"
+#include "LatencyHistogram.h"
+#include "Mono8Converter.h"
+#include "PreviewDecimator.h"
+#include <opencv2/opencv.hpp>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace Spinnaker;
+using namespace std;
+
+// 无界面基准测试：用合成帧或回放文件驱动采集流水线，分别统计每个阶段的耗时
+// （抓图、各 ColorProcessingAlgorithm 的 Convert、缩放 / 整数倍缩小、PNG/JPEG/TIFF 编码），
+// 输出 p50/p99/p999 延迟和吞吐量（帧/秒、MB/秒），同时写出 JSON 便于比较回归。
+
+struct AlgorithmName
+{
+	ColorProcessingAlgorithm algorithm;
+	const char *name;
+};
+
+const AlgorithmName kAlgorithms[] = {
+	{SPINNAKER_COLOR_PROCESSING_ALGORITHM_NEAREST_NEIGHBOR, "NEAREST_NEIGHBOR"},
+	{SPINNAKER_COLOR_PROCESSING_ALGORITHM_NEAREST_NEIGHBOR_AVG, "NEAREST_NEIGHBOR_AVG"},
+	{SPINNAKER_COLOR_PROCESSING_ALGORITHM_BILINEAR, "BILINEAR"},
+	{SPINNAKER_COLOR_PROCESSING_ALGORITHM_EDGE_SENSING, "EDGE_SENSING"},
+	{SPINNAKER_COLOR_PROCESSING_ALGORITHM_HQ_LINEAR, "HQ_LINEAR"},
+	{SPINNAKER_COLOR_PROCESSING_ALGORITHM_IPP, "IPP"},
+	{SPINNAKER_COLOR_PROCESSING_ALGORITHM_DIRECTIONAL_FILTER, "DIRECTIONAL_FILTER"},
+	{SPINNAKER_COLOR_PROCESSING_ALGORITHM_RIGOROUS, "RIGOROUS"},
+	{SPINNAKER_COLOR_PROCESSING_ALGORITHM_WEIGHTED_DIRECTIONAL_FILTER, "WEIGHTED_DIRECTIONAL_FILTER"},
+};
+
+struct BenchOptions
+{
+	std::string source = "synthetic";
+	std::string replayFolder;
+	uint64_t frames = 100;
+	SyntheticConfig synthetic;
+	std::vector<AlgorithmName> algorithms;
+	double previewScale = 0.25;
+	int previewFactor = 4;
+	std::string jsonPath = "bench_results.json";
+};
+
+struct Stage
+{
+	std::string name;
+	LatencyHistogram latency;
+	uint64_t bytesIn = 0;
+	uint64_t bytesOut = 0;
+};
+
+// 按首次出现的顺序保存各阶段
+class StageTable
+{
+public:
+	Stage &Get(const std::string &name)
+	{
+		for (auto &stage : m_stages)
+		{
+			if (stage->name == name)
+			{
+				return *stage;
+			}
+		}
+		m_stages.emplace_back(new Stage());
+		m_stages.back()->name = name;
+		return *m_stages.back();
+	}
+
+	const std::vector<std::unique_ptr<Stage>> &Stages() const { return m_stages; }
+
+private:
+	std::vector<std::unique_ptr<Stage>> m_stages;
+};
+
+template <typename Func> void TimeStage(Stage &stage, uint64_t bytesIn, Func func)
+{
+	const auto t0 = std::chrono::steady_clock::now();
+	func();
+	const auto t1 = std::chrono::steady_clock::now();
+	stage.latency.Record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count()));
+	stage.bytesIn += bytesIn;
+}
+
+void PrintUsage()
+{
+	cout << "Usage: acquisition_bench [options]" << endl
+		 << "  --source synthetic|replay   frame source (default synthetic)" << endl
+		 << "  --replay <folder>           folder of recorded images for --source replay" << endl
+		 << "  --frames <n>                number of frames to process (default 100)" << endl
+		 << "  --size <w>x<h>              synthetic resolution (default 2048x2048)" << endl
+		 << "  --format <fmt>              synthetic format: mono8, mono16, bayerrg8, bayergb8, bayergr8, bayerbg8," << endl
+		 << "                              bayerrg16, bayergb16, bayergr16, bayerbg16 (default bayerrg8)" << endl
+		 << "  --noise <sigma>             synthetic noise standard deviation (default 4)" << endl
+		 << "  --algorithms <a,b,...|all>  color processing algorithms to time (default all)" << endl
+		 << "  --scale <s>                 preview resize factor (default 0.25)" << endl
+		 << "  --decimate <n>              preview integer decimation factor (default 4)" << endl
+		 << "  --json <file>               JSON output path (default bench_results.json)" << endl;
+}
+
+bool ParseFormat(const std::string &text, SyntheticConfig &config)
+{
+	static const struct
+	{
+		const char *name;
+		BayerPattern bayer;
+		bool sixteenBit;
+	} formats[] = {
+		{"mono8", BAYER_NONE, false},	  {"mono16", BAYER_NONE, true},		{"bayerrg8", BAYER_RG, false},
+		{"bayergb8", BAYER_GB, false},	  {"bayergr8", BAYER_GR, false},	{"bayerbg8", BAYER_BG, false},
+		{"bayerrg16", BAYER_RG, true},	  {"bayergb16", BAYER_GB, true},	{"bayergr16", BAYER_GR, true},
+		{"bayerbg16", BAYER_BG, true},
+	};
+	for (const auto &format : formats)
+	{
+		if (text == format.name)
+		{
+			config.bayer = format.bayer;
+			config.sixteenBit = format.sixteenBit;
+			return true;
+		}
+	}
+	return false;
+}
+
+bool ParseAlgorithms(const std::string &text, std::vector<AlgorithmName> &algorithms)
+{
+	algorithms.clear();
+	if (text == "all")
+	{
+		algorithms.assign(std::begin(kAlgorithms), std::end(kAlgorithms));
+		return true;
+	}
+
+	std::istringstream list(text);
+	std::string item;
+	while (std::getline(list, item, ','))
+	{
+		bool found = false;
+		for (const auto &algorithm : kAlgorithms)
+		{
+			if (item == algorithm.name)
+			{
+				algorithms.push_back(algorithm);
+				found = true;
+			}
+		}
+		if (!found)
+		{
+			cout << "Unknown algorithm: " << item << endl;
+			return false;
+		}
+	}
+	return true;
+}
+
+bool ParseOptions(int argc, char **argv, BenchOptions &options)
+{
+	options.synthetic.frameRate = 0.0; // 基准测试不限速
+	options.algorithms.assign(std::begin(kAlgorithms), std::end(kAlgorithms));
+
+	for (int i = 1; i < argc; i++)
+	{
+		const std::string arg = argv[i];
+		const bool hasValue = i + 1 < argc;
+		if (arg == "--help" || arg == "-h")
+		{
+			return false;
+		}
+		if (!hasValue)
+		{
+			cout << "Missing value for " << arg << endl;
+			return false;
+		}
+		const std::string value = argv[++i];
+
+		if (arg == "--source")
+		{
+			options.source = value;
+		}
+		else if (arg == "--replay")
+		{
+			options.replayFolder = value;
+		}
+		else if (arg == "--frames")
+		{
+			options.frames = std::stoull(value);
+		}
+		else if (arg == "--size")
+		{
+			const size_t x = value.find('x');
+			if (x == std::string::npos)
+			{
+				cout << "Invalid size: " << value << endl;
+				return false;
+			}
+			options.synthetic.width = std::stoul(value.substr(0, x));
+			options.synthetic.height = std::stoul(value.substr(x + 1));
+		}
+		else if (arg == "--format")
+		{
+			if (!ParseFormat(value, options.synthetic))
+			{
+				cout << "Unknown format: " << value << endl;
+				return false;
+			}
+		}
+		else if (arg == "--noise")
+		{
+			options.synthetic.noiseSigma = std::stod(value);
+		}
+		else if (arg == "--algorithms")
+		{
+			if (!ParseAlgorithms(value, options.algorithms))
+			{
+				return false;
+			}
+		}
+		else if (arg == "--scale")
+		{
+			options.previewScale = std::stod(value);
+		}
+		else if (arg == "--decimate")
+		{
+			options.previewFactor = std::stoi(value);
+		}
+		else if (arg == "--json")
+		{
+			options.jsonPath = value;
+		}
+		else
+		{
+			cout << "Unknown option: " << arg << endl;
+			return false;
+		}
+	}
+
+	if (options.source != "synthetic" && options.source != "replay")
+	{
+		cout << "Unknown source: " << options.source << endl;
+		return false;
+	}
+	if (options.source == "replay" && options.replayFolder.empty())
+	{
+		cout << "--source replay requires --replay <folder>" << endl;
+		return false;
+	}
+	return true;
+}
+
+bool IsBayer(PixelFormatEnums format)
+{
+	switch (format)
+	{
+	case PixelFormat_BayerRG8:
+	case PixelFormat_BayerGB8:
+	case PixelFormat_BayerGR8:
+	case PixelFormat_BayerBG8:
+	case PixelFormat_BayerRG16:
+	case PixelFormat_BayerGB16:
+	case PixelFormat_BayerGR16:
+	case PixelFormat_BayerBG16:
+		return true;
+	default:
+		return false;
+	}
+}
+
+double Milliseconds(uint64_t nanoseconds)
+{
+	return static_cast<double>(nanoseconds) / 1e6;
+}
+
+void PrintTable(const StageTable &table)
+{
+	cout << endl
+		 << std::left << std::setw(36) << "stage" << std::right << std::setw(8) << "frames" << std::setw(10) << "p50 ms"
+		 << std::setw(10) << "p99 ms" << std::setw(10) << "p999 ms" << std::setw(10) << "max ms" << std::setw(10) << "fps"
+		 << std::setw(10) << "MB/s" << std::setw(10) << "out KB" << endl;
+
+	cout << std::fixed << std::setprecision(2);
+	for (const auto &stage : table.Stages())
+	{
+		const LatencyHistogram &latency = stage->latency;
+		const double seconds = static_cast<double>(latency.Sum()) / 1e9;
+		const double fps = seconds > 0.0 ? static_cast<double>(latency.Count()) / seconds : 0.0;
+		const double mbps = seconds > 0.0 ? static_cast<double>(stage->bytesIn) / 1e6 / seconds : 0.0;
+		// 编码阶段每帧平均输出大小，其余阶段为空
+		const double outKb =
+			latency.Count() > 0 ? static_cast<double>(stage->bytesOut) / 1024.0 / static_cast<double>(latency.Count()) : 0.0;
+
+		cout << std::left << std::setw(36) << stage->name << std::right << std::setw(8) << latency.Count() << std::setw(10)
+			 << Milliseconds(latency.Percentile(0.5)) << std::setw(10) << Milliseconds(latency.Percentile(0.99))
+			 << std::setw(10) << Milliseconds(latency.Percentile(0.999)) << std::setw(10) << Milliseconds(latency.Max())
+			 << std::setw(10) << fps << std::setw(10) << mbps << std::setw(10);
+		if (stage->bytesOut > 0)
+		{
+			cout << outKb;
+		}
+		else
+		{
+			cout << "-";
+		}
+		cout << endl;
+	}
+	cout.unsetf(std::ios::fixed);
+}
+
+bool WriteJson(const std::string &path, const std::string &sourceName, uint64_t frames, double wallSeconds,
+			   const StageTable &table)
+{
+	std::ofstream json(path);
+	if (!json)
+	{
+		return false;
+	}
+
+	json << std::fixed << std::setprecision(4);
+	json << "{\n  \"source\": \"" << sourceName << "\",\n  \"frames\": " << frames << ",\n  \"wall_seconds\": " << wallSeconds
+		 << ",\n  \"stages\": [\n";
+
+	const auto &stages = table.Stages();
+	for (size_t i = 0; i < stages.size(); i++)
+	{
+		const Stage &stage = *stages[i];
+		const LatencyHistogram &latency = stage.latency;
+		const double seconds = static_cast<double>(latency.Sum()) / 1e9;
+
+		json << "    {\"name\": \"" << stage.name << "\", \"count\": " << latency.Count()
+			 << ", \"mean_ms\": " << latency.Mean() / 1e6 << ", \"p50_ms\": " << Milliseconds(latency.Percentile(0.5))
+			 << ", \"p99_ms\": " << Milliseconds(latency.Percentile(0.99))
+			 << ", \"p999_ms\": " << Milliseconds(latency.Percentile(0.999)) << ", \"max_ms\": " << Milliseconds(latency.Max())
+			 << ", \"fps\": " << (seconds > 0.0 ? static_cast<double>(latency.Count()) / seconds : 0.0)
+			 << ", \"mb_per_s\": " << (seconds > 0.0 ? static_cast<double>(stage.bytesIn) / 1e6 / seconds : 0.0)
+			 << ", \"bytes_out\": " << stage.bytesOut << "}" << (i + 1 < stages.size() ? "," : "") << "\n";
+	}
+	json << "  ]\n}\n";
+	return json.good();
+}
+
+int RunBench(const BenchOptions &options)
+{
+	std::unique_ptr<FrameSource> source;
+	if (options.source == "replay")
+	{
+		source.reset(new ReplaySource(options.replayFolder, 0.0, true));
+	}
+	else
+	{
+		source.reset(new SyntheticSource(options.synthetic));
+	}
+
+	StageTable table;
+	Stage &grabStage = table.Get("grab");
+	Stage &liveStage = table.Get("convert/Mono8 (live path)");
+
+	source->Start();
+	cout << "Benchmarking " << source->Name() << ", " << options.frames << " frames..." << endl;
+
+	// 与实时程序相同的帧环和 Mono8 转换路径
+	FrameRing ring(2, 2, [&source](const ImagePtr &image) { source->Release(image); });
+	Mono8Converter converter(SPINNAKER_COLOR_PROCESSING_ALGORITHM_HQ_LINEAR);
+	PreviewDecimator decimator(options.previewFactor);
+	cout << "Preview decimation 1/" << decimator.Factor() << " using " << PreviewDecimator::InstructionSet() << endl;
+
+	// 每种算法一个处理器和一个复用的 BGR8 目标图像
+	std::vector<ImageProcessor> processors(options.algorithms.size());
+	std::vector<ImagePtr> colorDest(options.algorithms.size());
+	for (size_t i = 0; i < options.algorithms.size(); i++)
+	{
+		processors[i].SetColorProcessing(options.algorithms[i].algorithm);
+		colorDest[i] = Image::Create();
+	}
+
+	// 实时程序可选的存图格式，按常用参数各测一次
+	static const SaveFormat encoders[] = {
+		{SAVE_PNG, 1, cv::IMWRITE_PNG_STRATEGY_DEFAULT, 1, 95},
+		{SAVE_PNG, 6, cv::IMWRITE_PNG_STRATEGY_DEFAULT, 1, 95},
+		{SAVE_PNG, 1, cv::IMWRITE_PNG_STRATEGY_RLE, 1, 95},
+		{SAVE_PNG, 1, cv::IMWRITE_PNG_STRATEGY_DEFAULT, 1, 95, 0},
+		{SAVE_PNG, 6, cv::IMWRITE_PNG_STRATEGY_DEFAULT, 1, 95, 0},
+		{SAVE_TIFF, 1, cv::IMWRITE_PNG_STRATEGY_DEFAULT, 1, 95},
+		{SAVE_TIFF, 1, cv::IMWRITE_PNG_STRATEGY_DEFAULT, 5, 95},
+		{SAVE_PGM, 1, cv::IMWRITE_PNG_STRATEGY_DEFAULT, 1, 95},
+		{SAVE_RAW, 1, cv::IMWRITE_PNG_STRATEGY_DEFAULT, 1, 95},
+		{SAVE_JPEG, 1, cv::IMWRITE_PNG_STRATEGY_DEFAULT, 1, 95},
+	};
+	std::vector<uchar> encoded;
+	ParallelPngEncoder parallelPng;
+	bool parallelPngChecked = false;
+	cv::Mat preview;
+	uint64_t processed = 0;
+	uint64_t skipped = 0;
+
+	const auto start = std::chrono::steady_clock::now();
+	while (processed < options.frames)
+	{
+		Frame frame;
+		std::string message;
+		GrabStatus status = GRAB_ERROR;
+		TimeStage(grabStage, 0, [&] { status = source->Grab(1000, frame, message); });
+
+		if (status != GRAB_OK)
+		{
+			if (status == GRAB_INCOMPLETE)
+			{
+				source->Release(frame.image);
+			}
+			if (++skipped > options.frames)
+			{
+				cout << "Too many failed grabs, stopping: " << message << endl;
+				break;
+			}
+			continue;
+		}
+
+		const uint64_t rawBytes = frame.image->GetImageSize();
+		grabStage.bytesIn += rawBytes;
+		ring.Push(std::move(frame));
+		FrameRef ref = ring.Latest();
+		if (!ref)
+		{
+			continue;
+		}
+
+		// 实时显示路径：原生 Mono8 零拷贝，否则转换
+		Mono8Frame mono;
+		TimeStage(liveStage, rawBytes, [&] { mono = converter.Convert(ref); });
+
+		// 各去马赛克算法转换为 BGR8（仅 Bayer 输入）
+		if (IsBayer(ref->image->GetPixelFormat()))
+		{
+			for (size_t i = 0; i < options.algorithms.size(); i++)
+			{
+				if (colorDest[i]->GetWidth() != ref->image->GetWidth() || colorDest[i]->GetHeight() != ref->image->GetHeight())
+				{
+					colorDest[i]->ResetImage(ref->image->GetWidth(), ref->image->GetHeight(), 0, 0, PixelFormat_BGR8);
+				}
+				Stage &stage = table.Get(std::string("convert/BGR8/") + options.algorithms[i].name);
+				TimeStage(stage, rawBytes, [&] { processors[i].Convert(ref->image, colorDest[i], PixelFormat_BGR8); });
+			}
+		}
+
+		// 预览缩放（与实时程序相同的默认插值）
+		const uint64_t monoBytes = static_cast<uint64_t>(mono.mat.total());
+		TimeStage(table.Get("resize"), monoBytes,
+				  [&] { cv::resize(mono.mat, preview, cv::Size(), options.previewScale, options.previewScale); });
+
+		// 实时程序使用的整数倍缩小：直接从原始帧（不经过整帧转换），以及从 Mono8 图像
+		if (decimator.SupportsFused(ref->image->GetPixelFormat()))
+		{
+			TimeStage(table.Get("decimate (fused)"), rawBytes, [&] { decimator.Decimate(ref->image); });
+		}
+		TimeStage(table.Get("decimate (Mono8)"), monoBytes, [&] { decimator.Decimate(mono.mat); });
+
+		// 各编码格式
+		for (const SaveFormat &format : encoders)
+		{
+			Stage &stage = table.Get("encode/" + format.Describe());
+			ParallelPngEncoder *encoder = format.pngThreads != 1 ? &parallelPng : nullptr;
+			TimeStage(stage, monoBytes, [&] { EncodeImage(format, mono.mat, encoded, encoder); });
+
+			// 条带并行编码的结果用 OpenCV 解码一次，确认与原图逐像素一致
+			if (encoder != nullptr && !parallelPngChecked)
+			{
+				const cv::Mat decoded = cv::imdecode(encoded, cv::IMREAD_UNCHANGED);
+				const bool same = decoded.rows == mono.mat.rows && decoded.cols == mono.mat.cols &&
+								  cv::norm(decoded, mono.mat, cv::NORM_INF) == 0.0;
+				cout << "Parallel PNG (" << parallelPng.Threads() << " threads"
+					 << (ParallelPngEncoder::Available() ? "" : ", OpenCV fallback") << ") round trip: "
+					 << (same ? "identical" : "MISMATCH") << endl;
+				parallelPngChecked = true;
+			}
+			stage.bytesOut += encoded.size();
+		}
+
+		processed++;
+	}
+	const double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	ring.Clear();
+	source->Stop();
+
+	PrintTable(table);
+	cout << endl
+		 << "Processed " << processed << " frames in " << wallSeconds << " s ("
+		 << (wallSeconds > 0.0 ? static_cast<double>(processed) / wallSeconds : 0.0) << " frames/s end to end)" << endl;
+
+	if (!WriteJson(options.jsonPath, source->Name(), processed, wallSeconds, table))
+	{
+		cout << "Failed to write " << options.jsonPath << endl;
+		return -1;
+	}
+	cout << "Results written to " << options.jsonPath << endl;
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	BenchOptions options;
+	bool parsed = false;
+	try
+	{
+		parsed = ParseOptions(argc, argv, options);
+	}
+	catch (std::exception &e)
+	{
+		// std::stoul 等解析失败
+		cout << "Invalid option value: " << e.what() << endl;
+	}
+	if (!parsed)
+	{
+		PrintUsage();
+		return -1;
+	}
+
+	int result = 0;
+	try
+	{
+		result = RunBench(options);
+	}
+	catch (Spinnaker::Exception &e)
+	{
+		cout << "Error: " << e.what() << endl;
+		result = -1;
+	}
+	catch (cv::Exception &e)
+	{
+		cout << "OpenCV error: " << e.what() << endl;
+		result = -1;
+	}
+	return result;
+}
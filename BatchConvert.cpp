@@ -0,0 +1,604 @@
+﻿#include "Spinnaker.h"
+#include "SessionFile.h"
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#if !defined(WIN32) && !defined(WIN64) && !defined(_WIN32)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace Spinnaker;
+using namespace std;
+
+namespace fs = std::filesystem;
+
+// 离线批量转换：采集时只保存原始 Bayer / Mono 数据（.spr 会话或 .raw/.si 文件），
+// 之后再用耗时的高质量去马赛克算法统一转换并编码为 PNG/TIFF/JPEG。
+// 每个工作线程独占一个 ImageProcessor 和可复用的目标图像，任务按窃取式队列分配，
+// 读取（预读下一帧）、转换、编码和写盘都在各自线程内完成，可扩展到全部核心。
+
+struct AlgorithmName
+{
+	ColorProcessingAlgorithm algorithm;
+	const char *name;
+};
+
+const AlgorithmName kAlgorithms[] = {
+	{SPINNAKER_COLOR_PROCESSING_ALGORITHM_NEAREST_NEIGHBOR, "NEAREST_NEIGHBOR"},
+	{SPINNAKER_COLOR_PROCESSING_ALGORITHM_NEAREST_NEIGHBOR_AVG, "NEAREST_NEIGHBOR_AVG"},
+	{SPINNAKER_COLOR_PROCESSING_ALGORITHM_BILINEAR, "BILINEAR"},
+	{SPINNAKER_COLOR_PROCESSING_ALGORITHM_EDGE_SENSING, "EDGE_SENSING"},
+	{SPINNAKER_COLOR_PROCESSING_ALGORITHM_HQ_LINEAR, "HQ_LINEAR"},
+	{SPINNAKER_COLOR_PROCESSING_ALGORITHM_IPP, "IPP"},
+	{SPINNAKER_COLOR_PROCESSING_ALGORITHM_DIRECTIONAL_FILTER, "DIRECTIONAL_FILTER"},
+	{SPINNAKER_COLOR_PROCESSING_ALGORITHM_RIGOROUS, "RIGOROUS"},
+	{SPINNAKER_COLOR_PROCESSING_ALGORITHM_WEIGHTED_DIRECTIONAL_FILTER, "WEIGHTED_DIRECTIONAL_FILTER"},
+};
+
+struct ConvertOptions
+{
+	std::string input;			// .spr 会话文件，或包含 .raw/.si 的文件夹
+	std::string outFolder;		// 默认为 <输入>_<格式>
+	std::string format = "png"; // png / tiff / jpg
+	AlgorithmName algorithm = {SPINNAKER_COLOR_PROCESSING_ALGORITHM_HQ_LINEAR, "HQ_LINEAR"};
+	PixelFormatEnums destFormat = PixelFormat_BGR8;
+	size_t threads = 0;			// 0 为全部核心
+	uint64_t first = 0;			// 帧范围 [first, last]（会话帧号或文件排序后的序号）
+	uint64_t last = UINT64_MAX;
+	bool scaling = false;		// 依次用 1、2、4 ... 个线程运行并比较吞吐量
+	bool noWrite = false;		// 只转换和编码，不写盘
+};
+
+void PrintUsage()
+{
+	cout << "Usage: batch_convert <session.spr|folder> [options]" << endl
+		 << "  --out <folder>              output folder (default <input>_<format>)" << endl
+		 << "  --format png|tiff|jpg       output format (default png)" << endl
+		 << "  --algorithm <name>          color processing algorithm (default HQ_LINEAR)" << endl
+		 << "  --pixel-format bgr8|mono8   converted pixel format (default bgr8)" << endl
+		 << "  --threads <n>               worker threads (default all cores)" << endl
+		 << "  --frames <a>-<b>            frame range to convert (default all)" << endl
+		 << "  --scaling                   run with 1, 2, 4 ... threads and report frames/s per core count" << endl
+		 << "  --no-write                  convert and encode only, do not write files" << endl;
+}
+
+bool ParseOptions(int argc, char **argv, ConvertOptions &options)
+{
+	if (argc < 2 || std::string(argv[1]) == "--help" || std::string(argv[1]) == "-h")
+	{
+		return false;
+	}
+	options.input = argv[1];
+
+	for (int i = 2; i < argc; i++)
+	{
+		const std::string arg = argv[i];
+		if (arg == "--scaling")
+		{
+			options.scaling = true;
+			continue;
+		}
+		if (arg == "--no-write")
+		{
+			options.noWrite = true;
+			continue;
+		}
+		if (i + 1 >= argc)
+		{
+			cout << "Missing value for " << arg << endl;
+			return false;
+		}
+		const std::string value = argv[++i];
+
+		if (arg == "--out")
+		{
+			options.outFolder = value;
+		}
+		else if (arg == "--format")
+		{
+			if (value != "png" && value != "tiff" && value != "jpg")
+			{
+				cout << "Unknown format: " << value << endl;
+				return false;
+			}
+			options.format = value;
+		}
+		else if (arg == "--algorithm")
+		{
+			const auto it = std::find_if(std::begin(kAlgorithms), std::end(kAlgorithms),
+										 [&](const AlgorithmName &algorithm) { return value == algorithm.name; });
+			if (it == std::end(kAlgorithms))
+			{
+				cout << "Unknown algorithm: " << value << endl;
+				return false;
+			}
+			options.algorithm = *it;
+		}
+		else if (arg == "--pixel-format")
+		{
+			if (value == "bgr8")
+			{
+				options.destFormat = PixelFormat_BGR8;
+			}
+			else if (value == "mono8")
+			{
+				options.destFormat = PixelFormat_Mono8;
+			}
+			else
+			{
+				cout << "Unknown pixel format: " << value << endl;
+				return false;
+			}
+		}
+		else if (arg == "--threads")
+		{
+			options.threads = static_cast<size_t>(std::stoul(value));
+		}
+		else if (arg == "--frames")
+		{
+			const size_t dash = value.find('-');
+			options.first = std::stoull(value.substr(0, dash));
+			options.last = dash == std::string::npos ? options.first : std::stoull(value.substr(dash + 1));
+		}
+		else
+		{
+			cout << "Unknown option: " << arg << endl;
+			return false;
+		}
+	}
+
+	if (options.threads == 0)
+	{
+		options.threads = std::max(1u, std::thread::hardware_concurrency());
+	}
+	if (options.outFolder.empty())
+	{
+		fs::path path(options.input);
+		if (!path.has_filename())
+		{
+			path = path.parent_path(); // 去掉末尾的分隔符
+		}
+		options.outFolder = (path.parent_path() / (path.stem().string() + "_" + options.format)).string();
+	}
+	return true;
+}
+
+// 待转换的原始帧：会话文件中的帧，或文件夹中的 .raw/.si 文件
+class BatchInput
+{
+public:
+	bool Open(const std::string &path)
+	{
+		if (fs::is_directory(path))
+		{
+			for (const auto &entry : fs::directory_iterator(path))
+			{
+				const std::string ext = entry.path().extension().string();
+				if (entry.is_regular_file() && (ext == ".raw" || ext == ".si"))
+				{
+					m_files.push_back(entry.path());
+				}
+			}
+			std::sort(m_files.begin(), m_files.end());
+			return true;
+		}
+		m_isSession = true;
+		return m_reader.Open(path);
+	}
+
+	size_t Count() const { return m_isSession ? m_reader.FrameCount() : m_files.size(); }
+
+	std::string Describe() const
+	{
+		std::ostringstream text;
+		if (m_isSession)
+		{
+			text << "session " << m_reader.Header().deviceId << ", " << m_reader.FrameCount() << " frames";
+		}
+		else
+		{
+			text << m_files.size() << " raw files";
+		}
+		return text.str();
+	}
+
+	// 会话帧直接包装映射区，文件由 Image::Load 读入；任意线程可同时调用
+	ImagePtr Load(size_t index) const
+	{
+		if (m_isSession)
+		{
+			return m_reader.ToImage(index);
+		}
+		return Image::Load(m_files[index].string().c_str());
+	}
+
+	// 让系统在后台读入下一项，当前帧转换期间磁盘读取同时进行
+	void Prefetch(size_t index) const
+	{
+		if (m_isSession)
+		{
+			m_reader.Prefetch(index);
+			return;
+		}
+#if !defined(WIN32) && !defined(WIN64) && !defined(_WIN32)
+		const int fd = open(m_files[index].c_str(), O_RDONLY);
+		if (fd >= 0)
+		{
+			posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+			close(fd);
+		}
+#endif
+	}
+
+	std::string OutputStem(size_t index) const
+	{
+		if (m_isSession)
+		{
+			std::ostringstream name;
+			name << std::setw(6) << std::setfill('0') << m_reader.FrameHeader(index).frameIndex;
+			return name.str();
+		}
+		return m_files[index].stem().string();
+	}
+
+private:
+	bool m_isSession = false;
+	SessionReader m_reader;
+	std::vector<fs::path> m_files;
+};
+
+// 窃取式任务队列：每个工作线程先拿到一段连续的帧，从自己的队头取任务；
+// 自己的做完后从其他线程的队尾窃取，慢的线程（例如被系统调度走）不会拖慢整体。
+class WorkQueue
+{
+public:
+	WorkQueue(size_t workers, size_t first, size_t end)
+		: m_lanes(workers)
+	{
+		const size_t count = end - first;
+		for (size_t w = 0; w < workers; w++)
+		{
+			const size_t begin = first + count * w / workers;
+			const size_t stop = first + count * (w + 1) / workers;
+			for (size_t task = begin; task < stop; task++)
+			{
+				m_lanes[w].tasks.push_back(task);
+			}
+		}
+	}
+
+	bool Pop(size_t worker, size_t &task)
+	{
+		{
+			Lane &own = m_lanes[worker];
+			std::lock_guard<std::mutex> lock(own.mutex);
+			if (!own.tasks.empty())
+			{
+				task = own.tasks.front();
+				own.tasks.pop_front();
+				return true;
+			}
+		}
+
+		for (size_t i = 1; i < m_lanes.size(); i++)
+		{
+			Lane &victim = m_lanes[(worker + i) % m_lanes.size()];
+			std::lock_guard<std::mutex> lock(victim.mutex);
+			if (!victim.tasks.empty())
+			{
+				task = victim.tasks.back();
+				victim.tasks.pop_back();
+				m_steals.fetch_add(1, std::memory_order_relaxed);
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// 自己队列中的下一项，用于预读；可能随后被别的线程窃取，只影响预读是否命中
+	bool Peek(size_t worker, size_t &task)
+	{
+		Lane &own = m_lanes[worker];
+		std::lock_guard<std::mutex> lock(own.mutex);
+		if (own.tasks.empty())
+		{
+			return false;
+		}
+		task = own.tasks.front();
+		return true;
+	}
+
+	uint64_t Steals() const { return m_steals.load(std::memory_order_relaxed); }
+
+private:
+	struct Lane
+	{
+		std::mutex mutex;
+		std::deque<size_t> tasks;
+	};
+
+	std::vector<Lane> m_lanes;
+	std::atomic<uint64_t> m_steals{0};
+};
+
+struct WorkerStats
+{
+	uint64_t frames = 0;
+	uint64_t failed = 0;
+	uint64_t bytes = 0; // 写出的编码后字节数
+	int64_t loadUs = 0;
+	int64_t convertUs = 0;
+	int64_t encodeUs = 0;
+	int64_t writeUs = 0;
+};
+
+struct RunResult
+{
+	size_t threads = 0;
+	double seconds = 0.0;
+	uint64_t frames = 0;
+	uint64_t failed = 0;
+	uint64_t steals = 0;
+	WorkerStats total;
+};
+
+int64_t MicrosecondsSince(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+cv::Mat WrapImage(const ImagePtr &image)
+{
+	size_t stride = image->GetStride();
+	if (stride == 0)
+	{
+		stride = image->GetWidth() * image->GetBitsPerPixel() / 8 + image->GetXPadding();
+	}
+	const int type = image->GetPixelFormat() == PixelFormat_BGR8 ? CV_8UC3 : CV_8UC1;
+	return cv::Mat(static_cast<int>(image->GetHeight()), static_cast<int>(image->GetWidth()), type, image->GetData(),
+				   stride);
+}
+
+void ConvertWorker(const ConvertOptions &options, const BatchInput &input, WorkQueue &queue, size_t worker,
+				   WorkerStats &stats, std::mutex &logMutex)
+{
+	// 每个线程独占一个处理器和目标图像，Convert 之间没有共享状态
+	ImageProcessor processor;
+	processor.SetColorProcessing(options.algorithm.algorithm);
+	ImagePtr dest = Image::Create();
+	std::vector<uchar> encoded;
+	const std::string ext = "." + options.format;
+
+	size_t task;
+	while (queue.Pop(worker, task))
+	{
+		size_t next;
+		if (queue.Peek(worker, next))
+		{
+			input.Prefetch(next);
+		}
+
+		const std::string filename = options.outFolder + "/" + input.OutputStem(task) + ext;
+		try
+		{
+			auto start = std::chrono::steady_clock::now();
+			ImagePtr raw = input.Load(task);
+			stats.loadUs += MicrosecondsSince(start);
+
+			start = std::chrono::steady_clock::now();
+			ImagePtr converted = raw;
+			if (raw->GetPixelFormat() != options.destFormat)
+			{
+				if (dest->GetWidth() != raw->GetWidth() || dest->GetHeight() != raw->GetHeight())
+				{
+					dest->ResetImage(raw->GetWidth(), raw->GetHeight(), 0, 0, options.destFormat);
+				}
+				processor.Convert(raw, dest, options.destFormat);
+				converted = dest;
+			}
+			stats.convertUs += MicrosecondsSince(start);
+
+			start = std::chrono::steady_clock::now();
+			const bool ok = cv::imencode(ext, WrapImage(converted), encoded);
+			stats.encodeUs += MicrosecondsSince(start);
+
+			if (ok && !options.noWrite)
+			{
+				start = std::chrono::steady_clock::now();
+				std::ofstream file(filename, std::ios::binary);
+				file.write(reinterpret_cast<const char *>(encoded.data()), encoded.size());
+				stats.writeUs += MicrosecondsSince(start);
+				if (!file)
+				{
+					throw std::runtime_error("write failed");
+				}
+			}
+			if (!ok)
+			{
+				throw std::runtime_error("encode failed");
+			}
+			stats.frames++;
+			stats.bytes += encoded.size();
+		}
+		catch (std::exception &e)
+		{
+			// Spinnaker::Exception、cv::Exception 都派生自 std::exception
+			stats.failed++;
+			std::lock_guard<std::mutex> lock(logMutex);
+			cout << "Failed to convert " << filename << ": " << e.what() << endl;
+		}
+	}
+}
+
+RunResult RunBatch(const ConvertOptions &options, const BatchInput &input, size_t first, size_t end, size_t threads)
+{
+	WorkQueue queue(threads, first, end);
+	std::vector<WorkerStats> stats(threads);
+	std::mutex logMutex;
+
+	const auto start = std::chrono::steady_clock::now();
+	std::vector<std::thread> workers;
+	for (size_t w = 0; w < threads; w++)
+	{
+		workers.emplace_back(ConvertWorker, std::cref(options), std::cref(input), std::ref(queue), w, std::ref(stats[w]),
+							 std::ref(logMutex));
+	}
+	for (auto &worker : workers)
+	{
+		worker.join();
+	}
+
+	RunResult result;
+	result.threads = threads;
+	result.seconds = MicrosecondsSince(start) / 1e6;
+	result.steals = queue.Steals();
+	for (const WorkerStats &worker : stats)
+	{
+		result.total.frames += worker.frames;
+		result.total.failed += worker.failed;
+		result.total.bytes += worker.bytes;
+		result.total.loadUs += worker.loadUs;
+		result.total.convertUs += worker.convertUs;
+		result.total.encodeUs += worker.encodeUs;
+		result.total.writeUs += worker.writeUs;
+	}
+	result.frames = result.total.frames;
+	result.failed = result.total.failed;
+	return result;
+}
+
+void PrintResult(const RunResult &result)
+{
+	const double fps = result.seconds > 0.0 ? result.frames / result.seconds : 0.0;
+	cout << result.frames << " frames in " << result.seconds << " s with " << result.threads << " threads: " << fps
+		 << " fps (" << fps / result.threads << " per thread), " << result.total.bytes / 1e6 << " MB written, "
+		 << result.steals << " stolen, " << result.failed << " failed" << endl;
+
+	if (result.frames > 0)
+	{
+		const double frames = static_cast<double>(result.frames);
+		cout << "  per frame: load " << result.total.loadUs / frames / 1000.0 << " ms, convert "
+			 << result.total.convertUs / frames / 1000.0 << " ms, encode " << result.total.encodeUs / frames / 1000.0
+			 << " ms, write " << result.total.writeUs / frames / 1000.0 << " ms" << endl;
+	}
+}
+
+int RunConvert(const ConvertOptions &options)
+{
+	BatchInput input;
+	if (!input.Open(options.input))
+	{
+		cout << "Failed to open " << options.input << endl;
+		return -1;
+	}
+
+	cout << options.input << ": " << input.Describe() << endl;
+	if (input.Count() == 0)
+	{
+		return 0;
+	}
+
+	const size_t first = static_cast<size_t>(std::min<uint64_t>(options.first, input.Count()));
+	const size_t end = static_cast<size_t>(std::min<uint64_t>(options.last, input.Count() - 1) + 1);
+	if (first >= end)
+	{
+		cout << "No frames in range" << endl;
+		return 0;
+	}
+
+	if (!options.noWrite)
+	{
+		std::error_code ec;
+		fs::create_directories(options.outFolder, ec);
+	}
+	cout << "Converting " << end - first << " frames with " << options.algorithm.name << " to " << options.format
+		 << (options.noWrite ? " (not writing)" : " in " + options.outFolder) << endl;
+
+	if (!options.scaling)
+	{
+		const RunResult result = RunBatch(options, input, first, end, options.threads);
+		PrintResult(result);
+		return result.failed == 0 ? 0 : -1;
+	}
+
+	// 1、2、4 ... 直到 --threads，最后一次总是 --threads 本身
+	std::vector<size_t> counts;
+	for (size_t threads = 1; threads < options.threads; threads *= 2)
+	{
+		counts.push_back(threads);
+	}
+	counts.push_back(options.threads);
+
+	std::vector<RunResult> results;
+	for (size_t threads : counts)
+	{
+		results.push_back(RunBatch(options, input, first, end, threads));
+		PrintResult(results.back());
+	}
+
+	const double baseFps = results.front().seconds > 0.0 ? results.front().frames / results.front().seconds : 0.0;
+	cout << endl
+		 << std::left << std::setw(10) << "threads" << std::setw(12) << "seconds" << std::setw(12) << "fps"
+		 << std::setw(16) << "fps/thread" << "speedup" << endl;
+	int status = 0;
+	for (const RunResult &result : results)
+	{
+		const double fps = result.seconds > 0.0 ? result.frames / result.seconds : 0.0;
+		cout << std::left << std::setw(10) << result.threads << std::setw(12) << result.seconds << std::setw(12) << fps
+			 << std::setw(16) << fps / result.threads << (baseFps > 0.0 ? fps / baseFps : 0.0) << endl;
+		if (result.failed != 0)
+		{
+			status = -1;
+		}
+	}
+	return status;
+}
+
+int main(int argc, char **argv)
+{
+	ConvertOptions options;
+	bool parsed = false;
+	try
+	{
+		parsed = ParseOptions(argc, argv, options);
+	}
+	catch (std::exception &e)
+	{
+		// std::stoull 等解析失败
+		cout << "Invalid option value: " << e.what() << endl;
+	}
+	if (!parsed)
+	{
+		PrintUsage();
+		return -1;
+	}
+
+	int result = 0;
+	try
+	{
+		result = RunConvert(options);
+	}
+	catch (Spinnaker::Exception &e)
+	{
+		cout << "Error: " << e.what() << endl;
+		result = -1;
+	}
+	catch (cv::Exception &e)
+	{
+		cout << "OpenCV error: " << e.what() << endl;
+		result = -1;
+	}
+	return result;
+}
@@ -0,0 +1,231 @@
+﻿#include "BufferArena.h"
+#include "SpinGenApi/SpinnakerGenApi.h"
+#include <cstring>
+#include <iostream>
+
+#if defined(WIN32) || defined(WIN64) || defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+using namespace Spinnaker;
+using namespace Spinnaker::GenApi;
+using namespace std;
+
+namespace
+{
+// USB3 包大小，每个缓冲需按它向上取整以免图像撕裂
+const uint64_t kUsb3PacketSize = 1024;
+const size_t kHugePageSize = 2 * 1024 * 1024;
+
+size_t RoundUp(size_t value, size_t alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+} // namespace
+
+BufferArena::~BufferArena()
+{
+	Free();
+}
+
+bool BufferArena::Allocate(size_t bytes, bool useHugePages)
+{
+	Free();
+
+#if defined(WIN32) || defined(WIN64) || defined(_WIN32)
+	// 大页需要 SeLockMemoryPrivilege，失败时退回普通页
+	const size_t largePage = GetLargePageMinimum();
+	if (useHugePages && largePage > 0)
+	{
+		const size_t size = RoundUp(bytes, largePage);
+		m_pData = VirtualAlloc(nullptr, size, MEM_COMMIT | MEM_RESERVE | MEM_LARGE_PAGES, PAGE_READWRITE);
+		if (m_pData != nullptr)
+		{
+			m_size = size;
+			m_hugePages = true;
+			m_locked = true; // 大页本身不可换出
+		}
+	}
+	if (m_pData == nullptr)
+	{
+		SYSTEM_INFO info;
+		GetSystemInfo(&info);
+		const size_t size = RoundUp(bytes, info.dwPageSize);
+		m_pData = VirtualAlloc(nullptr, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+		if (m_pData == nullptr)
+		{
+			return false;
+		}
+		m_size = size;
+
+		// 扩大工作集后再锁定，否则 VirtualLock 对大块内存会失败
+		SIZE_T minSet = 0;
+		SIZE_T maxSet = 0;
+		GetProcessWorkingSetSize(GetCurrentProcess(), &minSet, &maxSet);
+		SetProcessWorkingSetSize(GetCurrentProcess(), minSet + size, maxSet + size);
+		m_locked = VirtualLock(m_pData, size) != 0;
+	}
+#else
+	if (useHugePages)
+	{
+		const size_t size = RoundUp(bytes, kHugePageSize);
+		void *p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		if (p != MAP_FAILED)
+		{
+			m_pData = p;
+			m_size = size;
+			m_hugePages = true;
+		}
+	}
+	if (m_pData == nullptr)
+	{
+		const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+		const size_t size = RoundUp(bytes, useHugePages ? kHugePageSize : pageSize);
+		void *p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (p == MAP_FAILED)
+		{
+			return false;
+		}
+		m_pData = p;
+		m_size = size;
+#ifdef MADV_HUGEPAGE
+		// 没有预留大页时，尽量使用透明大页
+		if (useHugePages)
+		{
+			madvise(m_pData, m_size, MADV_HUGEPAGE);
+		}
+#endif
+	}
+	// 受 RLIMIT_MEMLOCK 限制可能失败，此时仍可使用，只是不保证常驻
+	m_locked = mlock(m_pData, m_size) == 0;
+#endif
+
+	// 预先触碰所有页，采集开始后不再产生缺页
+	if (!m_locked)
+	{
+		memset(m_pData, 0, m_size);
+	}
+	return true;
+}
+
+void BufferArena::Free()
+{
+	if (m_pData == nullptr)
+	{
+		return;
+	}
+#if defined(WIN32) || defined(WIN64) || defined(_WIN32)
+	if (m_locked && !m_hugePages)
+	{
+		VirtualUnlock(m_pData, m_size);
+	}
+	VirtualFree(m_pData, 0, MEM_RELEASE);
+#else
+	if (m_locked)
+	{
+		munlock(m_pData, m_size);
+	}
+	munmap(m_pData, m_size);
+#endif
+	m_pData = nullptr;
+	m_size = 0;
+	m_locked = false;
+	m_hugePages = false;
+}
+
+int ConfigureUserBuffers(CameraPtr pCam, BufferArena &arena, bool useHugePages)
+{
+	int result = 0;
+
+	try
+	{
+		INodeMap &nodeMap = pCam->GetNodeMap();
+		INodeMap &sNodeMap = pCam->GetTLStreamNodeMap();
+
+		// 单个缓冲大小：PayloadSize 按 USB3 包大小向上取整
+		// （GetUserBufferSize() 要在注册缓冲并开始采集之后才能读取，这里按同样的规则计算）
+		CIntegerPtr ptrPayloadSize = nodeMap.GetNode("PayloadSize");
+		if (!IsReadable(ptrPayloadSize))
+		{
+			cout << "PayloadSize not readable, keeping library-owned buffers..." << endl;
+			return -1;
+		}
+		const uint64_t payloadSize = static_cast<uint64_t>(ptrPayloadSize->GetValue());
+		const uint64_t bufferSize = (payloadSize + kUsb3PacketSize - 1) / kUsb3PacketSize * kUsb3PacketSize;
+
+		// 缓冲数量：使用 StreamBufferCountManual，需先切到手动模式
+		CEnumerationPtr ptrCountMode = sNodeMap.GetNode("StreamBufferCountMode");
+		if (IsWritable(ptrCountMode))
+		{
+			CEnumEntryPtr ptrCountModeManual = ptrCountMode->GetEntryByName("Manual");
+			if (IsReadable(ptrCountModeManual))
+			{
+				ptrCountMode->SetIntValue(ptrCountModeManual->GetValue());
+			}
+		}
+		CIntegerPtr ptrBufferCount = sNodeMap.GetNode("StreamBufferCountManual");
+		if (!IsReadable(ptrBufferCount))
+		{
+			cout << "StreamBufferCountManual not readable, keeping library-owned buffers..." << endl;
+			return -1;
+		}
+		const uint64_t bufferCount = static_cast<uint64_t>(ptrBufferCount->GetValue());
+
+		if (!arena.Allocate(static_cast<size_t>(bufferSize * bufferCount), useHugePages))
+		{
+			cout << "Failed to allocate " << bufferSize * bufferCount << " bytes for user buffers..." << endl;
+			return -1;
+		}
+
+		pCam->SetBufferOwnership(SPINNAKER_BUFFER_OWNERSHIP_USER);
+		pCam->SetUserBuffers(arena.Data(), arena.Size());
+
+		cout << "User buffers: " << bufferCount << " x " << bufferSize << " bytes, arena " << arena.Size() << " bytes"
+			 << (arena.IsHugePages() ? ", huge pages" : "") << (arena.IsLocked() ? ", locked" : ", not locked")
+			 << "..." << endl;
+	}
+	catch (Spinnaker::Exception &e)
+	{
+		cout << "Error: " << e.what() << endl;
+
+		// 退回库管理的缓冲
+		try
+		{
+			pCam->SetBufferOwnership(SPINNAKER_BUFFER_OWNERSHIP_SYSTEM);
+		}
+		catch (Spinnaker::Exception &)
+		{
+		}
+		arena.Free();
+		result = -1;
+	}
+
+	return result;
+}
+
+void PrintArenaUtilization(CameraPtr pCam, const BufferArena &arena)
+{
+	if (arena.Data() == nullptr || arena.Size() == 0)
+	{
+		return;
+	}
+
+	try
+	{
+		const uint64_t count = pCam->GetUserBufferCount();
+		const uint64_t size = pCam->GetUserBufferSize();
+		const uint64_t used = count * size;
+		cout << "Arena utilization: " << count << " buffers x " << size << " bytes = " << used << " / " << arena.Size()
+			 << " bytes (" << 100.0 * static_cast<double>(used) / static_cast<double>(arena.Size()) << "%)" << endl;
+	}
+	catch (Spinnaker::Exception &e)
+	{
+		cout << "Error: " << e.what() << endl;
+	}
+}
@@ -0,0 +1,38 @@
+﻿#pragma once
+
+#include "Spinnaker.h"
+#include <cstddef>
+#include <cstdint>
+
+// 一块连续、按页对齐并锁定在物理内存中的采集缓冲区（可选大页），
+// 通过 SetUserBuffers() 交给 SDK 作为流缓冲，避免采集过程中的缺页和分配抖动。
+class BufferArena
+{
+public:
+	BufferArena() = default;
+	~BufferArena();
+
+	BufferArena(const BufferArena &) = delete;
+	BufferArena &operator=(const BufferArena &) = delete;
+
+	bool Allocate(size_t bytes, bool useHugePages);
+	void Free();
+
+	void *Data() const { return m_pData; }
+	size_t Size() const { return m_size; }
+	bool IsLocked() const { return m_locked; }
+	bool IsHugePages() const { return m_hugePages; }
+
+private:
+	void *m_pData = nullptr;
+	size_t m_size = 0;
+	bool m_locked = false;
+	bool m_hugePages = false;
+};
+
+// 在 BeginAcquisition() 之前调用：按 PayloadSize 和 StreamBufferCountManual 分配缓冲区，
+// 并以 SPINNAKER_BUFFER_OWNERSHIP_USER 方式注册给相机。arena 必须活到 DeInit() 之后。
+int ConfigureUserBuffers(Spinnaker::CameraPtr pCam, BufferArena &arena, bool useHugePages);
+
+// 在 BeginAcquisition() 之后调用：打印 SDK 实际使用的缓冲数量、大小和利用率
+void PrintArenaUtilization(Spinnaker::CameraPtr pCam, const BufferArena &arena);
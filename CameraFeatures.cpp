@@ -0,0 +1,480 @@
+﻿#include "CameraFeatures.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+using namespace Spinnaker;
+using namespace Spinnaker::GenApi;
+using namespace std;
+
+namespace
+{
+// 节点名称及所在节点图（false 为相机节点图，true 为 TL 流节点图），顺序与枚举一致。
+// alternative 为较早固件使用的名称，name 不存在时再找它
+struct FeatureName
+{
+	const char *name;
+	bool stream;
+	const char *alternative = nullptr;
+};
+
+const FeatureName kIntegerNames[INTEGER_FEATURE_COUNT] = {
+	{"Width", false},
+	{"Height", false},
+	{"OffsetX", false},
+	{"OffsetY", false},
+	{"BinningHorizontal", false},
+	{"BinningVertical", false},
+	{"DecimationHorizontal", false},
+	{"DecimationVertical", false},
+	{"PayloadSize", false},
+	{"DeviceLinkThroughputLimit", false},
+	{"StreamBufferCountManual", true},
+	{"StreamLostFrameCount", true},
+	{"StreamDroppedFrameCount", true},
+	{"StreamInputBufferCount", true},
+	{"StreamAnnouncedBufferCount", true},
+	{"StreamBlocksReceptionTimeLast", true},
+	{"StreamBlocksReceptionTimeMin", true},
+	{"StreamBlocksReceptionTimeMax", true},
+	{"StreamBlocksProcessingTimeLast", true},
+	{"StreamBlocksProcessingTimeMin", true},
+	{"StreamBlocksProcessingTimeMax", true},
+};
+
+const FeatureName kFloatNames[FLOAT_FEATURE_COUNT] = {
+	{"ExposureTime", false},
+	{"Gain", false},
+	{"AcquisitionFrameRate", false},
+	{"AcquisitionResultingFrameRate", false},
+};
+
+const FeatureName kEnumNames[ENUM_FEATURE_COUNT] = {
+	{"AcquisitionMode", false},
+	{"PixelFormat", false},
+	{"ExposureAuto", false},
+	{"GainAuto", false},
+	{"TriggerSelector", false},
+	{"TriggerMode", false},
+	{"TriggerSource", false},
+	{"StreamMode", true},
+	{"StreamBufferHandlingMode", true},
+	{"StreamBufferCountMode", true},
+};
+
+const FeatureName kBooleanNames[BOOLEAN_FEATURE_COUNT] = {
+	{"AcquisitionFrameRateEnable", false, "AcquisitionFrameRateEnabled"},
+};
+
+const FeatureName kCommandNames[COMMAND_FEATURE_COUNT] = {
+	{"TriggerSoftware", false},
+};
+
+INodeMap &MapFor(CameraPtr pCam, const FeatureName &feature)
+{
+	return feature.stream ? pCam->GetTLStreamNodeMap() : pCam->GetNodeMap();
+}
+
+INode *Lookup(CameraPtr pCam, const FeatureName &feature)
+{
+	INode *node = MapFor(pCam, feature).GetNode(feature.name);
+	if (node == nullptr && feature.alternative != nullptr)
+	{
+		node = MapFor(pCam, feature).GetNode(feature.alternative);
+	}
+	return node;
+}
+} // namespace
+
+bool CameraFeatures::Resolve(CameraPtr pCam)
+{
+	const auto start = std::chrono::steady_clock::now();
+	size_t resolved = 0;
+	size_t entries = 0;
+	std::lock_guard<std::recursive_mutex> lock(m_mutex);
+
+	try
+	{
+		for (int i = 0; i < INTEGER_FEATURE_COUNT; i++)
+		{
+			m_integers[i] = MapFor(pCam, kIntegerNames[i]).GetNode(kIntegerNames[i].name);
+			resolved += m_integers[i] ? 1 : 0;
+		}
+		for (int i = 0; i < FLOAT_FEATURE_COUNT; i++)
+		{
+			m_floats[i] = MapFor(pCam, kFloatNames[i]).GetNode(kFloatNames[i].name);
+			resolved += m_floats[i] ? 1 : 0;
+		}
+		for (int i = 0; i < ENUM_FEATURE_COUNT; i++)
+		{
+			m_enums[i] = MapFor(pCam, kEnumNames[i]).GetNode(kEnumNames[i].name);
+			m_entries[i].clear();
+			if (!m_enums[i])
+			{
+				continue;
+			}
+			resolved++;
+
+			// 缓存全部枚举项：有些项要在改了别的特征（合并、ADC 位深等）之后才可用，写入时再检查
+			NodeList_t nodes;
+			m_enums[i]->GetEntries(nodes);
+			for (INode *node : nodes)
+			{
+				CEnumEntryPtr ptrEntry = node;
+				if (ptrEntry)
+				{
+					m_entries[i][ptrEntry->GetSymbolic().c_str()] = EnumEntry{ptrEntry->GetValue(), ptrEntry};
+					entries++;
+				}
+			}
+		}
+		for (int i = 0; i < BOOLEAN_FEATURE_COUNT; i++)
+		{
+			m_booleans[i] = Lookup(pCam, kBooleanNames[i]);
+			resolved += m_booleans[i] ? 1 : 0;
+		}
+		for (int i = 0; i < COMMAND_FEATURE_COUNT; i++)
+		{
+			m_commands[i] = MapFor(pCam, kCommandNames[i]).GetNode(kCommandNames[i].name);
+			resolved += m_commands[i] ? 1 : 0;
+		}
+	}
+	catch (Spinnaker::Exception &e)
+	{
+		cout << "Error: " << e.what() << endl;
+		return false;
+	}
+
+	m_resolveMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	m_resolved = true;
+	cout << "Resolved " << resolved << "/"
+		 << INTEGER_FEATURE_COUNT + FLOAT_FEATURE_COUNT + ENUM_FEATURE_COUNT + BOOLEAN_FEATURE_COUNT + COMMAND_FEATURE_COUNT
+		 << " features (" << entries << " enum entries) in " << m_resolveMs << " ms" << endl;
+	return true;
+}
+
+void CameraFeatures::Reset()
+{
+	std::lock_guard<std::recursive_mutex> lock(m_mutex);
+	m_resolved = false;
+	for (auto &node : m_integers)
+	{
+		node = nullptr;
+	}
+	for (auto &node : m_floats)
+	{
+		node = nullptr;
+	}
+	for (int i = 0; i < ENUM_FEATURE_COUNT; i++)
+	{
+		m_enums[i] = nullptr;
+		m_entries[i].clear();
+	}
+	for (auto &node : m_booleans)
+	{
+		node = nullptr;
+	}
+	for (auto &node : m_commands)
+	{
+		node = nullptr;
+	}
+}
+
+const char *CameraFeatures::Name(IntegerFeature feature)
+{
+	return kIntegerNames[feature].name;
+}
+
+const char *CameraFeatures::Name(FloatFeature feature)
+{
+	return kFloatNames[feature].name;
+}
+
+const char *CameraFeatures::Name(EnumFeature feature)
+{
+	return kEnumNames[feature].name;
+}
+
+const char *CameraFeatures::Name(BooleanFeature feature)
+{
+	return kBooleanNames[feature].name;
+}
+
+const char *CameraFeatures::Name(CommandFeature feature)
+{
+	return kCommandNames[feature].name;
+}
+
+bool CameraFeatures::IsReadable(IntegerFeature feature) const
+{
+	std::lock_guard<std::recursive_mutex> lock(m_mutex);
+	return GenApi::IsReadable(m_integers[feature]);
+}
+
+bool CameraFeatures::IsReadable(FloatFeature feature) const
+{
+	std::lock_guard<std::recursive_mutex> lock(m_mutex);
+	return GenApi::IsReadable(m_floats[feature]);
+}
+
+bool CameraFeatures::IsReadable(EnumFeature feature) const
+{
+	std::lock_guard<std::recursive_mutex> lock(m_mutex);
+	return GenApi::IsReadable(m_enums[feature]);
+}
+
+bool CameraFeatures::IsWritable(IntegerFeature feature) const
+{
+	std::lock_guard<std::recursive_mutex> lock(m_mutex);
+	return GenApi::IsWritable(m_integers[feature]);
+}
+
+bool CameraFeatures::IsWritable(FloatFeature feature) const
+{
+	std::lock_guard<std::recursive_mutex> lock(m_mutex);
+	return GenApi::IsWritable(m_floats[feature]);
+}
+
+bool CameraFeatures::IsWritable(EnumFeature feature) const
+{
+	std::lock_guard<std::recursive_mutex> lock(m_mutex);
+	return GenApi::IsWritable(m_enums[feature]);
+}
+
+bool CameraFeatures::IsWritable(BooleanFeature feature) const
+{
+	std::lock_guard<std::recursive_mutex> lock(m_mutex);
+	return GenApi::IsWritable(m_booleans[feature]);
+}
+
+int64_t CameraFeatures::Get(IntegerFeature feature, int64_t fallback) const
+{
+	std::lock_guard<std::recursive_mutex> lock(m_mutex);
+	try
+	{
+		if (IsReadable(feature))
+		{
+			return m_integers[feature]->GetValue();
+		}
+	}
+	catch (Spinnaker::Exception &)
+	{
+	}
+	return fallback;
+}
+
+double CameraFeatures::Get(FloatFeature feature, double fallback) const
+{
+	std::lock_guard<std::recursive_mutex> lock(m_mutex);
+	try
+	{
+		if (IsReadable(feature))
+		{
+			return m_floats[feature]->GetValue();
+		}
+	}
+	catch (Spinnaker::Exception &)
+	{
+	}
+	return fallback;
+}
+
+std::string CameraFeatures::Get(EnumFeature feature) const
+{
+	std::lock_guard<std::recursive_mutex> lock(m_mutex);
+	try
+	{
+		if (IsReadable(feature))
+		{
+			// 按缓存的整数值反查名称，不访问枚举项节点
+			const int64_t value = m_enums[feature]->GetIntValue();
+			for (const auto &entry : m_entries[feature])
+			{
+				if (entry.second.value == value)
+				{
+					return entry.first;
+				}
+			}
+		}
+	}
+	catch (Spinnaker::Exception &)
+	{
+	}
+	return "";
+}
+
+bool CameraFeatures::Get(BooleanFeature feature, bool fallback) const
+{
+	std::lock_guard<std::recursive_mutex> lock(m_mutex);
+	try
+	{
+		if (GenApi::IsReadable(m_booleans[feature]))
+		{
+			return m_booleans[feature]->GetValue();
+		}
+	}
+	catch (Spinnaker::Exception &)
+	{
+	}
+	return fallback;
+}
+
+bool CameraFeatures::Set(IntegerFeature feature, int64_t value, int64_t *applied)
+{
+	std::lock_guard<std::recursive_mutex> lock(m_mutex);
+	try
+	{
+		if (!IsWritable(feature))
+		{
+			return false;
+		}
+		const CIntegerPtr &ptrNode = m_integers[feature];
+		const int64_t minimum = ptrNode->GetMin();
+		const int64_t increment = std::max<int64_t>(1, ptrNode->GetInc());
+		value = std::min(std::max(value, minimum), ptrNode->GetMax());
+		value = minimum + (value - minimum) / increment * increment;
+		if (ptrNode->GetValue() != value)
+		{
+			ptrNode->SetValue(value);
+		}
+		if (applied != nullptr)
+		{
+			*applied = value;
+		}
+		return true;
+	}
+	catch (Spinnaker::Exception &e)
+	{
+		cout << "Error: " << Name(feature) << ": " << e.what() << endl;
+		return false;
+	}
+}
+
+bool CameraFeatures::Set(FloatFeature feature, double value, double *applied)
+{
+	std::lock_guard<std::recursive_mutex> lock(m_mutex);
+	try
+	{
+		if (!IsWritable(feature))
+		{
+			return false;
+		}
+		const CFloatPtr &ptrNode = m_floats[feature];
+		value = std::min(std::max(value, ptrNode->GetMin()), ptrNode->GetMax());
+		if (ptrNode->GetValue() != value)
+		{
+			ptrNode->SetValue(value);
+		}
+		if (applied != nullptr)
+		{
+			*applied = value;
+		}
+		return true;
+	}
+	catch (Spinnaker::Exception &e)
+	{
+		cout << "Error: " << Name(feature) << ": " << e.what() << endl;
+		return false;
+	}
+}
+
+bool CameraFeatures::Set(EnumFeature feature, const std::string &entry)
+{
+	std::lock_guard<std::recursive_mutex> lock(m_mutex);
+	const auto found = m_entries[feature].find(entry);
+	if (found == m_entries[feature].end() || !IsWritable(feature))
+	{
+		return false;
+	}
+	try
+	{
+		if (m_enums[feature]->GetIntValue() == found->second.value)
+		{
+			return true;
+		}
+		if (!GenApi::IsAvailable(found->second.node))
+		{
+			return false;
+		}
+		m_enums[feature]->SetIntValue(found->second.value);
+		return true;
+	}
+	catch (Spinnaker::Exception &e)
+	{
+		cout << "Error: " << Name(feature) << ": " << e.what() << endl;
+		return false;
+	}
+}
+
+bool CameraFeatures::Set(BooleanFeature feature, bool value)
+{
+	std::lock_guard<std::recursive_mutex> lock(m_mutex);
+	try
+	{
+		if (!IsWritable(feature))
+		{
+			return false;
+		}
+		if (m_booleans[feature]->GetValue() != value)
+		{
+			m_booleans[feature]->SetValue(value);
+		}
+		return true;
+	}
+	catch (Spinnaker::Exception &e)
+	{
+		cout << "Error: " << Name(feature) << ": " << e.what() << endl;
+		return false;
+	}
+}
+
+bool CameraFeatures::HasEntry(EnumFeature feature, const std::string &entry) const
+{
+	std::lock_guard<std::recursive_mutex> lock(m_mutex);
+	const auto found = m_entries[feature].find(entry);
+	try
+	{
+		return found != m_entries[feature].end() && GenApi::IsAvailable(found->second.node);
+	}
+	catch (Spinnaker::Exception &)
+	{
+		return false;
+	}
+}
+
+bool CameraFeatures::Execute(CommandFeature feature)
+{
+	std::lock_guard<std::recursive_mutex> lock(m_mutex);
+	try
+	{
+		if (!GenApi::IsWritable(m_commands[feature]))
+		{
+			return false;
+		}
+		m_commands[feature]->Execute();
+		return true;
+	}
+	catch (Spinnaker::Exception &e)
+	{
+		cout << "Error: " << Name(feature) << ": " << e.what() << endl;
+		return false;
+	}
+}
+
+CIntegerPtr CameraFeatures::Node(IntegerFeature feature) const
+{
+	std::lock_guard<std::recursive_mutex> lock(m_mutex);
+	return m_integers[feature];
+}
+
+CFloatPtr CameraFeatures::Node(FloatFeature feature) const
+{
+	std::lock_guard<std::recursive_mutex> lock(m_mutex);
+	return m_floats[feature];
+}
+
+CEnumerationPtr CameraFeatures::Node(EnumFeature feature) const
+{
+	std::lock_guard<std::recursive_mutex> lock(m_mutex);
+	return m_enums[feature];
+}
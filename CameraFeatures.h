@@ -0,0 +1,149 @@
+﻿#pragma once
+
+#include "Spinnaker.h"
+#include "SpinGenApi/SpinnakerGenApi.h"
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+
+// 采集程序用到的相机节点。新增运行时控制（曝光、增益、ROI、触发等）时在这里和 CameraFeatures.cpp 的名称表中各加一项
+enum IntegerFeature
+{
+	FEATURE_WIDTH,
+	FEATURE_HEIGHT,
+	FEATURE_OFFSET_X,
+	FEATURE_OFFSET_Y,
+	FEATURE_BINNING_HORIZONTAL,
+	FEATURE_BINNING_VERTICAL,
+	FEATURE_DECIMATION_HORIZONTAL,
+	FEATURE_DECIMATION_VERTICAL,
+	FEATURE_PAYLOAD_SIZE,
+	FEATURE_LINK_THROUGHPUT_LIMIT,
+	// TL 流节点
+	FEATURE_STREAM_BUFFER_COUNT_MANUAL,
+	FEATURE_STREAM_LOST_FRAMES,
+	FEATURE_STREAM_DROPPED_FRAMES,
+	FEATURE_STREAM_INPUT_BUFFERS,
+	FEATURE_STREAM_ANNOUNCED_BUFFERS,
+	FEATURE_STREAM_RECEPTION_TIME_LAST,
+	FEATURE_STREAM_RECEPTION_TIME_MIN,
+	FEATURE_STREAM_RECEPTION_TIME_MAX,
+	FEATURE_STREAM_PROCESSING_TIME_LAST,
+	FEATURE_STREAM_PROCESSING_TIME_MIN,
+	FEATURE_STREAM_PROCESSING_TIME_MAX,
+	INTEGER_FEATURE_COUNT
+};
+
+enum FloatFeature
+{
+	FEATURE_EXPOSURE_TIME,
+	FEATURE_GAIN,
+	FEATURE_ACQUISITION_FRAME_RATE,
+	FEATURE_RESULTING_FRAME_RATE,
+	FLOAT_FEATURE_COUNT
+};
+
+enum EnumFeature
+{
+	FEATURE_ACQUISITION_MODE,
+	FEATURE_PIXEL_FORMAT,
+	FEATURE_EXPOSURE_AUTO,
+	FEATURE_GAIN_AUTO,
+	FEATURE_TRIGGER_SELECTOR,
+	FEATURE_TRIGGER_MODE,
+	FEATURE_TRIGGER_SOURCE,
+	// TL 流节点
+	FEATURE_STREAM_MODE,
+	FEATURE_STREAM_BUFFER_HANDLING_MODE,
+	FEATURE_STREAM_BUFFER_COUNT_MODE,
+	ENUM_FEATURE_COUNT
+};
+
+enum BooleanFeature
+{
+	FEATURE_ACQUISITION_FRAME_RATE_ENABLE,
+	BOOLEAN_FEATURE_COUNT
+};
+
+enum CommandFeature
+{
+	FEATURE_TRIGGER_SOFTWARE,
+	COMMAND_FEATURE_COUNT
+};
+
+// 相机节点句柄表：Init() 之后一次性按名称解析所有节点，并缓存枚举节点各可用项的整数值，
+// 之后的读写都直接通过句柄进行，不再按字符串查找节点或枚举项。
+// 相机不提供的节点句柄为空，读取返回 fallback，写入返回 false。
+// 读写失败时不抛出 Spinnaker::Exception；写入失败会打印错误。
+// 相机重连时抓图线程会重新解析句柄，而主线程同时在读取统计，因此所有接口都加锁。
+class CameraFeatures
+{
+public:
+	CameraFeatures() = default;
+
+	CameraFeatures(const CameraFeatures &) = delete;
+	CameraFeatures &operator=(const CameraFeatures &) = delete;
+
+	// 在 pCam->Init() 之后调用，打印解析到的节点数和耗时
+	bool Resolve(Spinnaker::CameraPtr pCam);
+	// 在 DeInit() 之前调用，放开所有句柄（之后读取返回 fallback，直到重新 Resolve()）
+	void Reset();
+	bool IsResolved() const { return m_resolved; }
+	double ResolveMilliseconds() const { return m_resolveMs; }
+
+	static const char *Name(IntegerFeature feature);
+	static const char *Name(FloatFeature feature);
+	static const char *Name(EnumFeature feature);
+	static const char *Name(BooleanFeature feature);
+	static const char *Name(CommandFeature feature);
+
+	bool IsReadable(IntegerFeature feature) const;
+	bool IsReadable(FloatFeature feature) const;
+	bool IsReadable(EnumFeature feature) const;
+	bool IsWritable(IntegerFeature feature) const;
+	bool IsWritable(FloatFeature feature) const;
+	bool IsWritable(EnumFeature feature) const;
+	bool IsWritable(BooleanFeature feature) const;
+
+	int64_t Get(IntegerFeature feature, int64_t fallback = -1) const;
+	double Get(FloatFeature feature, double fallback = -1.0) const;
+	// 当前枚举项的名称，不可读时为空
+	std::string Get(EnumFeature feature) const;
+	bool Get(BooleanFeature feature, bool fallback = false) const;
+
+	// 超出节点范围时取最近的合法值（整数还按步进向下取整），applied 为实际写入的值。
+	// 与当前值相同时不写入（每次写入都是一次与相机的往返）
+	bool Set(IntegerFeature feature, int64_t value, int64_t *applied = nullptr);
+	bool Set(FloatFeature feature, double value, double *applied = nullptr);
+	// 只接受写入时可用的枚举项（如合并后才出现的像素格式），与当前项相同时不写入
+	bool Set(EnumFeature feature, const std::string &entry);
+	bool Set(BooleanFeature feature, bool value);
+	// 该枚举项当前是否可用
+	bool HasEntry(EnumFeature feature, const std::string &entry) const;
+	// 执行命令节点（如 TriggerSoftware），当前不可执行时返回 false
+	bool Execute(CommandFeature feature);
+
+	// 需要其他操作（如 GetMin / GetInc）时直接取句柄
+	Spinnaker::GenApi::CIntegerPtr Node(IntegerFeature feature) const;
+	Spinnaker::GenApi::CFloatPtr Node(FloatFeature feature) const;
+	Spinnaker::GenApi::CEnumerationPtr Node(EnumFeature feature) const;
+
+private:
+	mutable std::recursive_mutex m_mutex;
+	Spinnaker::GenApi::CIntegerPtr m_integers[INTEGER_FEATURE_COUNT];
+	Spinnaker::GenApi::CFloatPtr m_floats[FLOAT_FEATURE_COUNT];
+	Spinnaker::GenApi::CEnumerationPtr m_enums[ENUM_FEATURE_COUNT];
+	Spinnaker::GenApi::CBooleanPtr m_booleans[BOOLEAN_FEATURE_COUNT];
+	Spinnaker::GenApi::CCommandPtr m_commands[COMMAND_FEATURE_COUNT];
+	// 全部枚举项（按名称），可用与否随相机状态变化，使用时再检查
+	struct EnumEntry
+	{
+		int64_t value;
+		Spinnaker::GenApi::CEnumEntryPtr node;
+	};
+	std::map<std::string, EnumEntry> m_entries[ENUM_FEATURE_COUNT];
+	std::atomic<bool> m_resolved{false};
+	double m_resolveMs = 0.0;
+};
@@ -0,0 +1,331 @@
+﻿#include "CameraSnapshot.h"
+#include "SpinGenApi/SpinnakerGenApi.h"
+#include "SpinGenApi/Persistence.h"
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <vector>
+
+using namespace Spinnaker;
+using namespace Spinnaker::GenApi;
+using namespace std;
+
+namespace fs = std::filesystem;
+
+namespace
+{
+struct BagEntry
+{
+	std::string name;
+	std::string value;
+};
+
+// 程序信息注释行的前缀
+const char kNotePrefix[] = "#@";
+
+// CFeatureBag 的文本格式：# 开头为注释，其余每行“名称<Tab>值”。notes 非空时收集 #@ 开头的程序信息
+std::vector<BagEntry> ParseBag(std::istream &in, SnapshotNotes *notes = nullptr)
+{
+	std::vector<BagEntry> entries;
+	std::string line;
+	while (std::getline(in, line))
+	{
+		if (!line.empty() && line.back() == '\r')
+		{
+			line.pop_back();
+		}
+		const bool note = line.compare(0, sizeof(kNotePrefix) - 1, kNotePrefix) == 0;
+		if (note && notes != nullptr)
+		{
+			const size_t separator = line.find('\t');
+			if (separator != std::string::npos)
+			{
+				(*notes)[line.substr(sizeof(kNotePrefix) - 1, separator - (sizeof(kNotePrefix) - 1))] =
+					line.substr(separator + 1);
+			}
+		}
+		if (line.empty() || line[0] == '#')
+		{
+			continue;
+		}
+		size_t separator = line.find('\t');
+		if (separator == std::string::npos)
+		{
+			separator = line.find(' ');
+		}
+		if (separator == std::string::npos)
+		{
+			continue;
+		}
+		entries.push_back(BagEntry{line.substr(0, separator), line.substr(separator + 1)});
+	}
+	return entries;
+}
+
+// 每个特征是否为选择器、以及选择它的选择器，按名称缓存
+class SelectorIndex
+{
+public:
+	explicit SelectorIndex(INodeMap &nodeMap) : m_nodeMap(nodeMap) {}
+
+	bool IsSelector(const std::string &name) { return Lookup(name).selector; }
+	const std::vector<std::string> &SelectingFeatures(const std::string &name) { return Lookup(name).selecting; }
+
+private:
+	struct Info
+	{
+		bool selector = false;
+		std::vector<std::string> selecting;
+	};
+
+	const Info &Lookup(const std::string &name)
+	{
+		auto found = m_cache.find(name);
+		if (found != m_cache.end())
+		{
+			return found->second;
+		}
+
+		Info &info = m_cache[name];
+		CSelectorPtr ptrSelector = m_nodeMap.GetNode(name.c_str());
+		if (ptrSelector)
+		{
+			info.selector = ptrSelector->IsSelector();
+			FeatureList_t selecting;
+			ptrSelector->GetSelectingFeatures(selecting);
+			for (IValue *value : selecting)
+			{
+				info.selecting.push_back(value->GetNode()->GetName().c_str());
+			}
+		}
+		return info;
+	}
+
+	INodeMap &m_nodeMap;
+	std::map<std::string, Info> m_cache;
+};
+
+// 节点当前值的字符串形式，不可读时返回 false
+bool ReadFeature(INodeMap &nodeMap, const std::string &name, std::string &value)
+{
+	try
+	{
+		CValuePtr ptrValue = nodeMap.GetNode(name.c_str());
+		if (!IsReadable(ptrValue))
+		{
+			return false;
+		}
+		value = ptrValue->ToString().c_str();
+		return true;
+	}
+	catch (Spinnaker::Exception &)
+	{
+		return false;
+	}
+}
+
+bool WriteFeature(INodeMap &nodeMap, const std::string &name, const std::string &value)
+{
+	try
+	{
+		CValuePtr ptrValue = nodeMap.GetNode(name.c_str());
+		if (!IsWritable(ptrValue))
+		{
+			return false;
+		}
+		ptrValue->FromString(value.c_str());
+		return true;
+	}
+	catch (Spinnaker::Exception &)
+	{
+		return false;
+	}
+}
+
+// 与当前值不同时才写入；written 表示确实写了
+bool SyncFeature(INodeMap &nodeMap, const std::string &name, const std::string &value, bool &written)
+{
+	std::string current;
+	written = false;
+	if (ReadFeature(nodeMap, name, current) && current == value)
+	{
+		return true;
+	}
+	written = WriteFeature(nodeMap, name, value);
+	return written;
+}
+
+// 每项写入之前才读取该节点的当前值与快照比较，只写入不同的特征。
+// 不能事先读一遍整个配置再比：写合并、像素格式或选择器时相机会调整宽高、偏移等，之前读到的值已经过时
+bool RestoreEntries(CameraPtr pCam, const std::vector<BagEntry> &saved, const std::string &label,
+					std::chrono::steady_clock::time_point start, SnapshotRestoreStats &stats)
+{
+	try
+	{
+		INodeMap &nodeMap = pCam->GetNodeMap();
+		SelectorIndex index(nodeMap);
+
+		std::map<std::string, std::string> context; // 快照中当前的选择器取值
+		std::vector<std::string> failures;
+		for (const BagEntry &entry : saved)
+		{
+			if (index.IsSelector(entry.name))
+			{
+				context[entry.name] = entry.value;
+				continue;
+			}
+
+			// 先把选中该特征的选择器切到快照中的取值，之后读到的才是同一项
+			for (const std::string &selector : index.SelectingFeatures(entry.name))
+			{
+				const auto selected = context.find(selector);
+				bool written = false;
+				if (selected != context.end() && SyncFeature(nodeMap, selector, selected->second, written) && written)
+				{
+					stats.written++;
+				}
+			}
+
+			stats.entries++;
+			bool written = false;
+			if (!SyncFeature(nodeMap, entry.name, entry.value, written))
+			{
+				stats.failed++;
+				failures.push_back(entry.name);
+			}
+			else if (written)
+			{
+				stats.written++;
+			}
+			else
+			{
+				stats.unchanged++;
+			}
+		}
+
+		// 选择器最终停在快照中的取值
+		for (const auto &selector : context)
+		{
+			bool written = false;
+			if (SyncFeature(nodeMap, selector.first, selector.second, written) && written)
+			{
+				stats.written++;
+			}
+		}
+
+		stats.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		cout << "Camera snapshot " << label << " restored in " << stats.milliseconds << " ms: " << stats.entries
+			 << " features, " << stats.unchanged << " unchanged, " << stats.written << " writes, " << stats.failed
+			 << " failed" << endl;
+		if (!failures.empty())
+		{
+			cout << "  Not restored:";
+			for (size_t i = 0; i < failures.size() && i < 8; i++)
+			{
+				cout << " " << failures[i];
+			}
+			cout << (failures.size() > 8 ? " ..." : "") << endl;
+		}
+		return true;
+	}
+	catch (Spinnaker::Exception &e)
+	{
+		cout << "Error: " << e.what() << endl;
+		return false;
+	}
+}
+} // namespace
+
+bool SaveCameraSnapshot(CameraPtr pCam, const std::string &path, const SnapshotNotes &notes)
+{
+	try
+	{
+		const auto start = std::chrono::steady_clock::now();
+
+		CFeatureBag bag;
+		const int64_t count = bag.StoreToBag(&pCam->GetNodeMap());
+
+		std::error_code ec;
+		const fs::path parent = fs::path(path).parent_path();
+		if (!parent.empty())
+		{
+			fs::create_directories(parent, ec);
+		}
+
+		// 先写临时文件再改名，中途失败不会留下半个快照
+		const std::string temporary = path + ".tmp";
+		{
+			std::ofstream file(temporary, std::ios::trunc);
+			file << bag;
+			for (const auto &note : notes)
+			{
+				file << kNotePrefix << note.first << '\t' << note.second << '\n';
+			}
+			if (!file.good())
+			{
+				cout << "Error: cannot write camera snapshot " << temporary << endl;
+				return false;
+			}
+		}
+		fs::rename(temporary, path, ec);
+		if (ec)
+		{
+			cout << "Error: cannot write camera snapshot " << path << ": " << ec.message() << endl;
+			return false;
+		}
+
+		cout << "Camera snapshot saved to " << path << " (" << count << " features, "
+			 << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() << " ms)"
+			 << endl;
+		return true;
+	}
+	catch (Spinnaker::Exception &e)
+	{
+		cout << "Error: " << e.what() << endl;
+		return false;
+	}
+}
+
+bool CaptureCameraSnapshot(CameraPtr pCam, std::string &text)
+{
+	try
+	{
+		CFeatureBag bag;
+		bag.StoreToBag(&pCam->GetNodeMap());
+		std::ostringstream out;
+		out << bag;
+		text = out.str();
+		return true;
+	}
+	catch (Spinnaker::Exception &e)
+	{
+		cout << "Error: " << e.what() << endl;
+		return false;
+	}
+}
+
+bool RestoreCameraSnapshot(CameraPtr pCam, const std::string &path, SnapshotRestoreStats &stats, SnapshotNotes *notes)
+{
+	stats = SnapshotRestoreStats();
+	const auto start = std::chrono::steady_clock::now();
+
+	std::ifstream file(path);
+	if (!file)
+	{
+		cout << "Error: cannot open camera snapshot " << path << endl;
+		return false;
+	}
+	return RestoreEntries(pCam, ParseBag(file, notes), path, start, stats);
+}
+
+bool ApplyCameraSnapshot(CameraPtr pCam, const std::string &text, SnapshotRestoreStats &stats)
+{
+	stats = SnapshotRestoreStats();
+	const auto start = std::chrono::steady_clock::now();
+
+	std::istringstream in(text);
+	return RestoreEntries(pCam, ParseBag(in), "(cached)", start, stats);
+}
@@ -0,0 +1,33 @@
+﻿#pragma once
+
+#include "Spinnaker.h"
+#include <cstddef>
+#include <map>
+#include <string>
+
+struct SnapshotRestoreStats
+{
+	size_t entries = 0;	  // 快照中的特征数（不含选择器）
+	size_t written = 0;	  // 实际写入相机的特征数（含为写入被选特征而切换的选择器）
+	size_t unchanged = 0; // 与相机当前值相同而跳过的特征数
+	size_t failed = 0;	  // 写入失败（当前状态下不可写、超出范围等）的特征数
+	double milliseconds = 0.0;
+};
+
+// 随快照保存的程序信息（如规划好的 ROI、启用的 chunk），名称 -> 值。
+// 在文件中为 "#@名称<Tab>值" 注释行，SpinView 读取时忽略
+using SnapshotNotes = std::map<std::string, std::string>;
+
+// 用 CFeatureBag 把相机节点图中所有可持久化的特征保存为文本文件（GenApi 持久化格式，可被 SpinView 读取）
+bool SaveCameraSnapshot(Spinnaker::CameraPtr pCam, const std::string &path, const SnapshotNotes &notes = SnapshotNotes());
+
+// 恢复快照：按快照中的顺序逐项读取相机当前值，只写入与文件不同的特征
+// （CFeatureBag 保存时已按依赖关系排好，选择器在其被选特征之前）。每项在写入前才读当前值，
+// 前面写入的合并 / 像素格式引起的宽高、偏移变化也能被纠正。单个特征写入失败不会中止恢复。
+// notes 非空时返回保存时附带的程序信息
+bool RestoreCameraSnapshot(Spinnaker::CameraPtr pCam, const std::string &path, SnapshotRestoreStats &stats,
+						   SnapshotNotes *notes = nullptr);
+
+// 同样的快照保存在内存中（例如相机掉线重连时恢复启动时的配置），格式与文件相同
+bool CaptureCameraSnapshot(Spinnaker::CameraPtr pCam, std::string &text);
+bool ApplyCameraSnapshot(Spinnaker::CameraPtr pCam, const std::string &text, SnapshotRestoreStats &stats);
@@ -0,0 +1,228 @@
+﻿#include "FrameGapDetector.h"
+#include <cmath>
+#include <iostream>
+
+using namespace std;
+
+namespace
+{
+// 阶段耗时采样间隔和归因窗口
+const std::chrono::milliseconds kSampleInterval(100);
+const size_t kSampleCount = 11;
+const std::chrono::seconds kPrintInterval(1);
+} // namespace
+
+FrameGapDetector::FrameGapDetector(double rateTolerance) : m_rateTolerance(rateTolerance)
+{
+	for (auto &count : m_stageBursts)
+	{
+		count.store(0, std::memory_order_relaxed);
+	}
+}
+
+void FrameGapDetector::AddStage(const std::string &name, BusyReader busyNs)
+{
+	if (m_stages.size() < kMaxStages)
+	{
+		m_stages.push_back(Stage{name, std::move(busyNs)});
+	}
+}
+
+void FrameGapDetector::SetExpectedFrameRate(double fps)
+{
+	m_expectedPeriodNs = fps > 0.0 ? static_cast<uint64_t>(1e9 / fps) : 0;
+}
+
+uint64_t FrameGapDetector::ExpectedPeriodNs() const
+{
+	const uint64_t configured = m_expectedPeriodNs.load(std::memory_order_relaxed);
+	return configured != 0 ? configured : static_cast<uint64_t>(m_learnedPeriodNs);
+}
+
+void FrameGapDetector::Record(uint64_t frameId, uint64_t timestampNs)
+{
+	if (m_started && frameId <= m_lastFrameId)
+	{
+		m_restarts++;
+		m_started = false;
+	}
+	if (!m_started)
+	{
+		m_started = true;
+		m_lastFrameId = frameId;
+		m_lastTimestamp = timestampNs;
+		return;
+	}
+
+	const uint64_t missing = frameId - m_lastFrameId - 1;
+	if (missing > 0)
+	{
+		m_missing += missing;
+		m_bursts++;
+		if (missing > m_largestBurst.load(std::memory_order_relaxed))
+		{
+			m_largestBurst.store(missing, std::memory_order_relaxed);
+		}
+		std::lock_guard<std::mutex> lock(m_pendingMutex);
+		m_pending.push_back(Burst{m_lastFrameId + 1, missing});
+	}
+
+	// 没有相机时间戳的来源只统计 FrameID
+	if (m_lastTimestamp != 0 && timestampNs > m_lastTimestamp)
+	{
+		const uint64_t delta = timestampNs - m_lastTimestamp;
+		m_spanNs += delta;
+		m_frames += missing + 1;
+
+		// 中间丢了帧时按平均每帧的间隔计算
+		const uint64_t interval = delta / (missing + 1);
+		const uint64_t expected = ExpectedPeriodNs();
+		if (expected > 0)
+		{
+			m_jitter.Record(interval > expected ? interval - expected : expected - interval);
+
+			// FrameID 连续但间隔超过 1.5 倍：相机本身停顿（曝光变长、触发变慢等）
+			if (missing == 0 && interval * 2 > expected * 3)
+			{
+				m_stalls++;
+			}
+		}
+		m_learnedPeriodNs = m_learnedPeriodNs == 0.0 ? static_cast<double>(interval)
+													   : m_learnedPeriodNs + (static_cast<double>(interval) - m_learnedPeriodNs) / 16.0;
+	}
+
+	m_lastFrameId = frameId;
+	m_lastTimestamp = timestampNs;
+}
+
+void FrameGapDetector::Poll(const std::string &prefix)
+{
+	const auto now = std::chrono::steady_clock::now();
+	if (m_samples.empty() || now - m_samples.back().time >= kSampleInterval)
+	{
+		Sample sample;
+		sample.time = now;
+		for (size_t i = 0; i < m_stages.size(); i++)
+		{
+			sample.busyNs[i] = m_stages[i].busyNs();
+		}
+		m_samples.push_back(sample);
+		if (m_samples.size() > kSampleCount)
+		{
+			m_samples.erase(m_samples.begin());
+		}
+	}
+
+	std::vector<Burst> bursts;
+	{
+		std::lock_guard<std::mutex> lock(m_pendingMutex);
+		bursts.swap(m_pending);
+	}
+	if (bursts.empty())
+	{
+		return;
+	}
+
+	// 最近约 1 秒内累计耗时占比最高的阶段（多线程阶段可超过 100%）
+	const Sample &oldest = m_samples.front();
+	const double window = std::chrono::duration<double, std::nano>(now - oldest.time).count();
+	size_t busiest = m_stages.size();
+	double busiestShare = 0.0;
+	if (window > 0.0)
+	{
+		for (size_t i = 0; i < m_stages.size(); i++)
+		{
+			const double share = static_cast<double>(m_stages[i].busyNs() - oldest.busyNs[i]) / window;
+			if (share > busiestShare)
+			{
+				busiest = i;
+				busiestShare = share;
+			}
+		}
+	}
+	if (busiest < m_stages.size())
+	{
+		m_stageBursts[busiest].fetch_add(bursts.size(), std::memory_order_relaxed);
+	}
+
+	uint64_t missing = 0;
+	for (const Burst &burst : bursts)
+	{
+		missing += burst.count;
+	}
+	m_unprinted += bursts.size();
+	if (now - m_lastPrint < kPrintInterval)
+	{
+		return;
+	}
+
+	const Burst &last = bursts.back();
+	cout << prefix << "Missed " << missing << " frames (FrameID " << bursts.front().firstFrameId;
+	if (last.firstFrameId + last.count - 1 != bursts.front().firstFrameId)
+	{
+		cout << "-" << last.firstFrameId + last.count - 1;
+	}
+	cout << ")";
+	if (m_unprinted > bursts.size())
+	{
+		cout << ", " << m_unprinted - bursts.size() << " earlier bursts not shown";
+	}
+	if (busiest < m_stages.size())
+	{
+		cout << ", busiest stage " << m_stages[busiest].name << " " << std::lround(busiestShare * 100.0) << "%";
+	}
+	cout << endl;
+	m_lastPrint = now;
+	m_unprinted = 0;
+}
+
+FrameGapDetector::RateCheck FrameGapDetector::CheckRate()
+{
+	RateCheck check;
+	const uint64_t frames = m_frames.load(std::memory_order_relaxed);
+	const uint64_t spanNs = m_spanNs.load(std::memory_order_relaxed);
+	const uint64_t deltaFrames = frames - m_checkedFrames;
+	const uint64_t deltaSpan = spanNs - m_checkedSpanNs;
+	m_checkedFrames = frames;
+	m_checkedSpanNs = spanNs;
+	if (deltaSpan == 0)
+	{
+		return check;
+	}
+
+	check.measuredFps = deltaFrames * 1e9 / static_cast<double>(deltaSpan);
+	const uint64_t expected = m_expectedPeriodNs.load(std::memory_order_relaxed);
+	if (expected != 0)
+	{
+		check.expectedFps = 1e9 / static_cast<double>(expected);
+		check.deviation = (check.measuredFps - check.expectedFps) / check.expectedFps;
+		check.flagged = std::fabs(check.deviation) > m_rateTolerance;
+	}
+	return check;
+}
+
+void FrameGapDetector::PrintSummary() const
+{
+	cout << "  Frame gaps: " << Missing() << " missing in " << Bursts() << " bursts (largest " << LargestBurst()
+		 << "), stalls " << Stalls() << ", jitter p50 " << m_jitter.Percentile(0.5) / 1e6 << " ms, p99 "
+		 << m_jitter.Percentile(0.99) / 1e6 << " ms, max " << m_jitter.Max() / 1e6 << " ms";
+	if (Restarts() > 0)
+	{
+		cout << ", FrameID restarts " << Restarts();
+	}
+	cout << endl;
+
+	if (Bursts() == 0)
+	{
+		return;
+	}
+	cout << "  Drop bursts by busiest stage:";
+	for (size_t i = 0; i < m_stages.size(); i++)
+	{
+		if (StageBursts(i) > 0)
+		{
+			cout << " " << m_stages[i].name << " " << StageBursts(i);
+		}
+	}
+	cout << endl;
+}
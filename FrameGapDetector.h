@@ -0,0 +1,122 @@
+﻿#pragma once
+
+#include "LatencyHistogram.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// 丢帧检测：按相机 FrameID 的连续性统计从未到达的帧（缓冲溢出、传输丢包，IsIncomplete() 看不到这类丢失），
+// 按相机时间戳的帧间隔统计抖动和停顿，并与配置的帧率比较。
+// 每次丢帧记为一次“丢帧突发”，由主线程归因到当时最忙的流水线阶段（各阶段最近约 1 秒的累计耗时占比）。
+// Record() 只在抓图线程调用；Poll()、CheckRate() 和 AddStage() 只在主线程调用；计数可在任意线程读取。
+class FrameGapDetector
+{
+public:
+	static const size_t kMaxStages = 8;
+
+	// 某阶段累计的处理耗时（ns），如 LatencyHistogram::Sum()
+	using BusyReader = std::function<uint64_t()>;
+
+	struct RateCheck
+	{
+		double measuredFps = 0.0; // 按相机时间戳计算，含丢失的帧（即相机实际的出帧速率）
+		double expectedFps = 0.0;
+		double deviation = 0.0; // (measured - expected) / expected
+		bool flagged = false;	// 偏差超过容差
+	};
+
+	explicit FrameGapDetector(double rateTolerance = 0.05);
+
+	FrameGapDetector(const FrameGapDetector &) = delete;
+	FrameGapDetector &operator=(const FrameGapDetector &) = delete;
+
+	// 开始采集之前登记，超过 kMaxStages 的忽略
+	void AddStage(const std::string &name, BusyReader busyNs);
+	// 配置的帧率；0 为未知，此时按实测帧间隔的滑动平均作为期望间隔
+	void SetExpectedFrameRate(double fps);
+
+	// 抓图线程每帧调用（含不完整帧）。FrameID / 时间戳须对所有帧取同一来源（图像头的 GetFrameID() / GetTimeStamp()，
+	// 而不是 chunk 中的另一套计数）。FrameID 回退视为来源重新计数（如相机重连），不计为丢帧
+	void Record(uint64_t frameId, uint64_t timestampNs);
+	// 有意停止采集（如切换到全分辨率抓拍）之后调用，下一帧重新开始计数，不计为丢帧、停顿或重新计数。
+	// 只在抓图线程停止时调用
+	void Resync() { m_started = false; }
+
+	// 主线程定期调用：采样各阶段耗时，归因新的丢帧突发并打印（每秒最多一行）
+	void Poll(const std::string &prefix);
+
+	// 自上次调用以来的帧率与期望帧率比较
+	RateCheck CheckRate();
+
+	uint64_t Missing() const { return m_missing.load(std::memory_order_relaxed); }
+	uint64_t Bursts() const { return m_bursts.load(std::memory_order_relaxed); }
+	uint64_t LargestBurst() const { return m_largestBurst.load(std::memory_order_relaxed); }
+	uint64_t Stalls() const { return m_stalls.load(std::memory_order_relaxed); }
+	uint64_t Restarts() const { return m_restarts.load(std::memory_order_relaxed); }
+	// 相机帧间隔与期望间隔之差的绝对值（ns）
+	const LatencyHistogram &Jitter() const { return m_jitter; }
+
+	size_t StageCount() const { return m_stages.size(); }
+	const std::string &StageName(size_t index) const { return m_stages[index].name; }
+	// 归因到该阶段的丢帧突发次数
+	uint64_t StageBursts(size_t index) const { return m_stageBursts[index].load(std::memory_order_relaxed); }
+
+	// 退出时打印（缩进两格，接在各来源的统计之后）
+	void PrintSummary() const;
+
+private:
+	struct Stage
+	{
+		std::string name;
+		BusyReader busyNs;
+	};
+
+	struct Burst
+	{
+		uint64_t firstFrameId;
+		uint64_t count;
+	};
+
+	struct Sample
+	{
+		std::chrono::steady_clock::time_point time;
+		uint64_t busyNs[kMaxStages];
+	};
+
+	uint64_t ExpectedPeriodNs() const;
+
+	double m_rateTolerance;
+	std::vector<Stage> m_stages;
+	std::atomic<uint64_t> m_stageBursts[kMaxStages];
+	std::atomic<uint64_t> m_expectedPeriodNs{0};
+
+	// 仅抓图线程
+	bool m_started = false;
+	uint64_t m_lastFrameId = 0;
+	uint64_t m_lastTimestamp = 0;
+	double m_learnedPeriodNs = 0.0;
+
+	std::atomic<uint64_t> m_frames{0};	// 收到的帧 + 丢失的帧
+	std::atomic<uint64_t> m_spanNs{0};	// 相邻帧相机时间戳间隔之和
+	std::atomic<uint64_t> m_missing{0};
+	std::atomic<uint64_t> m_bursts{0};
+	std::atomic<uint64_t> m_largestBurst{0};
+	std::atomic<uint64_t> m_stalls{0};
+	std::atomic<uint64_t> m_restarts{0};
+	LatencyHistogram m_jitter;
+
+	// 抓图线程记录、主线程归因的丢帧突发
+	std::mutex m_pendingMutex;
+	std::vector<Burst> m_pending;
+
+	// 仅主线程
+	std::vector<Sample> m_samples; // 约每 100 ms 一个，保留最近约 1 秒
+	std::chrono::steady_clock::time_point m_lastPrint;
+	uint64_t m_unprinted = 0;
+	uint64_t m_checkedFrames = 0;
+	uint64_t m_checkedSpanNs = 0;
+};
@@ -0,0 +1,114 @@
+﻿#include "FrameHistory.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+using namespace Spinnaker;
+using namespace std;
+
+FrameHistory::FrameHistory(size_t budgetBytes) : m_budgetBytes(budgetBytes)
+{
+}
+
+size_t FrameHistory::SlotCount() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_slots.size();
+}
+
+void FrameHistory::Record(const Frame &frame)
+{
+	std::shared_ptr<Frame> slot;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (m_slots.empty())
+		{
+			// 按第一帧的大小分配，至少两个槽
+			const size_t frameBytes = std::max<size_t>(1, frame.image->GetImageSize());
+			const size_t count = std::max<size_t>(2, m_budgetBytes / frameBytes);
+			for (size_t i = 0; i < count; i++)
+			{
+				std::shared_ptr<Frame> entry = std::make_shared<Frame>();
+				entry->image = Image::Create();
+				entry->seq = FrameRing::kInvalidSeq;
+				m_slots.push_back(entry);
+			}
+			cout << "Pre-trigger history: " << count << " frames (" << count * frameBytes / (1024 * 1024) << " MB)" << endl;
+		}
+
+		// 从最旧的槽开始找没有被持有的槽（只有这里会增加引用，所以加锁时看到的 use_count 可靠）
+		for (size_t i = 0; i < m_slots.size(); i++)
+		{
+			const size_t candidate = (m_next + i) % m_slots.size();
+			if (m_slots[candidate].use_count() == 1)
+			{
+				slot = m_slots[candidate];
+				slot->seq = FrameRing::kInvalidSeq; // 写入期间不可被取出
+				m_next = candidate + 1;
+				break;
+			}
+		}
+	}
+
+	if (!slot)
+	{
+		m_overruns.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	// 在锁外复制像素数据
+	CopyImage(frame.image, slot->image);
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		slot->frameId = frame.frameId;
+		slot->timestamp = frame.timestamp;
+		slot->hostTime = frame.hostTime;
+		slot->chunk = frame.chunk;
+		slot->seq = frame.seq;
+	}
+	m_newestSeq.store(frame.seq, std::memory_order_release);
+}
+
+std::vector<FrameHistory::Pin> FrameHistory::Range(uint64_t firstSeq, uint64_t lastSeq) const
+{
+	std::vector<Pin> result;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		for (const auto &slot : m_slots)
+		{
+			if (slot->seq != FrameRing::kInvalidSeq && slot->seq >= firstSeq && slot->seq <= lastSeq)
+			{
+				result.push_back(slot);
+			}
+		}
+	}
+	std::sort(result.begin(), result.end(), [](const Pin &a, const Pin &b) { return a->seq < b->seq; });
+	return result;
+}
+
+void FrameHistory::CopyImage(const ImagePtr &src, const ImagePtr &dest)
+{
+	const size_t width = src->GetWidth();
+	const size_t height = src->GetHeight();
+	if (dest->GetWidth() != width || dest->GetHeight() != height || dest->GetPixelFormat() != src->GetPixelFormat())
+	{
+		dest->ResetImage(width, height, src->GetXOffset(), src->GetYOffset(), src->GetPixelFormat());
+	}
+
+	// 按行复制，源图像可能带有 X 方向填充
+	const size_t rowBytes = width * src->GetBitsPerPixel() / 8;
+	const size_t srcStride = src->GetStride() != 0 ? src->GetStride() : rowBytes;
+	const size_t destStride = dest->GetStride() != 0 ? dest->GetStride() : rowBytes;
+	const uint8_t *pSrc = static_cast<const uint8_t *>(src->GetData());
+	uint8_t *pDest = static_cast<uint8_t *>(dest->GetData());
+	if (srcStride == rowBytes && destStride == rowBytes)
+	{
+		memcpy(pDest, pSrc, rowBytes * height);
+		return;
+	}
+	for (size_t y = 0; y < height; y++)
+	{
+		memcpy(pDest + y * destStride, pSrc + y * srcStride, rowBytes);
+	}
+}
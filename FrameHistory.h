@@ -0,0 +1,48 @@
+﻿#pragma once
+
+#include "Spinnaker.h"
+#include "FrameRing.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// 预触发历史：把最近的原始帧（未转换）复制到按内存预算预先分配的槽中，按帧环序号检索。
+// 与 FrameRing 不同，它不占用相机流缓冲，因此可以保留远多于流缓冲数量的帧，
+// 按空格时能取出显示的那一帧及其前后若干帧一起保存。
+class FrameHistory
+{
+public:
+	// 被取出的帧：持有期间对应的槽不会被覆盖
+	typedef std::shared_ptr<const Frame> Pin;
+
+	explicit FrameHistory(size_t budgetBytes);
+
+	FrameHistory(const FrameHistory &) = delete;
+	FrameHistory &operator=(const FrameHistory &) = delete;
+
+	// 仅生产者线程调用：复制一帧，覆盖最旧且未被持有的槽。
+	// 第一次调用时按帧大小和内存预算确定槽数
+	void Record(const Frame &frame);
+
+	// 任意线程调用：取序号在 [firstSeq, lastSeq] 内、仍在历史中的帧，按序号排列
+	std::vector<Pin> Range(uint64_t firstSeq, uint64_t lastSeq) const;
+
+	// 已记录的最新序号，尚无帧时为 FrameRing::kInvalidSeq
+	uint64_t NewestSeq() const { return m_newestSeq.load(std::memory_order_acquire); }
+	size_t SlotCount() const;
+	// 所有槽都被持有、只能跳过的帧数
+	uint64_t Overruns() const { return m_overruns.load(std::memory_order_relaxed); }
+
+	// 按行复制像素数据，尺寸或格式不同时先重设 dest（录像队列同样使用）
+	static void CopyImage(const Spinnaker::ImagePtr &src, const Spinnaker::ImagePtr &dest);
+
+private:
+	size_t m_budgetBytes;
+	mutable std::mutex m_mutex;
+	std::vector<std::shared_ptr<Frame>> m_slots; // seq 为 kInvalidSeq 表示空或正在写入
+	size_t m_next = 0;							 // 仅生产者访问
+	std::atomic<uint64_t> m_newestSeq{FrameRing::kInvalidSeq};
+	std::atomic<uint64_t> m_overruns{0};
+};
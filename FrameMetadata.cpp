@@ -0,0 +1,182 @@
+﻿#include "FrameMetadata.h"
+#include "SpinGenApi/SpinnakerGenApi.h"
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+using namespace Spinnaker;
+using namespace Spinnaker::GenApi;
+using namespace std;
+
+namespace
+{
+struct ChunkName
+{
+	ChunkField field;
+	const char *selector; // ChunkSelector 的枚举项
+};
+
+const ChunkName kChunkNames[] = {
+	{CHUNK_TIMESTAMP, "Timestamp"},
+	{CHUNK_FRAME_ID, "FrameID"},
+	{CHUNK_EXPOSURE_TIME, "ExposureTime"},
+	{CHUNK_GAIN, "Gain"},
+	{CHUNK_CRC, "CRC"},
+};
+
+// 把 JSON 字符串中的特殊字符转义
+std::string JsonString(const std::string &text)
+{
+	std::string escaped = "\"";
+	for (char c : text)
+	{
+		if (c == '"' || c == '\\')
+		{
+			escaped += '\\';
+		}
+		escaped += c;
+	}
+	return escaped + "\"";
+}
+} // namespace
+
+unsigned ConfigureChunkData(CameraPtr pCam, unsigned fields)
+{
+	unsigned enabled = 0;
+
+	try
+	{
+		INodeMap &nodeMap = pCam->GetNodeMap();
+
+		CBooleanPtr ptrModeActive = nodeMap.GetNode("ChunkModeActive");
+		if (!IsReadable(ptrModeActive) || (!ptrModeActive->GetValue() && !IsWritable(ptrModeActive)))
+		{
+			cout << "Chunk data not available on this camera..." << endl;
+			return 0;
+		}
+		if (!ptrModeActive->GetValue())
+		{
+			ptrModeActive->SetValue(true);
+		}
+
+		CEnumerationPtr ptrSelector = nodeMap.GetNode("ChunkSelector");
+		CBooleanPtr ptrEnable = nodeMap.GetNode("ChunkEnable");
+		if (!IsWritable(ptrSelector))
+		{
+			cout << "ChunkSelector not writable..." << endl;
+			return 0;
+		}
+
+		std::string missing;
+		for (const ChunkName &chunk : kChunkNames)
+		{
+			if ((fields & chunk.field) == 0)
+			{
+				continue;
+			}
+			CEnumEntryPtr ptrEntry = ptrSelector->GetEntryByName(chunk.selector);
+			if (!IsReadable(ptrEntry))
+			{
+				missing += std::string(" ") + chunk.selector;
+				continue;
+			}
+			ptrSelector->SetIntValue(ptrEntry->GetValue());
+
+			// 有些项（如 Timestamp）固定启用，ChunkEnable 只读
+			if (IsReadable(ptrEnable) && !ptrEnable->GetValue())
+			{
+				if (!IsWritable(ptrEnable))
+				{
+					missing += std::string(" ") + chunk.selector;
+					continue;
+				}
+				ptrEnable->SetValue(true);
+			}
+			enabled |= chunk.field;
+		}
+
+		cout << "Chunk data enabled:";
+		for (const ChunkName &chunk : kChunkNames)
+		{
+			if (enabled & chunk.field)
+			{
+				cout << " " << chunk.selector;
+			}
+		}
+		if (!missing.empty())
+		{
+			cout << " (not available:" << missing << ")";
+		}
+		cout << "..." << endl;
+	}
+	catch (Spinnaker::Exception &e)
+	{
+		cout << "Error: " << e.what() << endl;
+	}
+
+	return enabled;
+}
+
+bool ReadChunkData(const ImagePtr &image, unsigned fields, Frame &frame)
+{
+	try
+	{
+		const ChunkData &chunkData = image->GetChunkData();
+		if (fields & CHUNK_TIMESTAMP)
+		{
+			frame.timestamp = static_cast<uint64_t>(chunkData.GetTimestamp());
+		}
+		if (fields & CHUNK_FRAME_ID)
+		{
+			frame.frameId = static_cast<uint64_t>(chunkData.GetFrameID());
+		}
+		if (fields & CHUNK_EXPOSURE_TIME)
+		{
+			frame.chunk.exposureUs = chunkData.GetExposureTime();
+		}
+		if (fields & CHUNK_GAIN)
+		{
+			frame.chunk.gainDb = chunkData.GetGain();
+		}
+		if (fields & CHUNK_CRC)
+		{
+			frame.chunk.crcOk = !image->HasCRC() || image->CheckCRC();
+		}
+		frame.chunk.valid = true;
+		return true;
+	}
+	catch (Spinnaker::Exception &)
+	{
+		frame.chunk = FrameChunk();
+		return false;
+	}
+}
+
+std::string FormatSidecar(const Frame &frame, const std::string &source, int groupId)
+{
+	std::ostringstream out;
+	out << std::setprecision(10);
+	out << "{\n";
+	out << "  \"source\": " << JsonString(source) << ",\n";
+	out << "  \"group_id\": " << groupId << ",\n";
+	out << "  \"seq\": " << frame.seq << ",\n";
+	out << "  \"frame_id\": " << frame.frameId << ",\n";
+	out << "  \"camera_timestamp_ns\": " << frame.timestamp << ",\n";
+	out << "  \"host_time_ns\": "
+		<< std::chrono::duration_cast<std::chrono::nanoseconds>(frame.hostTime.time_since_epoch()).count() << ",\n";
+	out << "  \"chunk\": " << (frame.chunk.valid ? "true" : "false");
+	if (frame.chunk.valid)
+	{
+		if (frame.chunk.exposureUs >= 0.0)
+		{
+			out << ",\n  \"exposure_us\": " << frame.chunk.exposureUs;
+		}
+		if (frame.chunk.gainDb >= 0.0)
+		{
+			out << ",\n  \"gain_db\": " << frame.chunk.gainDb;
+		}
+		out << ",\n  \"crc_ok\": " << (frame.chunk.crcOk ? "true" : "false");
+	}
+	out << "\n}\n";
+	return out.str();
+}
@@ -0,0 +1,28 @@
+﻿#pragma once
+
+#include "Spinnaker.h"
+#include "FrameRing.h"
+#include <string>
+
+// 相机随帧传回的 chunk 数据项（按位组合）
+enum ChunkField
+{
+	CHUNK_TIMESTAMP = 1 << 0,
+	CHUNK_FRAME_ID = 1 << 1,
+	CHUNK_EXPOSURE_TIME = 1 << 2,
+	CHUNK_GAIN = 1 << 3,
+	CHUNK_CRC = 1 << 4,
+	CHUNK_ALL = CHUNK_TIMESTAMP | CHUNK_FRAME_ID | CHUNK_EXPOSURE_TIME | CHUNK_GAIN | CHUNK_CRC
+};
+
+// 在开始采集之前、分配用户缓冲区之前调用（chunk 会增大 PayloadSize）：打开 ChunkModeActive，
+// 再通过 ChunkSelector / ChunkEnable 启用 fields 中相机支持的各项，已启用的不再写入。
+// 返回实际启用的项，相机不支持 chunk 时为 0
+unsigned ConfigureChunkData(Spinnaker::CameraPtr pCam, unsigned fields = CHUNK_ALL);
+
+// 抓图线程中每帧调用：通过 Image::GetChunkData() 读取 fields 中的各项，
+// 相机时间戳和 FrameID 覆盖 frame.timestamp / frame.frameId，其余写入 frame.chunk。失败时返回 false
+bool ReadChunkData(const Spinnaker::ImagePtr &image, unsigned fields, Frame &frame);
+
+// 保存图像时一并写出的元数据（JSON），文件名为图像文件名加 ".json"
+std::string FormatSidecar(const Frame &frame, const std::string &source, int groupId);
@@ -0,0 +1,227 @@
+﻿#include "FrameRing.h"
+
+using namespace Spinnaker;
+
+//=========================== FrameRef ======================================
+
+FrameRef::FrameRef(const FrameRing *pRing, uint32_t index) : m_pRing(pRing), m_index(index)
+{
+}
+
+FrameRef::FrameRef(const FrameRef &other) : m_pRing(other.m_pRing), m_index(other.m_index)
+{
+	// 已持有引用，计数必然大于 0，直接加一即可
+	if (m_pRing != nullptr)
+	{
+		m_pRing->m_pool[m_index].refs.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+FrameRef::FrameRef(FrameRef &&other) noexcept : m_pRing(other.m_pRing), m_index(other.m_index)
+{
+	other.m_pRing = nullptr;
+}
+
+FrameRef &FrameRef::operator=(FrameRef other) noexcept
+{
+	std::swap(m_pRing, other.m_pRing);
+	std::swap(m_index, other.m_index);
+	return *this;
+}
+
+FrameRef::~FrameRef()
+{
+	Reset();
+}
+
+const Frame &FrameRef::operator*() const
+{
+	return m_pRing->m_pool[m_index].frame;
+}
+
+const Frame *FrameRef::operator->() const
+{
+	return &m_pRing->m_pool[m_index].frame;
+}
+
+void FrameRef::Reset()
+{
+	if (m_pRing != nullptr)
+	{
+		m_pRing->Unref(m_index);
+		m_pRing = nullptr;
+	}
+}
+
+//=========================== FrameRing =====================================
+
+FrameRing::FrameRing(size_t capacity, size_t maxHeld, Releaser releaser)
+	: m_releaser(std::move(releaser)),
+	  m_capacity(capacity > 0 ? capacity : 1),
+	  m_poolSize(m_capacity + maxHeld),
+	  m_pool(new Entry[m_poolSize]),
+	  m_slots(new std::atomic<uint32_t>[m_capacity])
+{
+	for (size_t i = 0; i < m_capacity; i++)
+	{
+		m_slots[i].store(kNoEntry, std::memory_order_relaxed);
+	}
+}
+
+FrameRing::~FrameRing()
+{
+	Clear();
+}
+
+bool FrameRing::Push(Frame frame)
+{
+	// 查找空闲帧槽（从上次位置开始轮询，避免总是争用同一个槽）
+	uint32_t index = kNoEntry;
+	for (size_t i = 0; i < m_poolSize; i++)
+	{
+		const size_t candidate = (m_nextEntry + i) % m_poolSize;
+		bool expected = true;
+		if (m_pool[candidate].free.compare_exchange_strong(expected, false, std::memory_order_acq_rel))
+		{
+			index = static_cast<uint32_t>(candidate);
+			m_nextEntry = candidate + 1;
+			break;
+		}
+	}
+
+	// 所有帧槽都被消费者占用：立即归还缓冲，保证抓图线程不被阻塞
+	if (index == kNoEntry)
+	{
+		ReleaseImage(frame.image);
+		m_dropped.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+
+	const uint64_t seq = m_head.load(std::memory_order_relaxed);
+
+	Entry &entry = m_pool[index];
+	frame.seq = seq;
+	entry.frame = std::move(frame);
+	entry.refs.store(1, std::memory_order_relaxed); // 环本身持有的引用
+	entry.seq.store(seq, std::memory_order_release);
+
+	// 发布新帧，并让出被覆盖的最旧帧
+	const uint32_t old = m_slots[seq % m_capacity].exchange(index, std::memory_order_acq_rel);
+	m_head.store(seq + 1, std::memory_order_release);
+
+	if (old != kNoEntry)
+	{
+		m_pool[old].seq.store(kInvalidSeq, std::memory_order_release);
+		Unref(old);
+	}
+	return true;
+}
+
+void FrameRing::Clear()
+{
+	for (size_t i = 0; i < m_capacity; i++)
+	{
+		const uint32_t old = m_slots[i].exchange(kNoEntry, std::memory_order_acq_rel);
+		if (old != kNoEntry)
+		{
+			m_pool[old].seq.store(kInvalidSeq, std::memory_order_release);
+			Unref(old);
+		}
+	}
+}
+
+FrameRef FrameRing::Latest() const
+{
+	// 生产者可能恰好覆盖了刚读到的位置，重试几次即可
+	for (int attempt = 0; attempt < 4; attempt++)
+	{
+		const uint64_t head = Head();
+		if (head == 0)
+		{
+			break;
+		}
+		FrameRef ref = Acquire(head - 1);
+		if (ref)
+		{
+			return ref;
+		}
+	}
+	return FrameRef();
+}
+
+FrameRef FrameRing::Acquire(uint64_t seq) const
+{
+	const uint64_t head = Head();
+	if (seq >= head || head - seq > m_capacity)
+	{
+		return FrameRef();
+	}
+
+	const uint32_t index = m_slots[seq % m_capacity].load(std::memory_order_acquire);
+	if (index == kNoEntry || !TryRef(index))
+	{
+		return FrameRef();
+	}
+
+	// 加引用后再确认序号，防止拿到已被回收并复用的帧槽
+	if (m_pool[index].seq.load(std::memory_order_acquire) != seq)
+	{
+		Unref(index);
+		return FrameRef();
+	}
+	return FrameRef(this, index);
+}
+
+uint64_t FrameRing::Oldest() const
+{
+	const uint64_t head = Head();
+	return head > m_capacity ? head - m_capacity : 0;
+}
+
+bool FrameRing::TryRef(uint32_t index) const
+{
+	// 仅当计数非零时加一：计数为零的帧槽正在或已经被释放
+	std::atomic<uint32_t> &refs = m_pool[index].refs;
+	uint32_t current = refs.load(std::memory_order_relaxed);
+	while (current != 0)
+	{
+		if (refs.compare_exchange_weak(current, current + 1, std::memory_order_acquire, std::memory_order_relaxed))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+void FrameRing::Unref(uint32_t index) const
+{
+	Entry &entry = m_pool[index];
+	if (entry.refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+	{
+		// 最后一个引用：归还 SDK 缓冲，帧槽可再次被生产者使用
+		if (entry.frame.image != nullptr)
+		{
+			ReleaseImage(entry.frame.image);
+		}
+		entry.frame.image = nullptr;
+		entry.free.store(true, std::memory_order_release);
+	}
+}
+
+void FrameRing::ReleaseImage(const ImagePtr &image) const
+{
+	try
+	{
+		if (m_releaser)
+		{
+			m_releaser(image);
+		}
+		else
+		{
+			image->Release();
+		}
+	}
+	catch (Spinnaker::Exception &)
+	{
+	}
+}
@@ -0,0 +1,114 @@
+﻿#pragma once
+
+#include "Spinnaker.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+// 一帧相机图像及其抓取信息。image 在最后一个引用释放时才调用 Release() 归还给 SDK。
+// 相机随帧传回的 chunk 数据（见 FrameMetadata.h），未启用或解析失败时 valid 为 false
+struct FrameChunk
+{
+	bool valid = false;
+	double exposureUs = -1.0; // ChunkExposureTime
+	double gainDb = -1.0;	  // ChunkGain
+	bool crcOk = true;		  // 未启用 CRC chunk 时恒为 true
+};
+
+struct Frame
+{
+	Spinnaker::ImagePtr image;
+	uint64_t seq = 0;								// 帧环分配的连续序号
+	uint64_t frameId = 0;							// 相机 FrameID（合成源为递增计数），启用 chunk 时取自 ChunkFrameID
+	uint64_t timestamp = 0;							// 相机时间戳，单位 ns，启用 chunk 时取自 ChunkTimestamp
+	std::chrono::steady_clock::time_point hostTime; // 主机侧到达时间
+	FrameChunk chunk;
+};
+
+class FrameRing;
+
+// 帧句柄：持有期间对应的 SDK 缓冲不会被回收（RAII，析构时自动释放引用）。
+class FrameRef
+{
+public:
+	FrameRef() = default;
+	FrameRef(const FrameRef &other);
+	FrameRef(FrameRef &&other) noexcept;
+	FrameRef &operator=(FrameRef other) noexcept;
+	~FrameRef();
+
+	explicit operator bool() const { return m_pRing != nullptr; }
+	const Frame &operator*() const;
+	const Frame *operator->() const;
+
+	void Reset();
+
+private:
+	friend class FrameRing;
+	FrameRef(const FrameRing *pRing, uint32_t index);
+
+	const FrameRing *m_pRing = nullptr;
+	uint32_t m_index = 0;
+};
+
+// 单生产者 / 多消费者的有界无锁帧环。
+// 生产者（抓图线程）只调用 Push()，永不阻塞：环满时覆盖最旧的帧；
+// 若所有帧槽都被消费者占用，则直接 Release() 新帧并计入 Dropped()。
+// 消费者通过 Latest() / Acquire(seq) 获取帧句柄，各自独立前进，互不影响。
+class FrameRing
+{
+public:
+	static constexpr uint64_t kInvalidSeq = UINT64_MAX;
+
+	// 最后一个引用释放时调用，默认为 image->Release()（归还相机缓冲）
+	typedef std::function<void(const Spinnaker::ImagePtr &)> Releaser;
+
+	// capacity：环中保留的最近帧数；maxHeld：消费者可同时额外持有的帧数。
+	// 两者之和不应超过相机流缓冲数量，否则相机会因缺少空闲缓冲而丢帧。
+	FrameRing(size_t capacity, size_t maxHeld, Releaser releaser = nullptr);
+	~FrameRing();
+
+	FrameRing(const FrameRing &) = delete;
+	FrameRing &operator=(const FrameRing &) = delete;
+
+	// 仅生产者线程调用
+	// frame.seq 由帧环分配，其余字段由调用者填写
+	bool Push(Frame frame);
+	void Clear();
+
+	// 任意线程调用
+	FrameRef Latest() const;
+	FrameRef Acquire(uint64_t seq) const;
+	uint64_t Head() const { return m_head.load(std::memory_order_acquire); }
+	uint64_t Oldest() const;
+	size_t Capacity() const { return m_capacity; }
+	uint64_t Dropped() const { return m_dropped.load(std::memory_order_relaxed); }
+
+private:
+	friend class FrameRef;
+
+	static constexpr uint32_t kNoEntry = UINT32_MAX;
+
+	struct Entry
+	{
+		std::atomic<uint32_t> refs{0};
+		std::atomic<bool> free{true};
+		std::atomic<uint64_t> seq{kInvalidSeq};
+		Frame frame;
+	};
+
+	bool TryRef(uint32_t index) const;
+	void Unref(uint32_t index) const;
+	void ReleaseImage(const Spinnaker::ImagePtr &image) const;
+
+	Releaser m_releaser;
+	size_t m_capacity;
+	size_t m_poolSize;
+	std::unique_ptr<Entry[]> m_pool;
+	std::unique_ptr<std::atomic<uint32_t>[]> m_slots;
+	std::atomic<uint64_t> m_head{0};
+	size_t m_nextEntry = 0; // 仅生产者访问
+	std::atomic<uint64_t> m_dropped{0};
+};
@@ -0,0 +1,950 @@
+﻿#include "FrameSource.h"
+#include "BufferArena.h"
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+using namespace Spinnaker;
+using namespace std;
+
+namespace fs = std::filesystem;
+
+namespace
+{
+std::chrono::steady_clock::duration PeriodFromRate(double frameRate)
+{
+	if (frameRate <= 0.0)
+	{
+		return std::chrono::steady_clock::duration::zero();
+	}
+	return std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / frameRate));
+}
+
+uint64_t NanosecondsSince(std::chrono::steady_clock::time_point start)
+{
+	return static_cast<uint64_t>(
+		std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+}
+
+// 按帧率等到下一帧的时刻；若超过 deadline 则只等到 deadline 并返回 false
+bool WaitForFrameTime(std::chrono::steady_clock::time_point &nextFrameTime,
+					  std::chrono::steady_clock::duration period,
+					  std::chrono::steady_clock::time_point deadline)
+{
+	if (period == std::chrono::steady_clock::duration::zero())
+	{
+		return true;
+	}
+	if (nextFrameTime > deadline)
+	{
+		std::this_thread::sleep_until(deadline);
+		return false;
+	}
+	std::this_thread::sleep_until(nextFrameTime);
+
+	// 生成速度跟不上设定帧率时不累积欠账
+	const auto now = std::chrono::steady_clock::now();
+	nextFrameTime += period;
+	if (nextFrameTime < now)
+	{
+		nextFrameTime = now;
+	}
+	return true;
+}
+} // namespace
+
+//=========================== FrameSource ===================================
+
+bool FrameSource::Restart(const Reconfigure &reconfigure)
+{
+	Stop();
+	bool result = false;
+	try
+	{
+		result = reconfigure();
+	}
+	catch (...)
+	{
+		Start();
+		throw;
+	}
+	Start();
+	return result;
+}
+
+//=========================== CameraSource ==================================
+
+CameraSource::CameraSource(CameraPtr pCam, const BufferArena *pArena) : m_pCam(pCam), m_pArena(pArena)
+{
+}
+
+std::string CameraSource::Name() const
+{
+	return std::string("Camera ") + m_pCam->GetDeviceID().c_str();
+}
+
+void CameraSource::Start()
+{
+	m_pCam->BeginAcquisition();
+	if (m_pArena != nullptr)
+	{
+		PrintArenaUtilization(m_pCam, *m_pArena);
+	}
+}
+
+void CameraSource::Stop()
+{
+	m_pCam->EndAcquisition();
+}
+
+GrabStatus CameraSource::Grab(uint64_t timeoutMs, Frame &frame, std::string &message)
+{
+	try
+	{
+		ImagePtr pResultImage = m_pCam->GetNextImage(timeoutMs);
+		frame.image = pResultImage;
+		frame.frameId = pResultImage->GetFrameID();
+		frame.timestamp = pResultImage->GetTimeStamp();
+		frame.hostTime = std::chrono::steady_clock::now();
+
+		if (pResultImage->IsIncomplete())
+		{
+			message = Image::GetImageStatusDescription(pResultImage->GetImageStatus());
+			return GRAB_INCOMPLETE;
+		}
+		return GRAB_OK;
+	}
+	catch (Spinnaker::Exception &e)
+	{
+		if (e.GetError() == SPINNAKER_ERR_TIMEOUT)
+		{
+			return GRAB_TIMEOUT;
+		}
+		message = e.what();
+		return GRAB_ERROR;
+	}
+}
+
+void CameraSource::Release(const ImagePtr &image)
+{
+	image->Release();
+}
+
+bool CameraSource::Restart(const Reconfigure &reconfigure)
+{
+	// EndAcquisition() 会丢弃输出队列中还没取走的帧
+	m_pCam->EndAcquisition();
+	bool result = false;
+	try
+	{
+		result = reconfigure();
+	}
+	catch (...)
+	{
+		m_pCam->BeginAcquisition();
+		throw;
+	}
+	m_pCam->BeginAcquisition();
+	return result;
+}
+
+//=========================== EventCameraSource =============================
+
+EventCameraSource::EventCameraSource(CameraPtr pCam, const BufferArena *pArena, size_t queueCapacity)
+	: m_pCam(pCam), m_pArena(pArena), m_queueCapacity(std::max<size_t>(1, queueCapacity)), m_handler(*this)
+{
+}
+
+EventCameraSource::~EventCameraSource()
+{
+	// 必须在 DeInit() 之前注销，否则 DeInit() 会抛异常
+	try
+	{
+		Unregister();
+	}
+	catch (Spinnaker::Exception &e)
+	{
+		cout << "Error: " << e.what() << endl;
+	}
+}
+
+std::string EventCameraSource::Name() const
+{
+	return std::string("Camera ") + m_pCam->GetDeviceID().c_str() + " (image events)";
+}
+
+void EventCameraSource::Start()
+{
+	// 先注册再开始采集，第一帧就走回调
+	if (!m_registered)
+	{
+		m_pCam->RegisterEventHandler(m_handler);
+		m_registered = true;
+	}
+	m_pCam->BeginAcquisition();
+	if (m_pArena != nullptr)
+	{
+		PrintArenaUtilization(m_pCam, *m_pArena);
+	}
+}
+
+void EventCameraSource::Stop()
+{
+	m_pCam->EndAcquisition();
+	Unregister();
+	ReleaseQueued();
+
+	cout << Name() << ": handoff p50 " << m_handoffLatency.Percentile(0.5) / 1000.0 << " us, p99 "
+		 << m_handoffLatency.Percentile(0.99) / 1000.0 << " us, max " << m_handoffLatency.Max() / 1000.0
+		 << " us, queue drops " << Dropped() << endl;
+}
+
+bool EventCameraSource::Restart(const Reconfigure &reconfigure)
+{
+	m_pCam->EndAcquisition();
+	ReleaseQueued();
+	bool result = false;
+	try
+	{
+		result = reconfigure();
+	}
+	catch (...)
+	{
+		m_pCam->BeginAcquisition();
+		throw;
+	}
+	m_pCam->BeginAcquisition();
+	return result;
+}
+
+// 归还回调已入队、还没被取走的帧
+void EventCameraSource::ReleaseQueued()
+{
+	std::deque<Frame> pending;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		pending.swap(m_queue);
+	}
+	for (Frame &frame : pending)
+	{
+		frame.image->Release();
+	}
+}
+
+void EventCameraSource::Unregister()
+{
+	if (m_registered)
+	{
+		m_registered = false;
+		m_pCam->UnregisterEventHandler(m_handler);
+	}
+}
+
+void EventCameraSource::Handler::OnImageEvent(ImagePtr image)
+{
+	// SDK 回调线程：只记录到达时间并入队，不做任何处理
+	Frame frame;
+	frame.image = image;
+	frame.hostTime = std::chrono::steady_clock::now();
+	frame.frameId = image->GetFrameID();
+	frame.timestamp = image->GetTimeStamp();
+
+	bool queued = false;
+	{
+		std::lock_guard<std::mutex> lock(m_owner.m_mutex);
+		if (m_owner.m_queue.size() < m_owner.m_queueCapacity)
+		{
+			m_owner.m_queue.push_back(std::move(frame));
+			queued = true;
+		}
+	}
+
+	if (queued)
+	{
+		m_owner.m_ready.notify_one();
+	}
+	else
+	{
+		// 抓图线程跟不上时不阻塞 SDK 线程，直接归还缓冲
+		image->Release();
+		m_owner.m_dropped++;
+	}
+}
+
+GrabStatus EventCameraSource::Grab(uint64_t timeoutMs, Frame &frame, std::string &message)
+{
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		if (!m_ready.wait_for(lock, std::chrono::milliseconds(timeoutMs), [this] { return !m_queue.empty(); }))
+		{
+			return GRAB_TIMEOUT;
+		}
+		frame = std::move(m_queue.front());
+		m_queue.pop_front();
+	}
+	m_handoffLatency.Record(NanosecondsSince(frame.hostTime));
+
+	if (frame.image->IsIncomplete())
+	{
+		message = Image::GetImageStatusDescription(frame.image->GetImageStatus());
+		return GRAB_INCOMPLETE;
+	}
+	return GRAB_OK;
+}
+
+void EventCameraSource::Release(const ImagePtr &image)
+{
+	image->Release();
+}
+
+//=========================== SyntheticSource ===============================
+
+SyntheticSource::SyntheticSource(const SyntheticConfig &config)
+	: m_config(config), m_period(PeriodFromRate(config.frameRate))
+{
+	static const PixelFormatEnums formats8[] = {
+		PixelFormat_Mono8, PixelFormat_BayerRG8, PixelFormat_BayerGB8, PixelFormat_BayerGR8, PixelFormat_BayerBG8};
+	static const PixelFormatEnums formats16[] = {
+		PixelFormat_Mono16, PixelFormat_BayerRG16, PixelFormat_BayerGB16, PixelFormat_BayerGR16, PixelFormat_BayerBG16};
+	m_pixelFormat = m_config.sixteenBit ? formats16[m_config.bayer] : formats8[m_config.bayer];
+
+	// 噪声表：长度留出一行的余量，渲染时每行从随机位置开始连续读取
+	m_noise.resize((1u << 16) + m_config.width);
+	std::mt19937 random(m_config.seed);
+	std::normal_distribution<double> gauss(0.0, m_config.noiseSigma > 0.0 ? m_config.noiseSigma : 1.0);
+	for (auto &n : m_noise)
+	{
+		n = m_config.noiseSigma > 0.0 ? static_cast<int16_t>(std::lround(gauss(random))) : 0;
+	}
+}
+
+std::string SyntheticSource::Name() const
+{
+	std::ostringstream name;
+	name << "Synthetic " << m_config.width << "x" << m_config.height << " "
+		 << (m_config.bayer == BAYER_NONE ? "Mono" : "Bayer") << (m_config.sixteenBit ? 16 : 8) << " @ "
+		 << m_config.frameRate << " fps";
+	return name.str();
+}
+
+void SyntheticSource::Start()
+{
+	m_buffers.clear();
+	m_freeBuffers.clear();
+	for (size_t i = 0; i < m_config.bufferCount; i++)
+	{
+		ImagePtr image = Image::Create();
+		image->ResetImage(m_config.width, m_config.height, 0, 0, m_pixelFormat);
+		m_buffers.push_back(image);
+		m_freeBuffers.push_back(i);
+	}
+
+	m_frameId = 0;
+	m_underruns = 0;
+	m_startTime = std::chrono::steady_clock::now();
+	m_nextFrameTime = m_startTime;
+}
+
+void SyntheticSource::Stop()
+{
+	std::lock_guard<std::mutex> lock(m_freeMutex);
+	m_freeBuffers.clear();
+	m_buffers.clear();
+}
+
+GrabStatus SyntheticSource::Grab(uint64_t timeoutMs, Frame &frame, std::string &message)
+{
+	const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+	while (true)
+	{
+		if (!WaitForFrameTime(m_nextFrameTime, m_period, deadline))
+		{
+			return GRAB_TIMEOUT;
+		}
+
+		size_t index;
+		if (m_period == std::chrono::steady_clock::duration::zero())
+		{
+			// 不限速：等缓冲归还后立即出下一帧，不计丢帧
+			std::unique_lock<std::mutex> lock(m_freeMutex);
+			if (!m_freeChanged.wait_until(lock, deadline, [this] { return !m_freeBuffers.empty(); }))
+			{
+				return GRAB_TIMEOUT;
+			}
+			index = m_freeBuffers.back();
+			m_freeBuffers.pop_back();
+		}
+		else if (!TakeFreeBuffer(index))
+		{
+			// 相机每个周期都会产生一帧；没有空闲缓冲时这一帧就丢了
+			m_frameId++;
+			m_underruns++;
+			if (std::chrono::steady_clock::now() >= deadline)
+			{
+				return GRAB_TIMEOUT;
+			}
+			continue;
+		}
+		const uint64_t frameId = m_frameId++;
+
+		Render(m_buffers[index], frameId);
+		frame.image = m_buffers[index];
+		frame.frameId = frameId;
+		frame.timestamp = NanosecondsSince(m_startTime);
+		frame.hostTime = std::chrono::steady_clock::now();
+		message.clear();
+		return GRAB_OK;
+	}
+}
+
+void SyntheticSource::Release(const ImagePtr &image)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_freeMutex);
+		for (size_t i = 0; i < m_buffers.size(); i++)
+		{
+			if (m_buffers[i]->GetData() == image->GetData())
+			{
+				m_freeBuffers.push_back(i);
+				break;
+			}
+		}
+	}
+	m_freeChanged.notify_one();
+}
+
+bool SyntheticSource::TakeFreeBuffer(size_t &index)
+{
+	std::lock_guard<std::mutex> lock(m_freeMutex);
+	if (m_freeBuffers.empty())
+	{
+		return false;
+	}
+	index = m_freeBuffers.back();
+	m_freeBuffers.pop_back();
+	return true;
+}
+
+void SyntheticSource::Render(const ImagePtr &image, uint64_t frameId) const
+{
+	// 通道布局：按 (y & 1) * 2 + (x & 1) 索引，0 = R，1 = G，2 = B，3 = 黑白
+	static const int channels[5][4] = {{3, 3, 3, 3}, {0, 1, 1, 2}, {1, 2, 0, 1}, {1, 0, 2, 1}, {2, 1, 1, 0}};
+	const int *layout = channels[m_config.bayer];
+
+	const size_t width = m_config.width;
+	const size_t height = m_config.height;
+	const size_t bytesPerPixel = m_config.sixteenBit ? 2 : 1;
+	size_t stride = image->GetStride();
+	if (stride == 0)
+	{
+		stride = width * bytesPerPixel;
+	}
+	uint8_t *pData = static_cast<uint8_t *>(image->GetData());
+
+	// 对角渐变随帧号移动，R/G/B 各通道使用不同的图案，便于检查去马赛克结果
+	const size_t shift = static_cast<size_t>(frameId * 4);
+	const size_t noiseSpan = m_noise.size() - width;
+	const size_t noiseStart = static_cast<size_t>(frameId * 2654435761u) % noiseSpan;
+
+	for (size_t y = 0; y < height; y++)
+	{
+		uint8_t *pRow = pData + y * stride;
+		const int16_t *pNoise = &m_noise[(noiseStart + y * 7919) % noiseSpan];
+		const int *rowLayout = layout + (y & 1) * 2;
+
+		for (size_t x = 0; x < width; x++)
+		{
+			const int base = static_cast<int>((x + y + shift) & 0xFF);
+			int value;
+			switch (rowLayout[x & 1])
+			{
+			case 0:
+				value = base;
+				break;
+			case 1:
+				value = static_cast<int>(x * 255 / width);
+				break;
+			case 2:
+				value = 255 - base;
+				break;
+			default:
+				value = base;
+			}
+			value = std::min(255, std::max(0, value + pNoise[x]));
+
+			if (bytesPerPixel == 1)
+			{
+				pRow[x] = static_cast<uint8_t>(value);
+			}
+			else
+			{
+				reinterpret_cast<uint16_t *>(pRow)[x] = static_cast<uint16_t>(value * 257);
+			}
+		}
+	}
+}
+
+//=========================== ReplaySource ==================================
+
+ReplaySource::ReplaySource(const std::string &folder, double frameRate, bool loop)
+	: m_folder(folder), m_loop(loop), m_period(PeriodFromRate(frameRate))
+{
+}
+
+std::string ReplaySource::Name() const
+{
+	return "Replay " + m_folder;
+}
+
+void ReplaySource::Start()
+{
+	m_images.clear();
+
+	std::vector<fs::path> files;
+	if (fs::is_directory(m_folder))
+	{
+		for (const auto &entry : fs::directory_iterator(m_folder))
+		{
+			if (entry.is_regular_file())
+			{
+				files.push_back(entry.path());
+			}
+		}
+	}
+	std::sort(files.begin(), files.end());
+
+	// 预先全部读入内存，回放速度不受磁盘影响
+	for (const auto &file : files)
+	{
+		std::string ext = file.extension().string();
+		std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return static_cast<char>(tolower(c)); });
+
+		try
+		{
+			if (ext == ".si" || ext == ".raw")
+			{
+				m_images.push_back(Image::Load(file.string().c_str()));
+				continue;
+			}
+
+			cv::Mat mat = cv::imread(file.string(), cv::IMREAD_GRAYSCALE | cv::IMREAD_ANYDEPTH);
+			if (mat.empty())
+			{
+				continue;
+			}
+
+			const bool sixteenBit = mat.depth() == CV_16U;
+			ImagePtr image = Image::Create();
+			image->ResetImage(mat.cols, mat.rows, 0, 0, sixteenBit ? PixelFormat_Mono16 : PixelFormat_Mono8);
+			const size_t rowBytes = static_cast<size_t>(mat.cols) * (sixteenBit ? 2 : 1);
+			size_t stride = image->GetStride();
+			if (stride == 0)
+			{
+				stride = rowBytes;
+			}
+			for (int y = 0; y < mat.rows; y++)
+			{
+				memcpy(static_cast<uint8_t *>(image->GetData()) + y * stride, mat.ptr<uchar>(y), rowBytes);
+			}
+			m_images.push_back(image);
+		}
+		catch (Spinnaker::Exception &e)
+		{
+			cout << "Failed to load " << file.string() << ": " << e.what() << endl;
+		}
+		catch (cv::Exception &e)
+		{
+			cout << "Failed to load " << file.string() << ": " << e.what() << endl;
+		}
+	}
+
+	cout << "Replay: loaded " << m_images.size() << " images from " << m_folder << endl;
+
+	m_next = 0;
+	m_frameId = 0;
+	m_startTime = std::chrono::steady_clock::now();
+	m_nextFrameTime = m_startTime;
+}
+
+void ReplaySource::Stop()
+{
+	m_images.clear();
+}
+
+GrabStatus ReplaySource::Grab(uint64_t timeoutMs, Frame &frame, std::string &message)
+{
+	const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+
+	// 不循环时播完即停，之后的 Grab() 都按超时处理
+	if (m_images.empty() || (!m_loop && m_next >= m_images.size()))
+	{
+		std::this_thread::sleep_until(deadline);
+		return GRAB_TIMEOUT;
+	}
+	if (!WaitForFrameTime(m_nextFrameTime, m_period, deadline))
+	{
+		return GRAB_TIMEOUT;
+	}
+
+	frame.image = m_images[m_next % m_images.size()];
+	frame.frameId = m_frameId++;
+	frame.timestamp = NanosecondsSince(m_startTime);
+	frame.hostTime = std::chrono::steady_clock::now();
+	m_next++;
+	message.clear();
+	return GRAB_OK;
+}
+
+void ReplaySource::Release(const ImagePtr & /*image*/)
+{
+	// 回放图像只读且常驻内存，无需归还
+}
+
+//=========================== FaultInjector =================================
+
+FaultInjector::FaultInjector(std::unique_ptr<FrameSource> inner, const FaultConfig &config)
+	: m_inner(std::move(inner)), m_config(config), m_random(config.seed), m_uniform(0.0, 1.0)
+{
+}
+
+std::string FaultInjector::Name() const
+{
+	return m_inner->Name() + " (fault injection)";
+}
+
+void FaultInjector::Start()
+{
+	m_inner->Start();
+}
+
+void FaultInjector::Stop()
+{
+	m_inner->Stop();
+}
+
+GrabStatus FaultInjector::Grab(uint64_t timeoutMs, Frame &frame, std::string &message)
+{
+	if (m_uniform(m_random) < m_config.timeoutRate)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(timeoutMs));
+		return GRAB_TIMEOUT;
+	}
+
+	const GrabStatus status = m_inner->Grab(timeoutMs, frame, message);
+	if (status == GRAB_OK && m_uniform(m_random) < m_config.incompleteRate)
+	{
+		message = "Injected incomplete frame";
+		return GRAB_INCOMPLETE;
+	}
+	return status;
+}
+
+void FaultInjector::Release(const ImagePtr &image)
+{
+	m_inner->Release(image);
+}
+
+bool FaultInjector::Restart(const Reconfigure &reconfigure)
+{
+	return m_inner->Restart(reconfigure);
+}
+
+//=========================== ReconnectingSource ============================
+
+ReconnectingSource::ReconnectingSource(std::unique_ptr<FrameSource> initial, Connector connector,
+									   Disconnector disconnector, const ReconnectConfig &config)
+	: m_name(initial->Name()), m_connector(std::move(connector)), m_disconnector(std::move(disconnector)),
+	  m_config(config), m_inner(std::move(initial))
+{
+}
+
+std::string ReconnectingSource::Name() const
+{
+	// 内部来源会被替换，名称在构造时确定
+	return m_name;
+}
+
+void ReconnectingSource::Start()
+{
+	m_inner->Start();
+	m_connectedAt = std::chrono::steady_clock::now();
+}
+
+void ReconnectingSource::Stop()
+{
+	if (m_inner && (m_state == STATE_CONNECTED || m_state == STATE_DRAINING))
+	{
+		m_inner->Stop();
+	}
+
+	if (m_recoveryLatency.Count() > 0)
+	{
+		cout << m_name << ": " << Reconnects() << " reconnects, recovery p50 " << m_recoveryLatency.Percentile(0.5) / 1e6
+			 << " ms, max " << m_recoveryLatency.Max() / 1e6 << " ms" << endl;
+	}
+}
+
+bool ReconnectingSource::Restart(const Reconfigure &reconfigure)
+{
+	// 只在锁内检查状态并标记重启中，重启本身不持锁：Release() 和掉线 / 接入通知不必等整个切换。
+	// 重启期间到达的掉线通知照常记录，由之后的 Grab() 状态机处理
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (m_state != STATE_CONNECTED || !m_inner || m_removed.load() || m_restarting)
+		{
+			return false;
+		}
+		m_restarting = true;
+	}
+
+	bool result = false;
+	std::string error;
+	try
+	{
+		result = m_inner->Restart(reconfigure);
+	}
+	catch (std::exception &e)
+	{
+		error = e.what();
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_restarting = false;
+		if (!error.empty())
+		{
+			// 多半是设备已不在；若设备其实还在，不会再有接入事件，因此直接按已接入处理，重新初始化失败时按间隔重试
+			cout << m_name << ": restart failed (" << error << "), reconnecting..." << endl;
+			if (!m_removed.load())
+			{
+				m_removedAt = std::chrono::steady_clock::now();
+			}
+			m_removed = true;
+			m_arrived = true;
+		}
+	}
+	m_changed.notify_all();
+	return result;
+}
+
+void ReconnectingSource::NotifyRemoval()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (!m_removed.load(std::memory_order_relaxed))
+		{
+			m_removedAt = std::chrono::steady_clock::now();
+		}
+		m_arrived = false;
+		m_removed = true;
+	}
+	m_changed.notify_all();
+}
+
+void ReconnectingSource::NotifyArrival()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_arrived = true;
+	}
+	m_changed.notify_all();
+}
+
+GrabStatus ReconnectingSource::Delivered(GrabStatus status)
+{
+	if (status != GRAB_OK && status != GRAB_INCOMPLETE)
+	{
+		return status;
+	}
+	m_outstanding++;
+
+	if (m_recovering && status == GRAB_OK)
+	{
+		m_recovering = false;
+		std::chrono::steady_clock::time_point removedAt;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			removedAt = m_removedAt;
+		}
+		const uint64_t recovery = NanosecondsSince(removedAt);
+		m_recoveryLatency.Record(recovery);
+		m_reconnects++;
+		cout << m_name << ": recovered, first frame " << recovery / 1e6 << " ms after removal" << endl;
+	}
+	return status;
+}
+
+GrabStatus ReconnectingSource::Grab(uint64_t timeoutMs, Frame &frame, std::string &message)
+{
+	const auto now = std::chrono::steady_clock::now();
+
+	if (m_state == STATE_CONNECTED)
+	{
+		if (m_config.simulatedUptime > 0.0 && now - m_connectedAt >= std::chrono::duration<double>(m_config.simulatedUptime))
+		{
+			cout << m_name << ": simulated removal" << endl;
+			NotifyRemoval();
+		}
+		if (!m_removed.exchange(false))
+		{
+			return Delivered(m_inner->Grab(timeoutMs, frame, message));
+		}
+		cout << m_name << ": device removed, draining frames..." << endl;
+		m_state = STATE_DRAINING;
+	}
+
+	if (m_state == STATE_DRAINING)
+	{
+		// 掉线前已经到达的帧照常交付，取完后再停止
+		const GrabStatus status = m_inner->Grab(0, frame, message);
+		if (status == GRAB_OK || status == GRAB_INCOMPLETE)
+		{
+			return Delivered(status);
+		}
+		try
+		{
+			m_inner->Stop();
+		}
+		catch (std::exception &)
+		{
+			// 设备已不在，EndAcquisition() 失败是预期的
+		}
+		m_state = STATE_RELEASING;
+		m_releaseDeadline = now + std::chrono::milliseconds(m_config.releaseTimeoutMs);
+		message = "Device removed";
+		return GRAB_DISCONNECTED;
+	}
+
+	if (m_state == STATE_RELEASING)
+	{
+		// 内部来源（及其相机缓冲）要等调用者归还所有帧后才能销毁
+		std::unique_lock<std::mutex> lock(m_mutex);
+		const auto wait = std::min(now + std::chrono::milliseconds(timeoutMs), m_releaseDeadline);
+		if (!m_changed.wait_until(lock, wait, [this] { return m_outstanding.load() == 0 && !m_restarting; }) &&
+			std::chrono::steady_clock::now() < m_releaseDeadline)
+		{
+			return GRAB_TIMEOUT;
+		}
+		if (m_restarting)
+		{
+			// 内部来源正在重启，不能销毁
+			return GRAB_TIMEOUT;
+		}
+		if (m_outstanding.load() > 0)
+		{
+			cout << "Warning: " << m_name << ": " << m_outstanding.load() << " frames still held, releasing device anyway"
+				 << endl;
+		}
+		std::unique_ptr<FrameSource> inner = std::move(m_inner);
+		lock.unlock();
+
+		inner.reset();
+		if (m_disconnector)
+		{
+			m_disconnector();
+		}
+		m_state = STATE_WAITING;
+		cout << m_name << ": waiting for device..." << endl;
+		return GRAB_TIMEOUT;
+	}
+
+	// STATE_WAITING：等待接入事件（或模拟的重新接入），失败后按间隔重试
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		auto deadline = now + std::chrono::milliseconds(timeoutMs);
+		const bool simulated = m_config.simulatedUptime > 0.0;
+		const auto simulatedArrival =
+			m_removedAt + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+							  std::chrono::duration<double>(m_config.simulatedDowntime));
+		if (simulated && simulatedArrival < deadline)
+		{
+			deadline = simulatedArrival;
+		}
+		m_changed.wait_until(lock, deadline, [this] { return m_arrived; });
+		if (simulated && std::chrono::steady_clock::now() >= simulatedArrival)
+		{
+			m_arrived = true;
+		}
+		if (!m_arrived)
+		{
+			return GRAB_TIMEOUT;
+		}
+	}
+	if (now < m_retryAt)
+	{
+		std::this_thread::sleep_until(std::min(now + std::chrono::milliseconds(timeoutMs), m_retryAt));
+		return GRAB_TIMEOUT;
+	}
+	return Reconnect(message);
+}
+
+GrabStatus ReconnectingSource::Reconnect(std::string &message)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_removed = false;
+	}
+
+	const auto start = std::chrono::steady_clock::now();
+	std::unique_ptr<FrameSource> inner;
+	try
+	{
+		inner = m_connector();
+		if (inner)
+		{
+			inner->Start();
+		}
+	}
+	catch (std::exception &e)
+	{
+		message = e.what();
+		inner.reset();
+	}
+	if (!inner)
+	{
+		// 接入事件保持有效，到时间后再试
+		m_retryAt = std::chrono::steady_clock::now() + std::chrono::milliseconds(m_config.retryIntervalMs);
+		message = "Reconnect failed" + (message.empty() ? std::string() : ": " + message);
+		return GRAB_ERROR;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_inner = std::move(inner);
+		m_arrived = false;
+	}
+	m_state = STATE_CONNECTED;
+	m_recovering = true;
+	m_connectedAt = std::chrono::steady_clock::now();
+	cout << m_name << ": reconnected in " << std::chrono::duration<double, std::milli>(m_connectedAt - start).count()
+		 << " ms, waiting for first frame..." << endl;
+	return GRAB_TIMEOUT;
+}
+
+void ReconnectingSource::Release(const ImagePtr &image)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (m_inner)
+	{
+		m_inner->Release(image);
+	}
+	else
+	{
+		// 等待归还超时后内部来源已销毁，直接还给 SDK
+		try
+		{
+			image->Release();
+		}
+		catch (Spinnaker::Exception &)
+		{
+		}
+	}
+	if (m_outstanding.fetch_sub(1) == 1)
+	{
+		m_changed.notify_all();
+	}
+}
@@ -0,0 +1,304 @@
+﻿#pragma once
+
+#include "Spinnaker.h"
+#include "FrameRing.h"
+#include "LatencyHistogram.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+
+class BufferArena;
+
+enum GrabStatus
+{
+	GRAB_OK,		 // frame 有效，需要交给 Release() 归还
+	GRAB_INCOMPLETE, // frame.image 有效但数据不完整，message 为原因，同样需要 Release()
+	GRAB_TIMEOUT,	 // 超时内没有新帧
+	GRAB_ERROR,		 // 其他错误，message 为错误信息
+	GRAB_DISCONNECTED // 来源已掉线，调用者应放开所有仍持有的帧（之后的 Grab() 会等待重新连接）
+};
+
+// 采集循环的帧来源。抓图线程只通过这个接口取帧，
+// 因此同一条流水线既可以接真实相机，也可以接合成帧或回放文件。
+class FrameSource
+{
+public:
+	virtual ~FrameSource() = default;
+
+	virtual std::string Name() const = 0;
+	virtual void Start() = 0;
+	virtual void Stop() = 0;
+
+	// 等待下一帧，最多 timeoutMs 毫秒；热路径上不抛异常
+	virtual GrabStatus Grab(uint64_t timeoutMs, Frame &frame, std::string &message) = 0;
+
+	// 归还 Grab() 得到的图像缓冲
+	virtual void Release(const Spinnaker::ImagePtr &image) = 0;
+
+	// 暂停采集、执行 reconfigure 修改相机配置（如切换分辨率、触发模式）后重新开始，返回 reconfigure 的结果。
+	// 只在没有线程调用 Grab()、且 Grab() 得到的帧都已归还时调用；已取到但还没交付的帧直接归还。
+	// 来源当前不可用（如已掉线）时不执行 reconfigure，返回 false。默认实现为 Stop() / Start()
+	using Reconfigure = std::function<bool()>;
+	virtual bool Restart(const Reconfigure &reconfigure);
+};
+
+// 真实相机：GetNextImage / Image::Release
+class CameraSource : public FrameSource
+{
+public:
+	CameraSource(Spinnaker::CameraPtr pCam, const BufferArena *pArena = nullptr);
+
+	std::string Name() const override;
+	void Start() override;
+	void Stop() override;
+	GrabStatus Grab(uint64_t timeoutMs, Frame &frame, std::string &message) override;
+	void Release(const Spinnaker::ImagePtr &image) override;
+	bool Restart(const Reconfigure &reconfigure) override;
+
+private:
+	Spinnaker::CameraPtr m_pCam;
+	const BufferArena *m_pArena;
+};
+
+// 事件驱动的相机：SDK 在自己的线程中通过 ImageEventHandler::OnImageEvent 交付图像，
+// 回调只把帧放入一个小的有界队列；Grab() 在条件变量上等待，
+// 空闲或等待触发时既不轮询 GetNextImage 也不会产生超时异常。
+class EventCameraSource : public FrameSource
+{
+public:
+	EventCameraSource(Spinnaker::CameraPtr pCam, const BufferArena *pArena = nullptr, size_t queueCapacity = 4);
+	~EventCameraSource() override;
+
+	std::string Name() const override;
+	void Start() override;
+	void Stop() override;
+	GrabStatus Grab(uint64_t timeoutMs, Frame &frame, std::string &message) override;
+	void Release(const Spinnaker::ImagePtr &image) override;
+	// 只停止 / 开始采集，事件处理器保持注册
+	bool Restart(const Reconfigure &reconfigure) override;
+
+	// 队列满时直接归还的帧数
+	uint64_t Dropped() const { return m_dropped.load(std::memory_order_relaxed); }
+	// 回调到 Grab() 取走之间的延迟
+	const LatencyHistogram &HandoffLatency() const { return m_handoffLatency; }
+
+private:
+	class Handler : public Spinnaker::ImageEventHandler
+	{
+	public:
+		explicit Handler(EventCameraSource &owner) : m_owner(owner) {}
+		void OnImageEvent(Spinnaker::ImagePtr image) override;
+
+	private:
+		EventCameraSource &m_owner;
+	};
+
+	void Unregister();
+	void ReleaseQueued();
+
+	Spinnaker::CameraPtr m_pCam;
+	const BufferArena *m_pArena;
+	size_t m_queueCapacity;
+	Handler m_handler;
+	bool m_registered = false;
+	std::mutex m_mutex;
+	std::condition_variable m_ready;
+	std::deque<Frame> m_queue;
+	std::atomic<uint64_t> m_dropped{0};
+	LatencyHistogram m_handoffLatency;
+};
+
+enum BayerPattern
+{
+	BAYER_NONE, // 黑白
+	BAYER_RG,
+	BAYER_GB,
+	BAYER_GR,
+	BAYER_BG
+};
+
+struct SyntheticConfig
+{
+	size_t width = 2048;
+	size_t height = 2048;
+	bool sixteenBit = false;	   // false 为 8 位，true 为 16 位
+	BayerPattern bayer = BAYER_RG; // 决定输出 Mono 还是 Bayer 格式
+	double frameRate = 30.0;	   // 0 表示不限速
+	double noiseSigma = 4.0;	   // 高斯噪声标准差（8 位灰度单位）
+	size_t bufferCount = 10;	   // 模拟相机流缓冲数量，全部被占用时丢帧
+	uint32_t seed = 1;
+};
+
+// 合成帧：按设定分辨率、格式和帧率生成移动的测试图案，
+// 带有限的缓冲池，缓冲耗尽时像真实相机一样丢帧（FrameID 出现间隔）。
+// 不限速（frameRate 为 0）时没有“周期”可丢，缓冲耗尽就等待归还，FrameID 保持连续。
+class SyntheticSource : public FrameSource
+{
+public:
+	explicit SyntheticSource(const SyntheticConfig &config);
+
+	std::string Name() const override;
+	void Start() override;
+	void Stop() override;
+	GrabStatus Grab(uint64_t timeoutMs, Frame &frame, std::string &message) override;
+	void Release(const Spinnaker::ImagePtr &image) override;
+
+	Spinnaker::PixelFormatEnums PixelFormat() const { return m_pixelFormat; }
+	uint64_t Underruns() const { return m_underruns; }
+
+private:
+	bool TakeFreeBuffer(size_t &index);
+	void Render(const Spinnaker::ImagePtr &image, uint64_t frameId) const;
+
+	SyntheticConfig m_config;
+	Spinnaker::PixelFormatEnums m_pixelFormat;
+	std::vector<Spinnaker::ImagePtr> m_buffers;
+	std::vector<size_t> m_freeBuffers;
+	std::mutex m_freeMutex;
+	std::condition_variable m_freeChanged; // Release() 归还缓冲时通知（不限速时 Grab() 在此等待）
+	std::vector<int16_t> m_noise; // 预先生成的噪声表，渲染时按随机偏移取用
+	std::chrono::steady_clock::duration m_period;
+	std::chrono::steady_clock::time_point m_startTime;
+	std::chrono::steady_clock::time_point m_nextFrameTime;
+	uint64_t m_frameId = 0;
+	uint64_t m_underruns = 0;
+};
+
+// 回放：把文件夹中的图片按文件名顺序读入内存，再按设定帧率循环输出。
+// .si/.raw 由 Image::Load 读取（保留原始像素格式），其余格式由 OpenCV 读取为 Mono8/Mono16。
+class ReplaySource : public FrameSource
+{
+public:
+	ReplaySource(const std::string &folder, double frameRate, bool loop);
+
+	std::string Name() const override;
+	void Start() override;
+	void Stop() override;
+	GrabStatus Grab(uint64_t timeoutMs, Frame &frame, std::string &message) override;
+	void Release(const Spinnaker::ImagePtr &image) override;
+
+	size_t FrameCount() const { return m_images.size(); }
+	bool Finished() const { return !m_loop && m_next >= m_images.size(); }
+
+private:
+	std::string m_folder;
+	bool m_loop;
+	std::vector<Spinnaker::ImagePtr> m_images; // 只读，可同时被多个帧引用
+	std::chrono::steady_clock::duration m_period;
+	std::chrono::steady_clock::time_point m_startTime;
+	std::chrono::steady_clock::time_point m_nextFrameTime;
+	size_t m_next = 0;
+	uint64_t m_frameId = 0;
+};
+
+struct FaultConfig
+{
+	double incompleteRate = 0.0; // 把取到的帧标记为不完整的概率
+	double timeoutRate = 0.0;	 // 不取帧、直接等满超时的概率
+	uint32_t seed = 1;
+};
+
+// 故障注入：包装任意帧来源，按概率注入不完整帧和超时，便于复现采集异常
+class FaultInjector : public FrameSource
+{
+public:
+	FaultInjector(std::unique_ptr<FrameSource> inner, const FaultConfig &config);
+
+	std::string Name() const override;
+	void Start() override;
+	void Stop() override;
+	GrabStatus Grab(uint64_t timeoutMs, Frame &frame, std::string &message) override;
+	void Release(const Spinnaker::ImagePtr &image) override;
+	bool Restart(const Reconfigure &reconfigure) override;
+
+	FrameSource &Inner() { return *m_inner; }
+
+private:
+	std::unique_ptr<FrameSource> m_inner;
+	FaultConfig m_config;
+	std::mt19937 m_random;
+	std::uniform_real_distribution<double> m_uniform;
+};
+
+struct ReconnectConfig
+{
+	double simulatedUptime = 0.0;	 // 模拟掉线：每次连接保持的秒数，0 为关闭（只响应真实的插拔事件）
+	double simulatedDowntime = 1.0;	 // 模拟掉线后多少秒“重新接入”
+	uint64_t releaseTimeoutMs = 5000; // 掉线后等待显示、存图等消费者归还帧的最长时间
+	uint64_t retryIntervalMs = 1000;  // 重新连接失败后的重试间隔
+};
+
+// 可重连的帧来源：包装可能掉线的来源（相机拔线、断电）。
+// NotifyRemoval() 之后先把已经到达的帧照常交付，再停止内部来源并返回一次 GRAB_DISCONNECTED；
+// 等调用者归还全部帧（或超时）后销毁内部来源、调用 disconnector，然后等待 NotifyArrival()，
+// 由 connector 重新创建内部来源并开始采集。掉线到重连后第一帧的时间记入 RecoveryLatency()。
+// Notify*() 和 Release() 可在任意线程调用，其余接口只在抓图线程中调用。
+class ReconnectingSource : public FrameSource
+{
+public:
+	using Connector = std::function<std::unique_ptr<FrameSource>()>; // 返回空或抛异常表示失败，稍后重试
+	using Disconnector = std::function<void()>;
+
+	ReconnectingSource(std::unique_ptr<FrameSource> initial, Connector connector, Disconnector disconnector,
+					   const ReconnectConfig &config);
+
+	std::string Name() const override;
+	void Start() override;
+	void Stop() override;
+	GrabStatus Grab(uint64_t timeoutMs, Frame &frame, std::string &message) override;
+	void Release(const Spinnaker::ImagePtr &image) override;
+	// 重启内部来源；未连接或已在重启时返回 false。只在检查状态时持锁，重启期间 Release() 和通知不被阻塞，
+	// 内部来源也不会被状态机销毁。停止 / 开始采集失败时按掉线处理，之后的 Grab() 由重连状态机重新初始化相机
+	bool Restart(const Reconfigure &reconfigure) override;
+
+	void NotifyRemoval();
+	void NotifyArrival();
+
+	// 已交付但还没归还的帧数
+	size_t Outstanding() const { return m_outstanding.load(std::memory_order_relaxed); }
+	uint64_t Reconnects() const { return m_reconnects.load(std::memory_order_relaxed); }
+	const LatencyHistogram &RecoveryLatency() const { return m_recoveryLatency; }
+	// 内部来源正常采集中；抓图线程停止后才可在其他线程调用（如暂停抓图做抓拍切换之前）
+	bool IsConnected() const { return m_state == STATE_CONNECTED && !m_removed.load(std::memory_order_relaxed); }
+
+private:
+	enum State
+	{
+		STATE_CONNECTED,
+		STATE_DRAINING,	 // 取完掉线前已到达的帧
+		STATE_RELEASING, // 等待调用者归还帧
+		STATE_WAITING	 // 等待设备重新接入
+	};
+
+	GrabStatus Delivered(GrabStatus status);
+	GrabStatus Reconnect(std::string &message);
+
+	std::string m_name;
+	Connector m_connector;
+	Disconnector m_disconnector;
+	ReconnectConfig m_config;
+	std::unique_ptr<FrameSource> m_inner; // 只在抓图线程中替换，替换时持有 m_mutex
+	State m_state = STATE_CONNECTED;	  // 只在抓图线程中访问
+	bool m_recovering = false;
+	std::chrono::steady_clock::time_point m_connectedAt;
+	std::chrono::steady_clock::time_point m_releaseDeadline;
+	std::chrono::steady_clock::time_point m_retryAt;
+
+	std::mutex m_mutex; // 保护 m_inner 的替换、m_arrived、m_removedAt 和 m_restarting
+	std::condition_variable m_changed;
+	std::atomic<bool> m_removed{false};
+	bool m_arrived = false;
+	bool m_restarting = false; // Restart() 正在使用 m_inner
+	std::chrono::steady_clock::time_point m_removedAt;
+	std::atomic<size_t> m_outstanding{0};
+	std::atomic<uint64_t> m_reconnects{0};
+	LatencyHistogram m_recoveryLatency;
+};
@@ -0,0 +1,81 @@
+﻿#include "HotplugMonitor.h"
+#include <iostream>
+
+using namespace Spinnaker;
+using namespace std;
+
+HotplugMonitor::HotplugMonitor(SystemPtr system) : m_system(system), m_arrivalHandler(*this), m_removalHandler(*this)
+{
+	try
+	{
+		m_system->RegisterEventHandler(m_arrivalHandler);
+		m_system->RegisterEventHandler(m_removalHandler);
+		m_registered = true;
+	}
+	catch (Spinnaker::Exception &e)
+	{
+		cout << "Error: cannot register device arrival / removal events: " << e.what() << endl;
+	}
+}
+
+HotplugMonitor::~HotplugMonitor()
+{
+	// 必须在 ReleaseInstance() 之前注销
+	if (!m_registered)
+	{
+		return;
+	}
+	try
+	{
+		m_system->UnregisterEventHandler(m_arrivalHandler);
+		m_system->UnregisterEventHandler(m_removalHandler);
+	}
+	catch (Spinnaker::Exception &e)
+	{
+		cout << "Error: " << e.what() << endl;
+	}
+}
+
+void HotplugMonitor::Watch(const std::string &deviceId, ArrivalCallback onArrival, RemovalCallback onRemoval)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_callbacks[deviceId] = Callbacks{std::move(onArrival), std::move(onRemoval)};
+}
+
+std::string HotplugMonitor::DeviceId(CameraPtr pCamera)
+{
+	try
+	{
+		return pCamera->GetDeviceID().c_str();
+	}
+	catch (Spinnaker::Exception &)
+	{
+		return "";
+	}
+}
+
+void HotplugMonitor::ArrivalHandler::OnDeviceArrival(CameraPtr pCamera)
+{
+	const std::string deviceId = DeviceId(pCamera);
+	cout << "Device arrived: " << deviceId << endl;
+
+	std::lock_guard<std::mutex> lock(m_owner.m_mutex);
+	const auto found = m_owner.m_callbacks.find(deviceId);
+	if (found != m_owner.m_callbacks.end() && found->second.onArrival)
+	{
+		found->second.onArrival(pCamera);
+	}
+}
+
+void HotplugMonitor::RemovalHandler::OnDeviceRemoval(CameraPtr pCamera)
+{
+	const std::string deviceId = DeviceId(pCamera);
+	cout << "Device removed: " << deviceId << endl;
+
+	std::lock_guard<std::mutex> lock(m_owner.m_mutex);
+	const auto found = m_owner.m_callbacks.find(deviceId);
+	if (found != m_owner.m_callbacks.end() && found->second.onRemoval)
+	{
+		found->second.onRemoval();
+	}
+}
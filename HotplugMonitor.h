@@ -0,0 +1,63 @@
+﻿#pragma once
+
+#include "Spinnaker.h"
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+
+// 相机热插拔监听：向 System 注册设备接入 / 移除事件，按 DeviceID 转给 Watch() 登记的回调。
+// 回调在 SDK 的事件线程中调用，只应做记录和通知，重连由各自的抓图线程完成
+class HotplugMonitor
+{
+public:
+	using ArrivalCallback = std::function<void(Spinnaker::CameraPtr)>;
+	using RemovalCallback = std::function<void()>;
+
+	explicit HotplugMonitor(Spinnaker::SystemPtr system);
+	~HotplugMonitor();
+
+	HotplugMonitor(const HotplugMonitor &) = delete;
+	HotplugMonitor &operator=(const HotplugMonitor &) = delete;
+
+	bool IsRegistered() const { return m_registered; }
+
+	void Watch(const std::string &deviceId, ArrivalCallback onArrival, RemovalCallback onRemoval);
+
+private:
+	class ArrivalHandler : public Spinnaker::DeviceArrivalEventHandler
+	{
+	public:
+		explicit ArrivalHandler(HotplugMonitor &owner) : m_owner(owner) {}
+		void OnDeviceArrival(Spinnaker::CameraPtr pCamera) override;
+
+	private:
+		HotplugMonitor &m_owner;
+	};
+
+	class RemovalHandler : public Spinnaker::DeviceRemovalEventHandler
+	{
+	public:
+		explicit RemovalHandler(HotplugMonitor &owner) : m_owner(owner) {}
+		void OnDeviceRemoval(Spinnaker::CameraPtr pCamera) override;
+
+	private:
+		HotplugMonitor &m_owner;
+	};
+
+	struct Callbacks
+	{
+		ArrivalCallback onArrival;
+		RemovalCallback onRemoval;
+	};
+
+	// 取 DeviceID 失败时为空
+	static std::string DeviceId(Spinnaker::CameraPtr pCamera);
+
+	Spinnaker::SystemPtr m_system;
+	ArrivalHandler m_arrivalHandler;
+	RemovalHandler m_removalHandler;
+	bool m_registered = false;
+	std::mutex m_mutex;
+	std::map<std::string, Callbacks> m_callbacks;
+};
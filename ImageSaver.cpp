@@ -0,0 +1,327 @@
+﻿#include "ImageSaver.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+using namespace std;
+
+namespace fs = std::filesystem;
+
+const char *SaveFormat::Extension() const
+{
+	switch (kind)
+	{
+	case SAVE_TIFF:
+		return ".tiff";
+	case SAVE_PGM:
+		return ".pgm";
+	case SAVE_RAW:
+		return ".gray";
+	case SAVE_JPEG:
+		return ".jpg";
+	default:
+		return ".png";
+	}
+}
+
+std::string SaveFormat::Describe() const
+{
+	std::ostringstream text;
+	switch (kind)
+	{
+	case SAVE_TIFF:
+		text << "tiff/" << tiffCompression;
+		break;
+	case SAVE_PGM:
+		text << "pgm";
+		break;
+	case SAVE_RAW:
+		text << "raw";
+		break;
+	case SAVE_JPEG:
+		text << "jpg/" << jpegQuality;
+		break;
+	default:
+		text << "png/" << pngCompression;
+		if (pngStrategy != cv::IMWRITE_PNG_STRATEGY_DEFAULT)
+		{
+			text << "/s" << pngStrategy;
+		}
+		if (pngThreads != 1)
+		{
+			text << "/mt";
+		}
+		break;
+	}
+	return text.str();
+}
+
+bool EncodeImage(const SaveFormat &format, const cv::Mat &image, std::vector<uchar> &encoded,
+				 ParallelPngEncoder *parallelPng)
+{
+	std::vector<int> params;
+	switch (format.kind)
+	{
+	case SAVE_RAW:
+	{
+		// 逐行复制，去掉行跨度中的填充
+		const size_t rowBytes = static_cast<size_t>(image.cols) * image.elemSize();
+		encoded.resize(rowBytes * static_cast<size_t>(image.rows));
+		for (int y = 0; y < image.rows; y++)
+		{
+			std::copy_n(image.ptr<uchar>(y), rowBytes, encoded.data() + rowBytes * static_cast<size_t>(y));
+		}
+		return true;
+	}
+	case SAVE_TIFF:
+		params = {cv::IMWRITE_TIFF_COMPRESSION, format.tiffCompression};
+		break;
+	case SAVE_PGM:
+		params = {cv::IMWRITE_PXM_BINARY, 1};
+		break;
+	case SAVE_JPEG:
+		params = {cv::IMWRITE_JPEG_QUALITY, format.jpegQuality};
+		break;
+	default:
+		if (parallelPng != nullptr)
+		{
+			return parallelPng->Encode(image, encoded, format.pngCompression, format.pngStrategy);
+		}
+		params = {cv::IMWRITE_PNG_COMPRESSION, format.pngCompression, cv::IMWRITE_PNG_STRATEGY, format.pngStrategy};
+		break;
+	}
+	return cv::imencode(format.Extension(), image, encoded, params);
+}
+
+ImageSaver::ImageSaver(size_t numWriters, size_t queueCapacity, const SaveFormat &format)
+	: m_format(format), m_queueCapacity(queueCapacity > 0 ? queueCapacity : 1)
+{
+	if (m_format.kind == SAVE_PNG && m_format.pngThreads != 1)
+	{
+		// 调用编码的写盘线程自己也参与压缩，线程池少开一个
+		const size_t poolThreads = m_format.pngThreads > 1 ? static_cast<size_t>(m_format.pngThreads - 1) : 0;
+		m_parallelPng.reset(new ParallelPngEncoder(poolThreads));
+		if (!ParallelPngEncoder::Available())
+		{
+			cout << "Parallel PNG encoder built without zlib, using OpenCV encoder" << endl;
+		}
+	}
+	if (numWriters == 0)
+	{
+		numWriters = 1;
+	}
+	for (size_t i = 0; i < numWriters; i++)
+	{
+		m_writers.emplace_back(&ImageSaver::WriterLoop, this);
+	}
+}
+
+ImageSaver::~ImageSaver()
+{
+	Stop();
+}
+
+void ImageSaver::Submit(int id, const std::string &filename, const cv::Mat &image, std::shared_ptr<const void> keepAlive,
+						const std::string &sidecar)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	if (m_queue.size() >= m_queueCapacity)
+	{
+		cout << "Save queue full (" << m_queue.size() << "), waiting..." << endl;
+		m_notFull.wait(lock, [this] { return m_queue.size() < m_queueCapacity || m_stopping; });
+	}
+	if (m_stopping)
+	{
+		return;
+	}
+
+	m_queue.push_back(Job{id, filename, image, std::move(keepAlive), sidecar, std::chrono::steady_clock::now()});
+	m_maxDepth = std::max(m_maxDepth, m_queue.size());
+	m_notEmpty.notify_one();
+}
+
+ImageSaver::DeleteResult ImageSaver::Delete(const std::string &filename)
+{
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+
+		// 还在排队：直接取消，不会再写到磁盘
+		for (auto it = m_queue.begin(); it != m_queue.end(); ++it)
+		{
+			if (it->filename == filename)
+			{
+				m_queue.erase(it);
+				m_notFull.notify_one();
+				return DELETE_CANCELLED;
+			}
+		}
+
+		// 正在写：等写完再删，避免删掉后又被写出来
+		m_jobDone.wait(lock, [&] { return m_inFlight.count(filename) == 0; });
+	}
+
+	std::error_code ec;
+	fs::remove(filename + ".json", ec);
+	if (fs::exists(filename))
+	{
+		fs::remove(filename);
+		return DELETE_REMOVED;
+	}
+	return DELETE_NOT_FOUND;
+}
+
+void ImageSaver::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (m_stopping)
+		{
+			return;
+		}
+		m_stopping = true;
+	}
+	m_notEmpty.notify_all();
+	m_notFull.notify_all();
+
+	for (auto &writer : m_writers)
+	{
+		writer.join();
+	}
+	m_writers.clear();
+}
+
+size_t ImageSaver::QueueDepth() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_queue.size();
+}
+
+uint64_t ImageSaver::SavedCount() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_saved;
+}
+
+uint64_t ImageSaver::FailedCount() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_failed;
+}
+
+void ImageSaver::PrintStats() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	cout << "Saver (" << m_format.Describe() << "): " << m_saved << " saved, " << m_failed << " failed, max queue depth "
+		 << m_maxDepth;
+	if (m_saved > 0)
+	{
+		cout << ", avg size " << m_totalBytes / m_saved / 1024 << " KB";
+		cout << ", encode avg/max " << m_totalEncodeUs / static_cast<int64_t>(m_saved) / 1000.0 << "/"
+			 << m_maxEncodeUs / 1000.0 << " ms, write avg/max " << m_totalWriteUs / static_cast<int64_t>(m_saved) / 1000.0
+			 << "/" << m_maxWriteUs / 1000.0 << " ms";
+	}
+	cout << endl;
+}
+
+void ImageSaver::WriterLoop()
+{
+	while (true)
+	{
+		Job job;
+		size_t depth;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_notEmpty.wait(lock, [this] { return !m_queue.empty() || m_stopping; });
+
+			// 停止时也要先把队列写完
+			if (m_queue.empty())
+			{
+				return;
+			}
+			job = std::move(m_queue.front());
+			m_queue.pop_front();
+			depth = m_queue.size();
+			m_inFlight.insert(job.filename);
+		}
+		m_notFull.notify_one();
+
+		bool ok = false;
+		int64_t encodeUs = 0;
+		int64_t writeUs = 0;
+		size_t bytes = 0;
+		try
+		{
+			// 编码与写文件分开计时
+			const auto t0 = std::chrono::steady_clock::now();
+			std::vector<uchar> encoded;
+			ok = EncodeImage(m_format, job.image, encoded, m_parallelPng.get());
+			bytes = encoded.size();
+			const auto t1 = std::chrono::steady_clock::now();
+
+			if (ok)
+			{
+				std::ofstream file(job.filename, std::ios::binary | std::ios::trunc);
+				file.write(reinterpret_cast<const char *>(encoded.data()), static_cast<std::streamsize>(encoded.size()));
+				ok = file.good();
+			}
+			if (ok && !job.sidecar.empty())
+			{
+				std::ofstream sidecar(job.filename + ".json", std::ios::trunc);
+				sidecar << job.sidecar;
+				ok = sidecar.good();
+			}
+			const auto t2 = std::chrono::steady_clock::now();
+
+			encodeUs = std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count();
+			writeUs = std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1).count();
+
+			using std::chrono::nanoseconds;
+			m_queueLatency.Record(static_cast<uint64_t>(std::chrono::duration_cast<nanoseconds>(t0 - job.queuedTime).count()));
+			m_encodeLatency.Record(static_cast<uint64_t>(std::chrono::duration_cast<nanoseconds>(t1 - t0).count()));
+			if (ok)
+			{
+				m_writeLatency.Record(static_cast<uint64_t>(std::chrono::duration_cast<nanoseconds>(t2 - t1).count()));
+			}
+		}
+		catch (cv::Exception &e)
+		{
+			std::cerr << "OpenCV error: " << e.what() << std::endl;
+			ok = false;
+		}
+
+		// 写完后尽早释放图像缓冲
+		job.image = cv::Mat();
+		job.keepAlive.reset();
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_inFlight.erase(job.filename);
+			if (ok)
+			{
+				m_saved++;
+				m_totalBytes += bytes;
+				m_totalEncodeUs += encodeUs;
+				m_maxEncodeUs = std::max(m_maxEncodeUs, encodeUs);
+				m_totalWriteUs += writeUs;
+				m_maxWriteUs = std::max(m_maxWriteUs, writeUs);
+			}
+			else
+			{
+				m_failed++;
+			}
+		}
+		m_jobDone.notify_all();
+
+		if (ok)
+		{
+			cout << "Saved: " << job.filename << " (queue " << depth << ", " << bytes / 1024 << " KB, encode " << encodeUs / 1000.0 << " ms, write "
+				 << writeUs / 1000.0 << " ms)" << endl;
+		}
+		else
+		{
+			cout << "Failed to save: " << job.filename << endl;
+		}
+	}
+}
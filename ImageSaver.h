@@ -0,0 +1,129 @@
+﻿#pragma once
+
+#include "LatencyHistogram.h"
+#include "ParallelPngEncoder.h"
+#include <opencv2/opencv.hpp>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum SaveFormatKind
+{
+	SAVE_PNG,  // 无损，压缩级别越高越慢、文件越小
+	SAVE_TIFF, // 无损，可选压缩方式
+	SAVE_PGM,  // 二进制 PGM：只有几十字节的头，几乎没有编码开销
+	SAVE_RAW,  // 无文件头的紧密像素数据（.gray，宽高需另行记录），编码开销最小
+	SAVE_JPEG  // 有损，文件最小
+};
+
+// 存图格式和编码参数，通过 OpenCV 的 imencode 参数传入编码器
+struct SaveFormat
+{
+	SaveFormatKind kind = SAVE_PNG;
+	int pngCompression = 1;							   // 0-9，0 为不压缩
+	int pngStrategy = cv::IMWRITE_PNG_STRATEGY_DEFAULT; // DEFAULT / FILTERED / HUFFMAN_ONLY / RLE / FIXED
+	int tiffCompression = 1;						   // libtiff 压缩方式：1 无，5 LZW，8 Deflate，32773 PackBits
+	int jpegQuality = 95;							   // 0-100
+	int pngThreads = 1;								   // PNG 编码线程数：1 为 OpenCV 单线程编码，0 为全部核心条带并行
+
+	// 含点的扩展名，如 ".png"
+	const char *Extension() const;
+	// 格式及主要参数，如 "png/1"，用于日志和基准测试
+	std::string Describe() const;
+};
+
+// 按 format 把 image 编码到 encoded（复用其容量），失败返回 false。
+// PNG 且给出 parallelPng 时由它条带并行编码，否则使用 cv::imencode
+bool EncodeImage(const SaveFormat &format, const cv::Mat &image, std::vector<uchar> &encoded,
+				 ParallelPngEncoder *parallelPng = nullptr);
+
+// 异步存图：主线程按键时只负责入队，由后台写盘线程池完成编码和写文件，
+// 预览和采集不再被 PNG 编码卡住。队列有界，满时 Submit() 会等待。
+// 写盘线程按入队顺序取任务，但多个线程并行编码，完成（落盘）的先后不保证与入队顺序一致；
+// 有序的只是按键时分配的组号和文件名。
+class ImageSaver
+{
+public:
+	enum DeleteResult
+	{
+		DELETE_NOT_FOUND, // 队列和磁盘上都没有该文件
+		DELETE_CANCELLED, // 仍在队列中，已取消写入
+		DELETE_REMOVED	  // 已写到磁盘（或刚写完），已删除
+	};
+
+	ImageSaver(size_t numWriters, size_t queueCapacity, const SaveFormat &format = SaveFormat());
+	~ImageSaver();
+
+	ImageSaver(const ImageSaver &) = delete;
+	ImageSaver &operator=(const ImageSaver &) = delete;
+
+	// image 不做深拷贝，keepAlive 负责在写完之前保持其数据有效。
+	// sidecar 非空时在图像写完后另存为 filename + ".json"（帧元数据）
+	void Submit(int id, const std::string &filename, const cv::Mat &image, std::shared_ptr<const void> keepAlive,
+				const std::string &sidecar = std::string());
+
+	// 删除某个文件（及其元数据文件）：若仍在排队则直接取消，若正在写入则等写完后再删除
+	DeleteResult Delete(const std::string &filename);
+
+	// 写完队列中剩余的图像后结束所有写盘线程
+	void Stop();
+
+	// 文件名应使用 Format().Extension() 作为扩展名
+	const SaveFormat &Format() const { return m_format; }
+
+	size_t QueueDepth() const;
+	void PrintStats() const;
+
+	// 供指标导出：入队到开始写、编码、写文件的耗时（写盘线程无锁记录）
+	const LatencyHistogram &QueueLatency() const { return m_queueLatency; }
+	const LatencyHistogram &EncodeLatency() const { return m_encodeLatency; }
+	const LatencyHistogram &WriteLatency() const { return m_writeLatency; }
+	uint64_t SavedCount() const;
+	uint64_t FailedCount() const;
+
+private:
+	struct Job
+	{
+		int id;
+		std::string filename;
+		cv::Mat image;
+		std::shared_ptr<const void> keepAlive;
+		std::string sidecar;
+		std::chrono::steady_clock::time_point queuedTime;
+	};
+
+	void WriterLoop();
+
+	SaveFormat m_format;
+	std::unique_ptr<ParallelPngEncoder> m_parallelPng; // pngThreads != 1 时所有写盘线程共用
+	size_t m_queueCapacity;
+	mutable std::mutex m_mutex;
+	std::condition_variable m_notEmpty;
+	std::condition_variable m_notFull;
+	std::condition_variable m_jobDone;
+	std::deque<Job> m_queue;
+	std::set<std::string> m_inFlight;
+	std::vector<std::thread> m_writers;
+	bool m_stopping = false;
+
+	// 统计（受 m_mutex 保护），单位微秒
+	uint64_t m_saved = 0;
+	uint64_t m_failed = 0;
+	uint64_t m_totalBytes = 0;
+	size_t m_maxDepth = 0;
+	int64_t m_totalEncodeUs = 0;
+	int64_t m_maxEncodeUs = 0;
+	int64_t m_totalWriteUs = 0;
+	int64_t m_maxWriteUs = 0;
+
+	LatencyHistogram m_queueLatency;
+	LatencyHistogram m_encodeLatency;
+	LatencyHistogram m_writeLatency;
+};
@@ -0,0 +1,107 @@
+﻿#include "LatencyHistogram.h"
+
+namespace
+{
+int HighestBit(uint64_t value)
+{
+	int bit = 0;
+	while (value >>= 1)
+	{
+		bit++;
+	}
+	return bit;
+}
+} // namespace
+
+LatencyHistogram::LatencyHistogram()
+{
+	Reset();
+}
+
+void LatencyHistogram::Record(uint64_t nanoseconds)
+{
+	m_buckets[BucketIndex(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+	m_count.fetch_add(1, std::memory_order_relaxed);
+	m_sum.fetch_add(nanoseconds, std::memory_order_relaxed);
+
+	uint64_t current = m_max.load(std::memory_order_relaxed);
+	while (nanoseconds > current && !m_max.compare_exchange_weak(current, nanoseconds, std::memory_order_relaxed))
+	{
+	}
+}
+
+void LatencyHistogram::Reset()
+{
+	for (auto &bucket : m_buckets)
+	{
+		bucket.store(0, std::memory_order_relaxed);
+	}
+	m_count.store(0, std::memory_order_relaxed);
+	m_sum.store(0, std::memory_order_relaxed);
+	m_max.store(0, std::memory_order_relaxed);
+}
+
+double LatencyHistogram::Mean() const
+{
+	const uint64_t count = Count();
+	return count > 0 ? static_cast<double>(Sum()) / static_cast<double>(count) : 0.0;
+}
+
+uint64_t LatencyHistogram::Percentile(double quantile) const
+{
+	const uint64_t count = Count();
+	if (count == 0)
+	{
+		return 0;
+	}
+
+	// 第 rank 个样本所在的桶（rank 从 1 开始）
+	uint64_t rank = static_cast<uint64_t>(quantile * static_cast<double>(count) + 0.5);
+	if (rank < 1)
+	{
+		rank = 1;
+	}
+	if (rank > count)
+	{
+		rank = count;
+	}
+
+	uint64_t seen = 0;
+	for (size_t i = 0; i < static_cast<size_t>(kBucketCount); i++)
+	{
+		seen += m_buckets[i].load(std::memory_order_relaxed);
+		if (seen >= rank)
+		{
+			// 桶上界不超过实际最大值
+			const uint64_t bound = BucketUpperBound(i);
+			const uint64_t max = Max();
+			return bound < max ? bound : max;
+		}
+	}
+	return Max();
+}
+
+size_t LatencyHistogram::BucketIndex(uint64_t value)
+{
+	// 小于 2^kSubBucketBits 的值逐个分桶，之后每个 2 的幂区间分 kSubBuckets 个桶
+	if (value < static_cast<uint64_t>(kSubBuckets))
+	{
+		return static_cast<size_t>(value);
+	}
+	const int bit = HighestBit(value);
+	const int shift = bit - kSubBucketBits;
+	const size_t sub = static_cast<size_t>((value >> shift) & (kSubBuckets - 1));
+	return static_cast<size_t>(shift + 1) * kSubBuckets + sub;
+}
+
+uint64_t LatencyHistogram::BucketUpperBound(size_t index)
+{
+	if (index < static_cast<size_t>(kSubBuckets))
+	{
+		return index;
+	}
+	const int shift = static_cast<int>(index / kSubBuckets) - 1;
+	const uint64_t sub = index % kSubBuckets;
+	const uint64_t lower = (static_cast<uint64_t>(kSubBuckets) + sub) << shift;
+	return lower + ((uint64_t(1) << shift) - 1);
+}
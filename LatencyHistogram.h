@@ -0,0 +1,40 @@
+﻿#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// 对数分桶的延迟直方图（单位 ns）：每个 2 的幂区间再分 16 个子桶，相对误差约 6%。
+// Record() 只做原子加，可在热路径上由多个线程无锁调用。
+class LatencyHistogram
+{
+public:
+	LatencyHistogram();
+
+	LatencyHistogram(const LatencyHistogram &) = delete;
+	LatencyHistogram &operator=(const LatencyHistogram &) = delete;
+
+	void Record(uint64_t nanoseconds);
+	void Reset();
+
+	uint64_t Count() const { return m_count.load(std::memory_order_relaxed); }
+	uint64_t Sum() const { return m_sum.load(std::memory_order_relaxed); }
+	uint64_t Max() const { return m_max.load(std::memory_order_relaxed); }
+	double Mean() const;
+
+	// quantile 取 0~1，例如 0.99；返回所在桶的上界
+	uint64_t Percentile(double quantile) const;
+
+private:
+	static const int kSubBucketBits = 4;
+	static const int kSubBuckets = 1 << kSubBucketBits;
+	static const int kBucketCount = (64 - kSubBucketBits + 1) * kSubBuckets;
+
+	static size_t BucketIndex(uint64_t value);
+	static uint64_t BucketUpperBound(size_t index);
+
+	std::atomic<uint64_t> m_buckets[kBucketCount];
+	std::atomic<uint64_t> m_count{0};
+	std::atomic<uint64_t> m_sum{0};
+	std::atomic<uint64_t> m_max{0};
+};
@@ -0,0 +1,252 @@
+﻿#include "Metrics.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+// JSON 字符串和 Prometheus 标签值共用的转义
+std::string Escape(const std::string &text)
+{
+	std::string result;
+	for (char c : text)
+	{
+		if (c == '"' || c == '\\')
+		{
+			result.push_back('\\');
+		}
+		result.push_back(c);
+	}
+	return result;
+}
+
+double Milliseconds(uint64_t nanoseconds)
+{
+	return static_cast<double>(nanoseconds) / 1e6;
+}
+
+double Seconds(uint64_t nanoseconds)
+{
+	return static_cast<double>(nanoseconds) / 1e9;
+}
+
+const double kQuantiles[] = {0.5, 0.99, 0.999};
+} // namespace
+
+MetricsRegistry::MetricsRegistry()
+	: m_startTime(std::chrono::steady_clock::now())
+{
+}
+
+void MetricsRegistry::AddHistogram(const std::string &name, const std::string &source, const LatencyHistogram &histogram)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_histograms.push_back(HistogramEntry{name, source, &histogram});
+}
+
+void MetricsRegistry::AddCounter(const std::string &name, const std::string &source, const std::atomic<uint64_t> &counter)
+{
+	const std::atomic<uint64_t> *pCounter = &counter;
+	AddCounter(name, source, [pCounter] { return static_cast<double>(pCounter->load(std::memory_order_relaxed)); });
+}
+
+void MetricsRegistry::AddCounter(const std::string &name, const std::string &source, ValueReader reader)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_values.push_back(ValueEntry{name, source, true, std::move(reader)});
+}
+
+void MetricsRegistry::AddGauge(const std::string &name, const std::string &source, ValueReader reader)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_values.push_back(ValueEntry{name, source, false, std::move(reader)});
+}
+
+void MetricsRegistry::PrintSummary(std::ostream &out) const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	// 按来源首次出现的顺序，每个来源一行
+	std::vector<std::string> sources;
+	auto note_source = [&](const std::string &source)
+	{
+		if (std::find(sources.begin(), sources.end(), source) == sources.end())
+		{
+			sources.push_back(source);
+		}
+	};
+	for (const auto &entry : m_histograms)
+	{
+		note_source(entry.source);
+	}
+	for (const auto &entry : m_values)
+	{
+		note_source(entry.source);
+	}
+
+	for (const std::string &source : sources)
+	{
+		std::ostringstream line;
+		line << std::fixed << std::setprecision(2);
+		for (const auto &entry : m_histograms)
+		{
+			if (entry.source == source && entry.histogram->Count() > 0)
+			{
+				line << " " << entry.name << " " << Milliseconds(entry.histogram->Percentile(0.5)) << "/"
+					 << Milliseconds(entry.histogram->Percentile(0.99)) << "ms";
+			}
+		}
+		for (const auto &entry : m_values)
+		{
+			if (entry.source != source || !entry.counter)
+			{
+				continue;
+			}
+			const double value = entry.reader();
+			if (value > 0.0)
+			{
+				line << " " << entry.name << "=" << static_cast<uint64_t>(value);
+			}
+		}
+
+		// 还没有任何数据的来源不打印
+		if (!line.str().empty())
+		{
+			out << "[metrics" << (source.empty() ? "" : " " + source) << "]" << line.str() << std::endl;
+		}
+	}
+}
+
+bool MetricsRegistry::Export(const std::string &path, MetricsFormat format) const
+{
+	const std::string temporary = path + ".tmp";
+	{
+		std::ofstream file(temporary, std::ios::trunc);
+		if (!file)
+		{
+			return false;
+		}
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (format == METRICS_PROMETHEUS)
+		{
+			WritePrometheus(file);
+		}
+		else
+		{
+			WriteJson(file);
+		}
+		if (!file.good())
+		{
+			return false;
+		}
+	}
+
+	std::error_code ec;
+	fs::rename(temporary, path, ec);
+	return !ec;
+}
+
+void MetricsRegistry::WriteJson(std::ostream &out) const
+{
+	const double uptime = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_startTime).count();
+	const auto now = std::chrono::duration_cast<std::chrono::milliseconds>(
+		std::chrono::system_clock::now().time_since_epoch());
+
+	out << std::fixed << std::setprecision(4);
+	out << "{\n  \"timestamp_ms\": " << now.count() << ",\n  \"uptime_seconds\": " << uptime
+		<< ",\n  \"histograms\": [\n";
+	for (size_t i = 0; i < m_histograms.size(); i++)
+	{
+		const HistogramEntry &entry = m_histograms[i];
+		const LatencyHistogram &histogram = *entry.histogram;
+		out << "    {\"name\": \"" << Escape(entry.name) << "\", \"source\": \"" << Escape(entry.source)
+			<< "\", \"count\": " << histogram.Count() << ", \"mean_ms\": " << histogram.Mean() / 1e6
+			<< ", \"p50_ms\": " << Milliseconds(histogram.Percentile(0.5))
+			<< ", \"p99_ms\": " << Milliseconds(histogram.Percentile(0.99))
+			<< ", \"p999_ms\": " << Milliseconds(histogram.Percentile(0.999))
+			<< ", \"max_ms\": " << Milliseconds(histogram.Max()) << "}" << (i + 1 < m_histograms.size() ? "," : "")
+			<< "\n";
+	}
+	out << "  ],\n  \"values\": [\n";
+
+	bool first = true;
+	for (const auto &entry : m_values)
+	{
+		const double value = entry.reader();
+		if (value < 0.0)
+		{
+			continue;
+		}
+		out << (first ? "" : ",\n") << "    {\"name\": \"" << Escape(entry.name) << "\", \"source\": \""
+			<< Escape(entry.source) << "\", \"type\": \"" << (entry.counter ? "counter" : "gauge")
+			<< "\", \"value\": " << value << "}";
+		first = false;
+	}
+	out << (first ? "" : "\n") << "  ]\n}\n";
+}
+
+void MetricsRegistry::WritePrometheus(std::ostream &out) const
+{
+	// 同名指标的各来源写在同一个 TYPE 声明下
+	std::vector<std::string> names;
+	std::map<std::string, std::vector<const HistogramEntry *>> histograms;
+	for (const auto &entry : m_histograms)
+	{
+		auto &list = histograms[entry.name];
+		if (list.empty())
+		{
+			names.push_back(entry.name);
+		}
+		list.push_back(&entry);
+	}
+
+	out << std::setprecision(9);
+	for (const std::string &name : names)
+	{
+		const std::string metric = "acquisition_" + name + "_seconds";
+		out << "# TYPE " << metric << " summary\n";
+		for (const HistogramEntry *entry : histograms[name])
+		{
+			const std::string label = "source=\"" + Escape(entry->source) + "\"";
+			for (double quantile : kQuantiles)
+			{
+				out << metric << "{" << label << ",quantile=\"" << quantile << "\"} "
+					<< Seconds(entry->histogram->Percentile(quantile)) << "\n";
+			}
+			out << metric << "_sum{" << label << "} " << Seconds(entry->histogram->Sum()) << "\n";
+			out << metric << "_count{" << label << "} " << entry->histogram->Count() << "\n";
+		}
+	}
+
+	names.clear();
+	std::map<std::string, std::vector<const ValueEntry *>> values;
+	for (const auto &entry : m_values)
+	{
+		auto &list = values[entry.name];
+		if (list.empty())
+		{
+			names.push_back(entry.name);
+		}
+		list.push_back(&entry);
+	}
+	for (const std::string &name : names)
+	{
+		const bool counter = values[name].front()->counter;
+		const std::string metric = "acquisition_" + name + (counter ? "_total" : "");
+		out << "# TYPE " << metric << (counter ? " counter\n" : " gauge\n");
+		for (const ValueEntry *entry : values[name])
+		{
+			const double value = entry->reader();
+			if (value >= 0.0)
+			{
+				out << metric << "{source=\"" << Escape(entry->source) << "\"} " << value << "\n";
+			}
+		}
+	}
+}
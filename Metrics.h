@@ -0,0 +1,68 @@
+﻿#pragma once
+
+#include "LatencyHistogram.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <ostream>
+#include <string>
+
+enum MetricsFormat
+{
+	METRICS_JSON,		// 单个 JSON 对象
+	METRICS_PROMETHEUS	// Prometheus 文本格式，可交给 node_exporter 的 textfile 收集器
+};
+
+// 指标汇总：各组件自己持有直方图和原子计数器并在热路径上无锁更新，
+// 启动时把它们按名称和来源登记到这里，导出时只读取，不影响热路径。
+// 登记在开始采集之前完成；被登记的对象必须比注册表活得更久。
+class MetricsRegistry
+{
+public:
+	// 导出时调用，返回负数表示当前不可用（该项跳过）
+	typedef std::function<double()> ValueReader;
+
+	MetricsRegistry();
+
+	MetricsRegistry(const MetricsRegistry &) = delete;
+	MetricsRegistry &operator=(const MetricsRegistry &) = delete;
+
+	// name 使用小写加下划线，如 "grab_wait"；source 为相机 DeviceID 或帧来源名称
+	void AddHistogram(const std::string &name, const std::string &source, const LatencyHistogram &histogram);
+	void AddCounter(const std::string &name, const std::string &source, const std::atomic<uint64_t> &counter);
+	void AddCounter(const std::string &name, const std::string &source, ValueReader reader);
+	void AddGauge(const std::string &name, const std::string &source, ValueReader reader);
+
+	// 每个来源一行：各阶段 p50/p99（ms）和非零计数
+	void PrintSummary(std::ostream &out) const;
+
+	// 先写临时文件再改名，读取方不会看到写了一半的文件
+	bool Export(const std::string &path, MetricsFormat format) const;
+
+private:
+	struct HistogramEntry
+	{
+		std::string name;
+		std::string source;
+		const LatencyHistogram *histogram;
+	};
+
+	struct ValueEntry
+	{
+		std::string name;
+		std::string source;
+		bool counter; // false 为 gauge
+		ValueReader reader;
+	};
+
+	void WriteJson(std::ostream &out) const;
+	void WritePrometheus(std::ostream &out) const;
+
+	mutable std::mutex m_mutex; // 只保护登记和导出，热路径不经过这里
+	std::deque<HistogramEntry> m_histograms;
+	std::deque<ValueEntry> m_values;
+	std::chrono::steady_clock::time_point m_startTime;
+};
@@ -0,0 +1,109 @@
+﻿#include "Mono8Converter.h"
+
+using namespace Spinnaker;
+
+Mono8Converter::Mono8Converter(ColorProcessingAlgorithm algorithm)
+{
+	m_processor.SetColorProcessing(algorithm);
+}
+
+Mono8Frame Mono8Converter::Convert(const FrameRef &frame)
+{
+	const ImagePtr &image = frame->image;
+	if (image->GetPixelFormat() != PixelFormat_Mono8)
+	{
+		return Convert(image);
+	}
+
+	// 原生 Mono8：直接包装 SDK 缓冲，帧句柄随 keepAlive 一起保留
+	Mono8Frame result;
+	result.mat = Wrap(image);
+	result.keepAlive = std::make_shared<FrameRef>(frame);
+	result.zeroCopy = true;
+	m_zeroCopyCount++;
+	return result;
+}
+
+Mono8Frame Mono8Converter::Convert(const ImagePtr &image)
+{
+	const size_t width = image->GetWidth();
+	const size_t height = image->GetHeight();
+
+	// 上一个目标仍被别处（如写盘队列）引用，或尺寸变化时才重新分配
+	if (m_dest == nullptr || m_dest.use_count() > 1 || (*m_dest)->GetWidth() != width ||
+		(*m_dest)->GetHeight() != height)
+	{
+		m_dest = std::make_shared<ImagePtr>(Image::Create());
+		(*m_dest)->ResetImage(width, height, 0, 0, PixelFormat_Mono8);
+	}
+
+	m_processor.Convert(image, *m_dest, PixelFormat_Mono8);
+	m_convertedCount++;
+
+	Mono8Frame result;
+	result.mat = Wrap(*m_dest);
+	result.keepAlive = m_dest;
+	result.zeroCopy = false;
+	return result;
+}
+
+Mono8Frame Mono8Converter::Convert(const ImagePtr &image, std::shared_ptr<const void> owner)
+{
+	if (image->GetPixelFormat() != PixelFormat_Mono8)
+	{
+		return Convert(image);
+	}
+
+	Mono8Frame result;
+	result.mat = Wrap(image);
+	result.keepAlive = std::move(owner);
+	result.zeroCopy = true;
+	m_zeroCopyCount++;
+	return result;
+}
+
+Mono8Frame Mono8Converter::Detach(const Mono8Frame &frame, size_t maxPinned)
+{
+	if (!frame.zeroCopy)
+	{
+		return frame;
+	}
+
+	Mono8Frame result;
+	if (m_pinned->load() >= maxPinned)
+	{
+		auto copy = std::make_shared<cv::Mat>(frame.mat.clone());
+		result.mat = *copy;
+		result.keepAlive = std::move(copy);
+		return result;
+	}
+
+	// 包一层计数：原 keepAlive 随外层一起释放时在途数减一
+	m_pinned->fetch_add(1);
+	result.mat = frame.mat;
+	result.keepAlive = std::shared_ptr<const void>(
+		frame.keepAlive.get(), [keepAlive = frame.keepAlive, pinned = m_pinned](const void *) mutable
+		{
+			keepAlive.reset();
+			pinned->fetch_sub(1);
+		});
+	result.zeroCopy = true;
+	return result;
+}
+
+cv::Mat Mono8Converter::Wrap(const ImagePtr &image)
+{
+	// 行跨度包含 X 方向填充，不能简单按宽度计算
+	size_t stride = image->GetStride();
+	if (stride == 0)
+	{
+		stride = image->GetWidth() + image->GetXPadding();
+	}
+
+	return cv::Mat(
+		static_cast<int>(image->GetHeight()), // 将 size_t 转为 int，确保不会丢失数据
+		static_cast<int>(image->GetWidth()),
+		CV_8UC1,
+		image->GetData(),
+		stride);
+}
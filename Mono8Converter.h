@@ -0,0 +1,51 @@
+﻿#pragma once
+
+#include "Spinnaker.h"
+#include "FrameRing.h"
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+// 供 OpenCV 使用的 8 位灰度视图。mat 本身不拥有数据，keepAlive 释放前 mat 一直有效。
+struct Mono8Frame
+{
+	cv::Mat mat;
+	std::shared_ptr<const void> keepAlive; // 帧句柄（零拷贝）或转换结果
+	bool zeroCopy = false;
+};
+
+// 把相机帧变成 Mono8：
+// 相机原生输出 Mono8 时直接包装 SDK 缓冲（零拷贝，缓冲随帧句柄释放才 Release()）；
+// 否则才调用 ImageProcessor::Convert，结果写入可复用的目标图像，避免每帧重新分配。
+class Mono8Converter
+{
+public:
+	explicit Mono8Converter(Spinnaker::ColorProcessingAlgorithm algorithm);
+
+	Mono8Frame Convert(const FrameRef &frame);
+
+	// 不经过帧环的图像（例如离线读取的文件），总是按需转换
+	Mono8Frame Convert(const Spinnaker::ImagePtr &image);
+
+	// 由调用者管理生命周期的图像（例如预触发历史中的帧）：Mono8 时直接包装，owner 作为 keepAlive
+	Mono8Frame Convert(const Spinnaker::ImagePtr &image, std::shared_ptr<const void> owner);
+
+	// 交给写盘线程等长时间持有的消费者：零拷贝帧会一直占着帧环的持有名额，
+	// 已有 maxPinned 个零拷贝帧在途时复制一份（结果自带数据），否则照常零拷贝并计数到 keepAlive 释放
+	Mono8Frame Detach(const Mono8Frame &frame, size_t maxPinned);
+
+	Spinnaker::ImageProcessor &Processor() { return m_processor; }
+	size_t Pinned() const { return m_pinned->load(std::memory_order_relaxed); }
+	uint64_t ZeroCopyCount() const { return m_zeroCopyCount; }
+	uint64_t ConvertedCount() const { return m_convertedCount; }
+
+private:
+	static cv::Mat Wrap(const Spinnaker::ImagePtr &image);
+
+	Spinnaker::ImageProcessor m_processor;
+	std::shared_ptr<Spinnaker::ImagePtr> m_dest; // 可复用的转换目标
+	std::shared_ptr<std::atomic<size_t>> m_pinned = std::make_shared<std::atomic<size_t>>(0); // keepAlive 可能比本对象活得久
+	uint64_t m_zeroCopyCount = 0;
+	uint64_t m_convertedCount = 0;
+};
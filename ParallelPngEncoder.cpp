@@ -0,0 +1,329 @@
+﻿#include "ParallelPngEncoder.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+namespace
+{
+const size_t kWindowBytes = 32768; // deflate 窗口，也是条带预设字典的长度
+const size_t kMinStripeBytes = 256 * 1024; // 条带太小时 sync flush 和字典设置的开销占比变大
+
+#ifdef HAVE_ZLIB
+void PutBigEndian32(std::vector<uchar> &out, uint32_t value)
+{
+	out.push_back(static_cast<uchar>(value >> 24));
+	out.push_back(static_cast<uchar>(value >> 16));
+	out.push_back(static_cast<uchar>(value >> 8));
+	out.push_back(static_cast<uchar>(value));
+}
+
+void PutChunk(std::vector<uchar> &out, const char *type, const uchar *data, size_t length)
+{
+	PutBigEndian32(out, static_cast<uint32_t>(length));
+	const size_t start = out.size();
+	out.insert(out.end(), type, type + 4);
+	out.insert(out.end(), data, data + length);
+	PutBigEndian32(out, static_cast<uint32_t>(crc32(0, out.data() + start, static_cast<uInt>(length + 4))));
+}
+#endif
+} // namespace
+
+struct ParallelPngEncoder::Job
+{
+	const cv::Mat *image;
+	int level;
+	int strategy;
+	size_t rowBytes;	 // 每行像素字节数（不含滤波类型字节）
+	size_t stripeRows;
+	size_t stripeCount;
+
+	struct Stripe
+	{
+		std::vector<uchar> deflated;
+		uint32_t adler = 0;		 // 本条带滤波后数据的 adler32
+		uint32_t crc = 0;		 // deflated 的 crc32
+		size_t filteredBytes = 0;
+		bool ok = false;
+	};
+	std::vector<Stripe> stripes;
+
+	std::atomic<size_t> next{0};
+	std::mutex doneMutex;
+	std::condition_variable doneChanged;
+	size_t done = 0;
+};
+
+ParallelPngEncoder::ParallelPngEncoder(size_t threads)
+{
+	if (threads == 0)
+	{
+		threads = std::max(1u, std::thread::hardware_concurrency()) - 1;
+	}
+	for (size_t i = 0; i < threads; i++)
+	{
+		m_workers.emplace_back(&ParallelPngEncoder::WorkerLoop, this);
+	}
+}
+
+ParallelPngEncoder::~ParallelPngEncoder()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stopping = true;
+	}
+	m_jobReady.notify_all();
+	for (auto &worker : m_workers)
+	{
+		worker.join();
+	}
+}
+
+bool ParallelPngEncoder::Available()
+{
+#ifdef HAVE_ZLIB
+	return true;
+#else
+	return false;
+#endif
+}
+
+void ParallelPngEncoder::WorkerLoop()
+{
+	while (true)
+	{
+		std::shared_ptr<Job> job;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_jobReady.wait(lock, [this] { return !m_jobs.empty() || m_stopping; });
+			if (m_jobs.empty())
+			{
+				return;
+			}
+			job = m_jobs.front();
+		}
+		RunJob(job);
+	}
+}
+
+void ParallelPngEncoder::RunJob(const std::shared_ptr<Job> &job)
+{
+	size_t index;
+	while ((index = job->next.fetch_add(1)) < job->stripeCount)
+	{
+		CompressStripe(*job, index);
+		std::lock_guard<std::mutex> lock(job->doneMutex);
+		if (++job->done == job->stripeCount)
+		{
+			job->doneChanged.notify_all();
+		}
+	}
+
+	// 条带已分完，从队列中移除，其他线程不再取到它
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto it = std::find(m_jobs.begin(), m_jobs.end(), job);
+	if (it != m_jobs.end())
+	{
+		m_jobs.erase(it);
+	}
+}
+
+void ParallelPngEncoder::CompressStripe(Job &job, size_t index)
+{
+#ifdef HAVE_ZLIB
+	const cv::Mat &image = *job.image;
+	const size_t rows = static_cast<size_t>(image.rows);
+	const size_t first = index * job.stripeRows;
+	const size_t last = std::min(rows, first + job.stripeRows);
+	const size_t lineBytes = job.rowBytes + 1;
+	const size_t channels = static_cast<size_t>(image.channels());
+	const bool sixteenBit = image.depth() == CV_16U;
+
+	// 前一条带末尾的若干行也一起滤波，作为本条带的预设字典
+	const size_t dictRows = first == 0 ? 0 : std::min(first, (kWindowBytes + lineBytes - 1) / lineBytes);
+	std::vector<uchar> filtered((dictRows + last - first) * lineBytes);
+	std::vector<uchar> line(job.rowBytes);
+	std::vector<uchar> previous(job.rowBytes, 0);
+
+	// 每行先转成 PNG 的像素排列（RGB、16 位大端），再用 Up 滤波（与上一行逐字节相减）
+	auto png_row = [&](size_t y, std::vector<uchar> &out)
+	{
+		const uchar *src = image.ptr<uchar>(static_cast<int>(y));
+		if (channels == 3)
+		{
+			for (size_t x = 0; x < job.rowBytes; x += 3)
+			{
+				out[x] = src[x + 2];
+				out[x + 1] = src[x + 1];
+				out[x + 2] = src[x];
+			}
+		}
+		else if (sixteenBit)
+		{
+			for (size_t x = 0; x < job.rowBytes; x += 2)
+			{
+				out[x] = src[x + 1];
+				out[x + 1] = src[x];
+			}
+		}
+		else
+		{
+			std::memcpy(out.data(), src, job.rowBytes);
+		}
+	};
+
+	const size_t startRow = first - dictRows;
+	if (startRow > 0)
+	{
+		png_row(startRow - 1, previous);
+	}
+	for (size_t y = startRow; y < last; y++)
+	{
+		png_row(y, line);
+		uchar *dst = filtered.data() + (y - startRow) * lineBytes;
+		dst[0] = 2; // Up
+		for (size_t x = 0; x < job.rowBytes; x++)
+		{
+			dst[x + 1] = static_cast<uchar>(line[x] - previous[x]);
+		}
+		line.swap(previous);
+	}
+
+	Job::Stripe &stripe = job.stripes[index];
+	const uchar *data = filtered.data() + dictRows * lineBytes;
+	const size_t dataBytes = (last - first) * lineBytes;
+	stripe.filteredBytes = dataBytes;
+	stripe.adler = static_cast<uint32_t>(adler32(adler32(0, nullptr, 0), data, static_cast<uInt>(dataBytes)));
+
+	// 原始 deflate（无 zlib 头尾），头和 adler32 由拼接时统一写出
+	z_stream stream;
+	std::memset(&stream, 0, sizeof(stream));
+	if (deflateInit2(&stream, job.level, Z_DEFLATED, -15, 8, job.strategy) != Z_OK)
+	{
+		return;
+	}
+	if (dictRows > 0)
+	{
+		const size_t dictBytes = std::min(kWindowBytes, dictRows * lineBytes);
+		deflateSetDictionary(&stream, data - dictBytes, static_cast<uInt>(dictBytes));
+	}
+
+	const bool final = index + 1 == job.stripeCount;
+	stripe.deflated.resize(deflateBound(&stream, static_cast<uLong>(dataBytes)) + 16);
+	stream.next_in = const_cast<uchar *>(data);
+	stream.avail_in = static_cast<uInt>(dataBytes);
+	stream.next_out = stripe.deflated.data();
+	stream.avail_out = static_cast<uInt>(stripe.deflated.size());
+	const int status = deflate(&stream, final ? Z_FINISH : Z_SYNC_FLUSH);
+	stripe.ok = final ? status == Z_STREAM_END : (status == Z_OK && stream.avail_out > 0);
+	stripe.deflated.resize(stripe.deflated.size() - stream.avail_out);
+	deflateEnd(&stream);
+
+	stripe.crc = static_cast<uint32_t>(crc32(0, stripe.deflated.data(), static_cast<uInt>(stripe.deflated.size())));
+#else
+	(void)job;
+	(void)index;
+#endif
+}
+
+bool ParallelPngEncoder::Encode(const cv::Mat &image, std::vector<uchar> &encoded, int level, int strategy)
+{
+#ifdef HAVE_ZLIB
+	const int type = image.type();
+	const bool supported = (type == CV_8UC1 || type == CV_8UC3 || type == CV_16UC1) && image.rows > 0 && image.cols > 0;
+#else
+	const bool supported = false;
+#endif
+	if (!supported)
+	{
+		m_fallbacks++;
+		return cv::imencode(".png", image, encoded,
+							{cv::IMWRITE_PNG_COMPRESSION, level, cv::IMWRITE_PNG_STRATEGY, strategy});
+	}
+
+#ifdef HAVE_ZLIB
+	auto job = std::make_shared<Job>();
+	job->image = &image;
+	job->level = std::min(std::max(level, 0), 9);
+	job->strategy = strategy;
+	job->rowBytes = static_cast<size_t>(image.cols) * image.elemSize();
+
+	// 条带数取线程数的两倍以平衡负载，但每条不小于 kMinStripeBytes
+	const size_t rows = static_cast<size_t>(image.rows);
+	const size_t minRows = std::max<size_t>(1, kMinStripeBytes / (job->rowBytes + 1));
+	const size_t wanted = std::max<size_t>(1, std::min(Threads() * 2, rows / minRows));
+	job->stripeRows = (rows + wanted - 1) / wanted;
+	job->stripeCount = (rows + job->stripeRows - 1) / job->stripeRows;
+	job->stripes.resize(job->stripeCount);
+
+	if (job->stripeCount > 1 && !m_workers.empty())
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_jobs.push_back(job);
+		}
+		m_jobReady.notify_all();
+	}
+	RunJob(job);
+	{
+		std::unique_lock<std::mutex> lock(job->doneMutex);
+		job->doneChanged.wait(lock, [&] { return job->done == job->stripeCount; });
+	}
+
+	size_t deflatedBytes = 0;
+	for (const auto &stripe : job->stripes)
+	{
+		if (!stripe.ok)
+		{
+			m_fallbacks++;
+			return cv::imencode(".png", image, encoded,
+								{cv::IMWRITE_PNG_COMPRESSION, level, cv::IMWRITE_PNG_STRATEGY, strategy});
+		}
+		deflatedBytes += stripe.deflated.size();
+	}
+
+	encoded.clear();
+	encoded.reserve(deflatedBytes + 128);
+	static const uchar kSignature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+	encoded.insert(encoded.end(), kSignature, kSignature + 8);
+
+	std::vector<uchar> header;
+	PutBigEndian32(header, static_cast<uint32_t>(image.cols));
+	PutBigEndian32(header, static_cast<uint32_t>(image.rows));
+	header.push_back(type == CV_16UC1 ? 16 : 8);  // 位深
+	header.push_back(type == CV_8UC3 ? 2 : 0);	  // 颜色类型：RGB / 灰度
+	header.push_back(0);						  // 压缩方式
+	header.push_back(0);						  // 滤波方式
+	header.push_back(0);						  // 不隔行
+	PutChunk(encoded, "IHDR", header.data(), header.size());
+
+	// IDAT = zlib 头 + 各条带 deflate 数据 + 整体 adler32，CRC 由各段合并
+	const uchar flevel = job->level < 2 ? 0 : (job->level < 6 ? 1 : (job->level == 6 ? 2 : 3));
+	uchar zlibHeader[2] = {0x78, static_cast<uchar>(flevel << 6)};
+	zlibHeader[1] = static_cast<uchar>(zlibHeader[1] + 31 - (0x78 * 256 + zlibHeader[1]) % 31);
+
+	uint32_t adler = static_cast<uint32_t>(adler32(0, nullptr, 0));
+	const size_t idatLength = 2 + deflatedBytes + 4;
+	PutBigEndian32(encoded, static_cast<uint32_t>(idatLength));
+	const size_t idatStart = encoded.size();
+	encoded.insert(encoded.end(), {'I', 'D', 'A', 'T', zlibHeader[0], zlibHeader[1]});
+	uLong crc = crc32(0, encoded.data() + idatStart, 6);
+	for (const auto &stripe : job->stripes)
+	{
+		encoded.insert(encoded.end(), stripe.deflated.begin(), stripe.deflated.end());
+		crc = crc32_combine(crc, stripe.crc, static_cast<z_off_t>(stripe.deflated.size()));
+		adler = static_cast<uint32_t>(adler32_combine(adler, stripe.adler, static_cast<z_off_t>(stripe.filteredBytes)));
+	}
+	const size_t adlerStart = encoded.size();
+	PutBigEndian32(encoded, adler);
+	crc = crc32(crc, encoded.data() + adlerStart, 4);
+	PutBigEndian32(encoded, static_cast<uint32_t>(crc));
+
+	PutChunk(encoded, "IEND", nullptr, 0);
+	return true;
+#else
+	return false;
+#endif
+}
@@ -0,0 +1,51 @@
+﻿#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// 多线程 PNG 编码：把图像按行切成若干条带，各条带独立做行滤波和 deflate（pigz 的做法），
+// 再拼接成一个合法的 zlib 流写入单个 IDAT。每个条带以前一条带末尾的 32 KB 作为预设字典，
+// 压缩率与整幅压缩基本相同；条带之间用 Z_SYNC_FLUSH 字节对齐，最后一条带 Z_FINISH 结束。
+// 支持 CV_8UC1、CV_8UC3（BGR）和 CV_16UC1，其他类型或未编译 zlib（HAVE_ZLIB）时退回 cv::imencode。
+//
+// 多个线程可同时调用 Encode()：各自的条带进入同一个线程池，调用线程自己也参与压缩。
+class ParallelPngEncoder
+{
+public:
+	// threads：线程池大小（不含调用线程），0 为全部核心减一
+	explicit ParallelPngEncoder(size_t threads = 0);
+	~ParallelPngEncoder();
+
+	ParallelPngEncoder(const ParallelPngEncoder &) = delete;
+	ParallelPngEncoder &operator=(const ParallelPngEncoder &) = delete;
+
+	// level 0-9，strategy 与 cv::IMWRITE_PNG_STRATEGY_* 相同（即 zlib 的 Z_DEFAULT_STRATEGY 等）
+	bool Encode(const cv::Mat &image, std::vector<uchar> &encoded, int level, int strategy);
+
+	// 编译时是否带 zlib；为 false 时 Encode() 总是调用 cv::imencode
+	static bool Available();
+
+	size_t Threads() const { return m_workers.size() + 1; }
+	uint64_t FallbackCount() const { return m_fallbacks; }
+
+private:
+	struct Job;
+
+	static void CompressStripe(Job &job, size_t index);
+	void RunJob(const std::shared_ptr<Job> &job);
+	void WorkerLoop();
+
+	std::mutex m_mutex;
+	std::condition_variable m_jobReady;
+	std::deque<std::shared_ptr<Job>> m_jobs;
+	bool m_stopping = false;
+	std::vector<std::thread> m_workers;
+	std::atomic<uint64_t> m_fallbacks{0};
+};
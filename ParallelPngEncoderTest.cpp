@@ -0,0 +1,114 @@
+﻿// ParallelPngEncoder 的往返测试：编码后用 cv::imdecode 解码，逐像素与原图比较。
+// 覆盖单条带、多条带（含最后一条带行数不同）、压缩级别 0 以及 8 位灰度 / BGR / 16 位灰度。
+#include "ParallelPngEncoder.h"
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+struct Case
+{
+	const char *name;
+	int rows;
+	int cols;
+	int type;
+	int level;
+	int strategy;
+};
+
+// 渐变加上每 5 行一行噪声：既有可压缩的内容，也让各种行滤波器都被选到
+cv::Mat MakeImage(int rows, int cols, int type)
+{
+	cv::Mat image(rows, cols, type);
+	const int channels = image.channels();
+	const bool sixteenBit = image.depth() == CV_16U;
+	std::mt19937 random(12345);
+	for (int y = 0; y < rows; y++)
+	{
+		const bool noise = y % 5 == 0;
+		for (int x = 0; x < cols * channels; x++)
+		{
+			const uint32_t value = noise ? static_cast<uint32_t>(random())
+										 : static_cast<uint32_t>(x * 7 + y * 13 + (x * y) % 31) * 97;
+			if (sixteenBit)
+			{
+				image.ptr<uint16_t>(y)[x] = static_cast<uint16_t>(value);
+			}
+			else
+			{
+				image.ptr<uint8_t>(y)[x] = static_cast<uint8_t>(noise ? value : value / 97);
+			}
+		}
+	}
+	return image;
+}
+
+bool RunCase(ParallelPngEncoder &encoder, const Case &test)
+{
+	const cv::Mat image = MakeImage(test.rows, test.cols, test.type);
+	std::vector<uchar> encoded;
+	if (!encoder.Encode(image, encoded, test.level, test.strategy))
+	{
+		cout << "FAIL " << test.name << ": Encode() returned false" << endl;
+		return false;
+	}
+
+	const cv::Mat decoded = cv::imdecode(encoded, cv::IMREAD_UNCHANGED);
+	if (decoded.empty() || decoded.type() != image.type() || decoded.rows != image.rows || decoded.cols != image.cols)
+	{
+		cout << "FAIL " << test.name << ": decoded " << decoded.cols << "x" << decoded.rows << " type " << decoded.type()
+			 << ", expected " << image.cols << "x" << image.rows << " type " << image.type() << endl;
+		return false;
+	}
+	if (cv::norm(decoded, image, cv::NORM_INF) != 0.0)
+	{
+		cout << "FAIL " << test.name << ": pixel data differs after round trip" << endl;
+		return false;
+	}
+
+	cout << "ok   " << test.name << " (" << image.cols << "x" << image.rows << ", " << encoded.size() << " bytes)" << endl;
+	return true;
+}
+} // namespace
+
+int main()
+{
+	// 3 个工作线程 + 调用线程：足够大的图像切成 8 条带
+	ParallelPngEncoder encoder(3);
+	cout << "Parallel PNG encoder: " << encoder.Threads() << " threads"
+		 << (ParallelPngEncoder::Available() ? "" : " (no zlib, OpenCV fallback)") << endl;
+
+	// 每条带至少 256 KB：小图只有一条带；2049 行 / 257 行一条，最后一条带 250 行
+	const Case cases[] = {
+		{"mono8 single stripe", 48, 64, CV_8UC1, 1, cv::IMWRITE_PNG_STRATEGY_DEFAULT},
+		{"mono8 multi stripe", 2049, 1024, CV_8UC1, 1, cv::IMWRITE_PNG_STRATEGY_DEFAULT},
+		{"mono8 multi stripe level 0", 2049, 1024, CV_8UC1, 0, cv::IMWRITE_PNG_STRATEGY_DEFAULT},
+		{"mono8 multi stripe level 9 filtered", 1031, 2048, CV_8UC1, 9, cv::IMWRITE_PNG_STRATEGY_FILTERED},
+		{"bgr8 single stripe", 37, 53, CV_8UC3, 1, cv::IMWRITE_PNG_STRATEGY_DEFAULT},
+		{"bgr8 multi stripe", 1001, 700, CV_8UC3, 1, cv::IMWRITE_PNG_STRATEGY_DEFAULT},
+		{"bgr8 multi stripe level 0", 1001, 700, CV_8UC3, 0, cv::IMWRITE_PNG_STRATEGY_DEFAULT},
+		{"mono16 single stripe", 31, 40, CV_16UC1, 1, cv::IMWRITE_PNG_STRATEGY_DEFAULT},
+		{"mono16 multi stripe", 1777, 600, CV_16UC1, 1, cv::IMWRITE_PNG_STRATEGY_DEFAULT},
+		{"mono16 multi stripe level 0", 1777, 600, CV_16UC1, 0, cv::IMWRITE_PNG_STRATEGY_DEFAULT},
+	};
+
+	int failures = 0;
+	for (const Case &test : cases)
+	{
+		failures += RunCase(encoder, test) ? 0 : 1;
+	}
+	if (encoder.FallbackCount() > 0 && ParallelPngEncoder::Available())
+	{
+		cout << "FAIL " << encoder.FallbackCount() << " images fell back to cv::imencode" << endl;
+		failures++;
+	}
+
+	cout << (failures == 0 ? "All tests passed" : std::to_string(failures) + " test(s) failed") << endl;
+	return failures == 0 ? 0 : 1;
+}
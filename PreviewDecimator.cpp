@@ -0,0 +1,262 @@
+﻿#include "PreviewDecimator.h"
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define PREVIEW_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define PREVIEW_TARGET_AVX2
+#else
+#define PREVIEW_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#elif defined(__ARM_NEON) || defined(__aarch64__)
+#define PREVIEW_NEON
+#include <arm_neon.h>
+#endif
+
+using namespace Spinnaker;
+
+namespace
+{
+// 累加一行到列和：sums[x] += src[x]（8 位）或 src[x] >> 8（16 位，只取高 8 位）
+typedef void (*AccumulateFunc)(const uint8_t *pSrc, uint16_t *pSums, size_t width);
+
+void Accumulate8Scalar(const uint8_t *pSrc, uint16_t *pSums, size_t width)
+{
+	for (size_t x = 0; x < width; x++)
+	{
+		pSums[x] = static_cast<uint16_t>(pSums[x] + pSrc[x]);
+	}
+}
+
+void Accumulate16Scalar(const uint8_t *pSrc, uint16_t *pSums, size_t width)
+{
+	const uint16_t *pSrc16 = reinterpret_cast<const uint16_t *>(pSrc);
+	for (size_t x = 0; x < width; x++)
+	{
+		pSums[x] = static_cast<uint16_t>(pSums[x] + (pSrc16[x] >> 8));
+	}
+}
+
+#if defined(PREVIEW_X86)
+PREVIEW_TARGET_AVX2 void Accumulate8Avx2(const uint8_t *pSrc, uint16_t *pSums, size_t width)
+{
+	size_t x = 0;
+	for (; x + 16 <= width; x += 16)
+	{
+		const __m256i pixels = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(pSrc + x)));
+		__m256i *pOut = reinterpret_cast<__m256i *>(pSums + x);
+		_mm256_storeu_si256(pOut, _mm256_add_epi16(_mm256_loadu_si256(pOut), pixels));
+	}
+	Accumulate8Scalar(pSrc + x, pSums + x, width - x);
+}
+
+PREVIEW_TARGET_AVX2 void Accumulate16Avx2(const uint8_t *pSrc, uint16_t *pSums, size_t width)
+{
+	const uint16_t *pSrc16 = reinterpret_cast<const uint16_t *>(pSrc);
+	size_t x = 0;
+	for (; x + 16 <= width; x += 16)
+	{
+		const __m256i pixels = _mm256_srli_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(pSrc16 + x)), 8);
+		__m256i *pOut = reinterpret_cast<__m256i *>(pSums + x);
+		_mm256_storeu_si256(pOut, _mm256_add_epi16(_mm256_loadu_si256(pOut), pixels));
+	}
+	Accumulate16Scalar(reinterpret_cast<const uint8_t *>(pSrc16 + x), pSums + x, width - x);
+}
+
+void Accumulate8Sse2(const uint8_t *pSrc, uint16_t *pSums, size_t width)
+{
+	const __m128i zero = _mm_setzero_si128();
+	size_t x = 0;
+	for (; x + 16 <= width; x += 16)
+	{
+		const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pSrc + x));
+		__m128i *pLow = reinterpret_cast<__m128i *>(pSums + x);
+		__m128i *pHigh = reinterpret_cast<__m128i *>(pSums + x + 8);
+		_mm_storeu_si128(pLow, _mm_add_epi16(_mm_loadu_si128(pLow), _mm_unpacklo_epi8(pixels, zero)));
+		_mm_storeu_si128(pHigh, _mm_add_epi16(_mm_loadu_si128(pHigh), _mm_unpackhi_epi8(pixels, zero)));
+	}
+	Accumulate8Scalar(pSrc + x, pSums + x, width - x);
+}
+
+void Accumulate16Sse2(const uint8_t *pSrc, uint16_t *pSums, size_t width)
+{
+	const uint16_t *pSrc16 = reinterpret_cast<const uint16_t *>(pSrc);
+	size_t x = 0;
+	for (; x + 8 <= width; x += 8)
+	{
+		const __m128i pixels = _mm_srli_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(pSrc16 + x)), 8);
+		__m128i *pOut = reinterpret_cast<__m128i *>(pSums + x);
+		_mm_storeu_si128(pOut, _mm_add_epi16(_mm_loadu_si128(pOut), pixels));
+	}
+	Accumulate16Scalar(reinterpret_cast<const uint8_t *>(pSrc16 + x), pSums + x, width - x);
+}
+
+bool CpuHasAvx2()
+{
+#if defined(_MSC_VER)
+	int info[4];
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#else
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2") != 0;
+#endif
+}
+#elif defined(PREVIEW_NEON)
+void Accumulate8Neon(const uint8_t *pSrc, uint16_t *pSums, size_t width)
+{
+	size_t x = 0;
+	for (; x + 16 <= width; x += 16)
+	{
+		const uint8x16_t pixels = vld1q_u8(pSrc + x);
+		vst1q_u16(pSums + x, vaddw_u8(vld1q_u16(pSums + x), vget_low_u8(pixels)));
+		vst1q_u16(pSums + x + 8, vaddw_u8(vld1q_u16(pSums + x + 8), vget_high_u8(pixels)));
+	}
+	Accumulate8Scalar(pSrc + x, pSums + x, width - x);
+}
+
+void Accumulate16Neon(const uint8_t *pSrc, uint16_t *pSums, size_t width)
+{
+	const uint16_t *pSrc16 = reinterpret_cast<const uint16_t *>(pSrc);
+	size_t x = 0;
+	for (; x + 8 <= width; x += 8)
+	{
+		const uint16x8_t pixels = vshrq_n_u16(vld1q_u16(pSrc16 + x), 8);
+		vst1q_u16(pSums + x, vaddq_u16(vld1q_u16(pSums + x), pixels));
+	}
+	Accumulate16Scalar(reinterpret_cast<const uint8_t *>(pSrc16 + x), pSums + x, width - x);
+}
+#endif
+
+// 运行时选择一次即可
+struct Kernels
+{
+	AccumulateFunc accumulate8;
+	AccumulateFunc accumulate16;
+	const char *name;
+};
+
+const Kernels &SelectKernels()
+{
+	static const Kernels kernels = []
+	{
+#if defined(PREVIEW_X86)
+		if (CpuHasAvx2())
+		{
+			return Kernels{Accumulate8Avx2, Accumulate16Avx2, "AVX2"};
+		}
+		return Kernels{Accumulate8Sse2, Accumulate16Sse2, "SSE2"};
+#elif defined(PREVIEW_NEON)
+		return Kernels{Accumulate8Neon, Accumulate16Neon, "NEON"};
+#else
+		return Kernels{Accumulate8Scalar, Accumulate16Scalar, "scalar"};
+#endif
+	}();
+	return kernels;
+}
+} // namespace
+
+PreviewDecimator::PreviewDecimator(int factor)
+{
+	// 列和为 uint16，factor 不超过 16 时不会溢出（16 * 255 = 4080）
+	m_factor = factor < 1 ? 1 : (factor > 16 ? 16 : factor);
+	m_scale = (65536u + static_cast<uint32_t>(m_factor * m_factor) / 2) / static_cast<uint32_t>(m_factor * m_factor);
+}
+
+bool PreviewDecimator::SupportsFused(PixelFormatEnums format) const
+{
+	if (format == PixelFormat_Mono8 || format == PixelFormat_Mono16)
+	{
+		return true;
+	}
+	// 偶数倍时每块恰好是整数个 2x2 CFA 单元，各块的颜色权重相同
+	return IsBayer(format) && m_factor % 2 == 0;
+}
+
+bool PreviewDecimator::IsBayer(PixelFormatEnums format)
+{
+	switch (format)
+	{
+	case PixelFormat_BayerRG8:
+	case PixelFormat_BayerGB8:
+	case PixelFormat_BayerGR8:
+	case PixelFormat_BayerBG8:
+	case PixelFormat_BayerRG16:
+	case PixelFormat_BayerGB16:
+	case PixelFormat_BayerGR16:
+	case PixelFormat_BayerBG16:
+		return true;
+	default:
+		return false;
+	}
+}
+
+const cv::Mat &PreviewDecimator::Decimate(const ImagePtr &image)
+{
+	const PixelFormatEnums format = image->GetPixelFormat();
+	if (!SupportsFused(format))
+	{
+		m_preview.release();
+		return m_preview;
+	}
+
+	const bool sixteenBit = image->GetBitsPerPixel() > 8;
+	size_t stride = image->GetStride();
+	if (stride == 0)
+	{
+		stride = (image->GetWidth() + image->GetXPadding()) * (sixteenBit ? 2 : 1);
+	}
+	return Run(static_cast<const uint8_t *>(image->GetData()), image->GetWidth(), image->GetHeight(), stride, sixteenBit);
+}
+
+const cv::Mat &PreviewDecimator::Decimate(const cv::Mat &mono8)
+{
+	return Run(mono8.ptr<uint8_t>(0), static_cast<size_t>(mono8.cols), static_cast<size_t>(mono8.rows), mono8.step, false);
+}
+
+const char *PreviewDecimator::InstructionSet()
+{
+	return SelectKernels().name;
+}
+
+const cv::Mat &PreviewDecimator::Run(const uint8_t *pData, size_t width, size_t height, size_t stride, bool sixteenBit)
+{
+	const Kernels &kernels = SelectKernels();
+	const AccumulateFunc accumulate = sixteenBit ? kernels.accumulate16 : kernels.accumulate8;
+	const size_t factor = static_cast<size_t>(m_factor);
+	const size_t outWidth = width / factor;
+	const size_t outHeight = height / factor;
+
+	// 持久缓冲，尺寸不变时不重新分配
+	m_preview.create(static_cast<int>(outHeight), static_cast<int>(outWidth), CV_8UC1);
+	m_columnSums.resize(outWidth * factor);
+	const size_t usedWidth = outWidth * factor; // 右侧不足一块的像素直接丢弃
+
+	for (size_t oy = 0; oy < outHeight; oy++)
+	{
+		// 垂直方向：factor 行逐列累加
+		uint16_t *pSums = m_columnSums.data();
+		memset(pSums, 0, usedWidth * sizeof(uint16_t));
+		const uint8_t *pRow = pData + oy * factor * stride;
+		for (size_t k = 0; k < factor; k++, pRow += stride)
+		{
+			accumulate(pRow, pSums, usedWidth);
+		}
+
+		// 水平方向：每 factor 列求和后定点除以 factor * factor
+		uint8_t *pOut = m_preview.ptr<uint8_t>(static_cast<int>(oy));
+		for (size_t ox = 0; ox < outWidth; ox++)
+		{
+			uint32_t sum = 0;
+			for (size_t k = 0; k < factor; k++)
+			{
+				sum += pSums[k];
+			}
+			pSums += factor;
+			pOut[ox] = static_cast<uint8_t>((sum * m_scale + 32768u) >> 16);
+		}
+	}
+	return m_preview;
+}
@@ -0,0 +1,41 @@
+﻿#pragma once
+
+#include "Spinnaker.h"
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+#include <vector>
+
+// 预览用整数倍缩小：factor x factor 区域取平均（box filter），结果写入持久缓冲。
+// 垂直方向逐行累加使用 AVX2 / SSE2 / NEON，水平方向按块求和后定点除法。
+// 对 Mono8/Mono16 以及 8/16 位 Bayer 原始帧可直接生成灰度预览（Bayer 块内 R、G、B 被一起平均），
+// 不需要先做完整的 Mono8 转换，每个源像素只读一次。Bayer 只在倍数为偶数时直接缩小：
+// 奇数倍时相邻块覆盖的 R、G、B 个数不同，预览会出现棋盘格。
+class PreviewDecimator
+{
+public:
+	explicit PreviewDecimator(int factor);
+
+	int Factor() const { return m_factor; }
+
+	// 能否以当前倍数直接从该像素格式的原始帧生成预览
+	bool SupportsFused(Spinnaker::PixelFormatEnums format) const;
+	// 8/16 位 Bayer 原始格式（只有偶数倍时能直接缩小）
+	static bool IsBayer(Spinnaker::PixelFormatEnums format);
+
+	// 直接从原始帧生成预览；格式不支持时返回空 Mat
+	const cv::Mat &Decimate(const Spinnaker::ImagePtr &image);
+
+	// 从已有的 Mono8 图像生成预览
+	const cv::Mat &Decimate(const cv::Mat &mono8);
+
+	// 当前使用的向量指令集，便于打印确认
+	static const char *InstructionSet();
+
+private:
+	const cv::Mat &Run(const uint8_t *pData, size_t width, size_t height, size_t stride, bool sixteenBit);
+
+	int m_factor;
+	uint32_t m_scale; // 65536 / (factor * factor)，定点除法用
+	cv::Mat m_preview;
+	std::vector<uint16_t> m_columnSums;
+};
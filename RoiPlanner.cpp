@@ -0,0 +1,601 @@
+﻿#include "RoiPlanner.h"
+#include "SpinGenApi/SpinnakerGenApi.h"
+#include <algorithm>
+#include <cctype>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+using namespace Spinnaker;
+using namespace Spinnaker::GenApi;
+using namespace std;
+
+namespace
+{
+// 目标帧率达到与否、帧率是否相同时允许的误差
+const double kFpsTolerance = 0.01;
+
+// 探测时帧率已用到链路带宽的这个比例以上，说明受带宽而不是读出限制
+const double kLinkBoundRatio = 0.95;
+
+// 规划所需的相机能力，均为不合并、不抽取时的传感器像素
+struct SensorInfo
+{
+	int64_t width = 0;
+	int64_t height = 0;
+	int64_t widthMin = 1;
+	int64_t heightMin = 1;
+	int64_t widthInc = 1;
+	int64_t heightInc = 1;
+	int64_t maxBinning = 1;
+	int64_t maxDecimation = 1;
+	std::string currentFormat;
+	double currentBitsPerPixel = 0.0;
+	double linkBytesPerSecond = 0.0; // 0 为不可读（不按带宽限制）
+	double sensorRowsPerSecond = 0.0; // 0 为未知（探测时受带宽或曝光限制）
+	double exposureFps = 0.0;
+};
+
+int64_t ReadInteger(INodeMap &nodeMap, const char *name, int64_t fallback)
+{
+	CIntegerPtr ptrNode = nodeMap.GetNode(name);
+	return IsReadable(ptrNode) ? ptrNode->GetValue() : fallback;
+}
+
+double ReadFloat(INodeMap &nodeMap, const char *name)
+{
+	CFloatPtr ptrNode = nodeMap.GetNode(name);
+	return IsReadable(ptrNode) ? ptrNode->GetValue() : 0.0;
+}
+
+// 可写时返回节点允许的最大值，否则为 1
+int64_t WritableMax(INodeMap &nodeMap, const char *name)
+{
+	CIntegerPtr ptrNode = nodeMap.GetNode(name);
+	return IsWritable(ptrNode) ? std::max<int64_t>(1, ptrNode->GetMax()) : 1;
+}
+
+void SetInteger(INodeMap &nodeMap, const char *name, int64_t value)
+{
+	CIntegerPtr ptrNode = nodeMap.GetNode(name);
+	if (IsWritable(ptrNode) && ptrNode->GetValue() != value)
+	{
+		ptrNode->SetValue(value);
+	}
+}
+
+// 按 min + k * inc 向下取整
+int64_t RoundToIncrement(int64_t value, int64_t minimum, int64_t increment)
+{
+	if (value <= minimum)
+	{
+		return minimum;
+	}
+	increment = std::max<int64_t>(1, increment);
+	return minimum + (value - minimum) / increment * increment;
+}
+
+// 从 PFNC 名称推算每像素位数：Mono12p / BayerRG12Packed 为紧凑格式，Mono12 / Mono16 按 16 位存放，
+// RGB8 / BGRa8 等按通道数相乘。无法识别时返回 0
+double BitsPerPixel(const std::string &format)
+{
+	if (format.rfind("YUV422", 0) == 0 || format.rfind("YCbCr422", 0) == 0)
+	{
+		return 16.0;
+	}
+	if (format.rfind("YUV411", 0) == 0 || format.rfind("YCbCr411", 0) == 0)
+	{
+		return 12.0;
+	}
+
+	int channels = 1;
+	if (format.rfind("RGBa", 0) == 0 || format.rfind("BGRa", 0) == 0)
+	{
+		channels = 4;
+	}
+	else if (format.rfind("RGB", 0) == 0 || format.rfind("BGR", 0) == 0 || format.rfind("YUV", 0) == 0 ||
+			 format.rfind("YCbCr", 0) == 0)
+	{
+		channels = 3;
+	}
+	else if (format.rfind("Mono", 0) != 0 && format.rfind("Bayer", 0) != 0)
+	{
+		return 0.0;
+	}
+
+	const size_t digits = format.find_first_of("0123456789");
+	if (digits == std::string::npos)
+	{
+		return 0.0;
+	}
+	size_t end = digits;
+	int bits = 0;
+	while (end < format.size() && isdigit(static_cast<unsigned char>(format[end])))
+	{
+		bits = bits * 10 + (format[end] - '0');
+		end++;
+	}
+	const bool packed = format.compare(end, std::string::npos, "p") == 0 || format.find("Packed", end) != std::string::npos;
+	if (!packed)
+	{
+		bits = bits <= 8 ? 8 : 16;
+	}
+	return static_cast<double>(bits * channels);
+}
+
+std::string CurrentPixelFormat(INodeMap &nodeMap)
+{
+	CEnumerationPtr ptrPixelFormat = nodeMap.GetNode("PixelFormat");
+	return IsReadable(ptrPixelFormat) ? std::string(ptrPixelFormat->GetCurrentEntry()->GetSymbolic().c_str()) : "";
+}
+
+bool IsFormatAvailable(INodeMap &nodeMap, const std::string &format)
+{
+	CEnumerationPtr ptrPixelFormat = nodeMap.GetNode("PixelFormat");
+	if (!IsWritable(ptrPixelFormat))
+	{
+		return false;
+	}
+	CEnumEntryPtr ptrEntry = ptrPixelFormat->GetEntryByName(format.c_str());
+	return IsReadable(ptrEntry);
+}
+
+// frameRate 为 0 时关闭帧率限制，使 AcquisitionResultingFrameRate 反映当前配置下的最高帧率
+void SetFrameRateLimit(INodeMap &nodeMap, double frameRate)
+{
+	CBooleanPtr ptrEnable = nodeMap.GetNode("AcquisitionFrameRateEnable");
+	if (!IsWritable(ptrEnable))
+	{
+		// 较早的固件使用 AcquisitionFrameRateEnabled
+		ptrEnable = nodeMap.GetNode("AcquisitionFrameRateEnabled");
+	}
+	if (IsWritable(ptrEnable) && ptrEnable->GetValue() != (frameRate > 0.0))
+	{
+		ptrEnable->SetValue(frameRate > 0.0);
+	}
+
+	CFloatPtr ptrFrameRate = nodeMap.GetNode("AcquisitionFrameRate");
+	if (frameRate > 0.0 && IsWritable(ptrFrameRate))
+	{
+		const double value = std::min(std::max(frameRate, ptrFrameRate->GetMin()), ptrFrameRate->GetMax());
+		if (ptrFrameRate->GetValue() != value)
+		{
+			ptrFrameRate->SetValue(value);
+		}
+	}
+}
+
+SensorInfo ReadSensorInfo(INodeMap &nodeMap)
+{
+	SensorInfo info;
+
+	const int64_t binning = ReadInteger(nodeMap, "BinningVertical", 1);
+	const int64_t decimation = ReadInteger(nodeMap, "DecimationVertical", 1);
+	const int64_t factorX = ReadInteger(nodeMap, "BinningHorizontal", 1) * ReadInteger(nodeMap, "DecimationHorizontal", 1);
+	const int64_t factorY = binning * decimation;
+
+	// SensorWidth / SensorHeight 不存在时由当前合并 / 抽取下的最大值还原
+	info.width = ReadInteger(nodeMap, "SensorWidth", ReadInteger(nodeMap, "WidthMax", 0) * factorX);
+	info.height = ReadInteger(nodeMap, "SensorHeight", ReadInteger(nodeMap, "HeightMax", 0) * factorY);
+
+	CIntegerPtr ptrWidth = nodeMap.GetNode("Width");
+	CIntegerPtr ptrHeight = nodeMap.GetNode("Height");
+	if (IsReadable(ptrWidth) && IsReadable(ptrHeight))
+	{
+		info.widthMin = ptrWidth->GetMin();
+		info.heightMin = ptrHeight->GetMin();
+		info.widthInc = ptrWidth->GetInc();
+		info.heightInc = ptrHeight->GetInc();
+	}
+
+	info.maxBinning = std::min(WritableMax(nodeMap, "BinningHorizontal"), WritableMax(nodeMap, "BinningVertical"));
+	info.maxDecimation = std::min(WritableMax(nodeMap, "DecimationHorizontal"), WritableMax(nodeMap, "DecimationVertical"));
+
+	info.currentFormat = CurrentPixelFormat(nodeMap);
+	const int64_t width = ReadInteger(nodeMap, "Width", 0);
+	const int64_t height = ReadInteger(nodeMap, "Height", 0);
+	const int64_t payload = ReadInteger(nodeMap, "PayloadSize", 0);
+	info.currentBitsPerPixel = BitsPerPixel(info.currentFormat);
+	if (info.currentBitsPerPixel <= 0.0 && width > 0 && height > 0)
+	{
+		info.currentBitsPerPixel = static_cast<double>(payload) * 8.0 / static_cast<double>(width * height);
+	}
+
+	info.linkBytesPerSecond = static_cast<double>(ReadInteger(nodeMap, "DeviceLinkThroughputLimit", 0));
+
+	const double exposureUs = ReadFloat(nodeMap, "ExposureTime");
+	info.exposureFps = exposureUs > 0.0 ? 1e6 / exposureUs : 0.0;
+
+	// 探测：当前配置下不限帧率时的实际帧率。若没有受带宽或曝光限制，就是传感器读出速度，
+	// 换算成每秒读出的传感器行数（合并时所有行都要读出，抽取跳过的行不读）
+	SetFrameRateLimit(nodeMap, 0.0);
+	const double probeFps = ReadFloat(nodeMap, "AcquisitionResultingFrameRate");
+	const bool linkBound = info.linkBytesPerSecond > 0.0 && probeFps * payload >= kLinkBoundRatio * info.linkBytesPerSecond;
+	const bool exposureBound = info.exposureFps > 0.0 && probeFps >= (1.0 - kFpsTolerance) * info.exposureFps;
+	if (probeFps > 0.0 && height > 0 && !linkBound && !exposureBound)
+	{
+		info.sensorRowsPerSecond = probeFps * static_cast<double>(height * binning);
+	}
+
+	return info;
+}
+
+// 给定合并 / 抽取倍数和像素格式，计算居中的输出尺寸和各项限制下的帧率
+RoiPlan MakeCandidate(const SensorInfo &info, const RoiTarget &target, int64_t binning, int64_t decimation,
+					  const std::string &format, double bitsPerPixel)
+{
+	RoiPlan plan;
+	plan.binning = binning;
+	plan.decimation = decimation;
+	plan.pixelFormat = format;
+	plan.bitsPerPixel = bitsPerPixel;
+
+	const int64_t factor = binning * decimation;
+	const int64_t maxWidth = info.width / factor;
+	const int64_t maxHeight = info.height / factor;
+	const int64_t fovWidth = target.width > 0 ? std::min(target.width, info.width) : info.width;
+	const int64_t fovHeight = target.height > 0 ? std::min(target.height, info.height) : info.height;
+	plan.width = std::min(RoundToIncrement(fovWidth / factor, info.widthMin, info.widthInc), maxWidth);
+	plan.height = std::min(RoundToIncrement(fovHeight / factor, info.heightMin, info.heightInc), maxHeight);
+	plan.offsetX = (maxWidth - plan.width) / 2;
+	plan.offsetY = (maxHeight - plan.height) / 2;
+
+	const double frameBytes = static_cast<double>(plan.width * plan.height) * bitsPerPixel / 8.0;
+	if (info.linkBytesPerSecond > 0.0 && frameBytes > 0.0)
+	{
+		plan.linkFps = info.linkBytesPerSecond / frameBytes;
+	}
+	if (info.sensorRowsPerSecond > 0.0)
+	{
+		plan.readoutFps = info.sensorRowsPerSecond / static_cast<double>(plan.height * binning);
+	}
+	plan.exposureFps = info.exposureFps;
+
+	plan.predictedFps = 0.0;
+	for (double limit : {plan.linkFps, plan.readoutFps, plan.exposureFps})
+	{
+		if (limit > 0.0 && (plan.predictedFps == 0.0 || limit < plan.predictedFps))
+		{
+			plan.predictedFps = limit;
+		}
+	}
+	return plan;
+}
+
+// 预测帧率为 0 表示没有任何已知限制，按无穷大比较
+bool Faster(const RoiPlan &a, const RoiPlan &b)
+{
+	if (b.predictedFps == 0.0)
+	{
+		return false;
+	}
+	return a.predictedFps == 0.0 || a.predictedFps > b.predictedFps * (1.0 + kFpsTolerance);
+}
+
+bool Reaches(const RoiPlan &plan, double frameRate)
+{
+	return plan.predictedFps == 0.0 || plan.predictedFps >= frameRate * (1.0 - kFpsTolerance);
+}
+
+// 按目标帧率（不限帧率时按预测帧率）计算输出数据率，未知时不限制
+bool WithinBudget(const RoiPlan &plan, const RoiTarget &target)
+{
+	const double fps = target.frameRate > 0.0 ? target.frameRate : plan.predictedFps;
+	if (target.maxBytesPerSecond <= 0.0 || fps <= 0.0)
+	{
+		return true;
+	}
+	const double frameBytes = static_cast<double>(plan.width * plan.height) * plan.bitsPerPixel / 8.0;
+	return frameBytes * fps <= target.maxBytesPerSecond;
+}
+
+std::string FormatFps(double fps)
+{
+	if (fps <= 0.0)
+	{
+		return "n/a";
+	}
+	std::ostringstream text;
+	text << std::fixed << std::setprecision(1) << fps;
+	return text.str();
+}
+
+void PrintPlan(const char *label, const RoiPlan &plan)
+{
+	cout << label << plan.width << "x" << plan.height << " " << plan.pixelFormat << " bin " << plan.binning << " dec "
+		 << plan.decimation << " at (" << plan.offsetX << ", " << plan.offsetY << "): link " << FormatFps(plan.linkFps)
+		 << ", readout " << FormatFps(plan.readoutFps) << ", exposure " << FormatFps(plan.exposureFps) << " -> "
+		 << FormatFps(plan.predictedFps) << " fps" << endl;
+}
+
+// 候选按画质从高到低排列：先不合并 / 抽取，再按配置的像素格式顺序
+std::vector<RoiPlan> EnumerateCandidates(INodeMap &nodeMap, const SensorInfo &info, const RoiTarget &target)
+{
+	std::vector<std::pair<std::string, double>> formats;
+	for (const std::string &format : target.pixelFormats)
+	{
+		const double bits = BitsPerPixel(format);
+		if (bits > 0.0 && IsFormatAvailable(nodeMap, format))
+		{
+			formats.emplace_back(format, bits);
+		}
+		else
+		{
+			cout << "Warning: pixel format " << format << " not available, skipped" << endl;
+		}
+	}
+	if (formats.empty())
+	{
+		formats.emplace_back(info.currentFormat, info.currentBitsPerPixel);
+	}
+
+	std::vector<RoiPlan> candidates;
+	const int64_t maxBinning = std::min(target.maxBinning, info.maxBinning);
+	const int64_t maxDecimation = std::min(target.maxDecimation, info.maxDecimation);
+	for (int64_t factor = 1; factor <= maxBinning * maxDecimation; factor++)
+	{
+		for (int64_t binning = 1; binning <= maxBinning; binning++)
+		{
+			if (factor % binning != 0 || factor / binning > maxDecimation)
+			{
+				continue;
+			}
+			for (const auto &format : formats)
+			{
+				candidates.push_back(MakeCandidate(info, target, binning, factor / binning, format.first, format.second));
+			}
+		}
+	}
+	return candidates;
+}
+
+RoiPlan ChoosePlan(const std::vector<RoiPlan> &candidates, const RoiTarget &target)
+{
+	if (target.frameRate > 0.0)
+	{
+		for (const RoiPlan &plan : candidates)
+		{
+			if (Reaches(plan, target.frameRate) && WithinBudget(plan, target))
+			{
+				return plan;
+			}
+		}
+	}
+
+	// 达不到目标帧率时取最快的一个，数据率上限内的优先
+	const RoiPlan *best = nullptr;
+	for (const RoiPlan &plan : candidates)
+	{
+		if (WithinBudget(plan, target) && (best == nullptr || Faster(plan, *best)))
+		{
+			best = &plan;
+		}
+	}
+	if (best == nullptr)
+	{
+		best = &candidates.front();
+		for (const RoiPlan &plan : candidates)
+		{
+			if (Faster(plan, *best))
+			{
+				best = &plan;
+			}
+		}
+	}
+	return *best;
+}
+
+// 先清零偏移再改合并 / 抽取和格式，最后按相机此时给出的最大值和步进重新居中。
+// 只写与当前值不同的节点：与上次启动配置相同时不产生任何写入
+void ApplyPlan(INodeMap &nodeMap, RoiPlan &plan)
+{
+	const bool geometryChanged =
+		ReadInteger(nodeMap, "BinningHorizontal", 1) != plan.binning ||
+		ReadInteger(nodeMap, "BinningVertical", 1) != plan.binning ||
+		ReadInteger(nodeMap, "DecimationHorizontal", 1) != plan.decimation ||
+		ReadInteger(nodeMap, "DecimationVertical", 1) != plan.decimation ||
+		(!plan.pixelFormat.empty() && plan.pixelFormat != CurrentPixelFormat(nodeMap)) ||
+		ReadInteger(nodeMap, "Width", 0) != plan.width || ReadInteger(nodeMap, "Height", 0) != plan.height;
+	if (geometryChanged)
+	{
+		SetInteger(nodeMap, "OffsetX", 0);
+		SetInteger(nodeMap, "OffsetY", 0);
+	}
+	SetInteger(nodeMap, "BinningHorizontal", plan.binning);
+	SetInteger(nodeMap, "BinningVertical", plan.binning);
+	SetInteger(nodeMap, "DecimationHorizontal", plan.decimation);
+	SetInteger(nodeMap, "DecimationVertical", plan.decimation);
+
+	CEnumerationPtr ptrPixelFormat = nodeMap.GetNode("PixelFormat");
+	if (!plan.pixelFormat.empty() && plan.pixelFormat != CurrentPixelFormat(nodeMap) && IsWritable(ptrPixelFormat))
+	{
+		ptrPixelFormat->SetIntValue(ptrPixelFormat->GetEntryByName(plan.pixelFormat.c_str())->GetValue());
+	}
+
+	CIntegerPtr ptrWidth = nodeMap.GetNode("Width");
+	CIntegerPtr ptrHeight = nodeMap.GetNode("Height");
+	SetInteger(nodeMap, "Width",
+			   std::min(RoundToIncrement(plan.width, ptrWidth->GetMin(), ptrWidth->GetInc()), ptrWidth->GetMax()));
+	SetInteger(nodeMap, "Height",
+			   std::min(RoundToIncrement(plan.height, ptrHeight->GetMin(), ptrHeight->GetInc()), ptrHeight->GetMax()));
+	plan.width = ptrWidth->GetValue();
+	plan.height = ptrHeight->GetValue();
+
+	CIntegerPtr ptrOffsetX = nodeMap.GetNode("OffsetX");
+	CIntegerPtr ptrOffsetY = nodeMap.GetNode("OffsetY");
+	if (IsWritable(ptrOffsetX) && IsWritable(ptrOffsetY))
+	{
+		const int64_t widthMax = ReadInteger(nodeMap, "WidthMax", plan.width);
+		const int64_t heightMax = ReadInteger(nodeMap, "HeightMax", plan.height);
+		SetInteger(nodeMap, "OffsetX", RoundToIncrement((widthMax - plan.width) / 2, 0, ptrOffsetX->GetInc()));
+		SetInteger(nodeMap, "OffsetY", RoundToIncrement((heightMax - plan.height) / 2, 0, ptrOffsetY->GetInc()));
+		plan.offsetX = ptrOffsetX->GetValue();
+		plan.offsetY = ptrOffsetY->GetValue();
+	}
+	else if (plan.width * plan.binning * plan.decimation < ReadInteger(nodeMap, "SensorWidth", 0) ||
+			 plan.height * plan.binning * plan.decimation < ReadInteger(nodeMap, "SensorHeight", 0))
+	{
+		cout << "Warning: OffsetX or OffsetY not writable, ROI may not be centered." << endl;
+	}
+}
+} // namespace
+
+int ConfigureRoi(CameraPtr pCam, const RoiTarget &target, RoiPlan *applied)
+{
+	int result = 0;
+
+	try
+	{
+		INodeMap &nodeMap = pCam->GetNodeMap();
+
+		CIntegerPtr ptrWidth = nodeMap.GetNode("Width");
+		CIntegerPtr ptrHeight = nodeMap.GetNode("Height");
+		if (!IsWritable(ptrWidth) || !IsWritable(ptrHeight))
+		{
+			cout << "Error: Width or Height not writable, cannot set ROI." << endl;
+			return -1;
+		}
+
+		const SensorInfo info = ReadSensorInfo(nodeMap);
+		cout << "Sensor " << info.width << "x" << info.height << ", link limit ";
+		if (info.linkBytesPerSecond > 0.0)
+		{
+			cout << info.linkBytesPerSecond / 1e6 << " MB/s";
+		}
+		else
+		{
+			cout << "unknown";
+		}
+		cout << ", binning up to " << info.maxBinning << ", decimation up to " << info.maxDecimation << endl;
+
+		const std::vector<RoiPlan> candidates = EnumerateCandidates(nodeMap, info, target);
+		if (candidates.size() > 1)
+		{
+			for (const RoiPlan &plan : candidates)
+			{
+				PrintPlan("  candidate ", plan);
+			}
+		}
+
+		RoiPlan plan = ChoosePlan(candidates, target);
+		if (target.frameRate > 0.0 && !Reaches(plan, target.frameRate))
+		{
+			cout << "Warning: no configuration reaches " << target.frameRate << " fps, using the fastest one" << endl;
+		}
+		if (!WithinBudget(plan, target))
+		{
+			cout << "Warning: no configuration fits " << target.maxBytesPerSecond / 1e6 << " MB/s" << endl;
+		}
+
+		ApplyPlan(nodeMap, plan);
+		SetFrameRateLimit(nodeMap, target.frameRate);
+		if (target.frameRate > 0.0 && (plan.predictedFps == 0.0 || plan.predictedFps > target.frameRate))
+		{
+			plan.predictedFps = target.frameRate;
+		}
+		PrintPlan("ROI set to ", plan);
+
+		const double actualFps = ReadFloat(nodeMap, "AcquisitionResultingFrameRate");
+		cout << "Predicted frame rate " << FormatFps(plan.predictedFps) << " fps, AcquisitionResultingFrameRate "
+			 << FormatFps(actualFps) << " fps" << endl;
+
+		if (applied != nullptr)
+		{
+			*applied = plan;
+		}
+	}
+	catch (Spinnaker::Exception &e)
+	{
+		cout << "Error: " << e.what() << endl;
+		result = -1;
+	}
+
+	return result;
+}
+
+std::string FormatRoiPlan(const RoiPlan &plan)
+{
+	std::ostringstream text;
+	text << plan.binning << " " << plan.decimation << " " << (plan.pixelFormat.empty() ? "-" : plan.pixelFormat) << " "
+		 << plan.width << " " << plan.height << " " << plan.offsetX << " " << plan.offsetY;
+	return text.str();
+}
+
+bool ParseRoiPlan(const std::string &text, RoiPlan &plan)
+{
+	std::istringstream in(text);
+	RoiPlan parsed;
+	if (!(in >> parsed.binning >> parsed.decimation >> parsed.pixelFormat >> parsed.width >> parsed.height >>
+		  parsed.offsetX >> parsed.offsetY) ||
+		parsed.binning < 1 || parsed.decimation < 1 || parsed.width <= 0 || parsed.height <= 0)
+	{
+		return false;
+	}
+	if (parsed.pixelFormat == "-")
+	{
+		parsed.pixelFormat.clear();
+	}
+	plan = parsed;
+	return true;
+}
+
+int ApplyRoiPlan(CameraFeatures &features, const RoiPlan &plan, double frameRate)
+{
+	// 与 ApplyPlan() 顺序相同；合并 / 抽取节点不可写时只要当前值已符合即可
+	auto setFactor = [&features](IntegerFeature feature, int64_t value) {
+		return features.Get(feature, 1) == value || features.Set(feature, value);
+	};
+
+	const bool geometryChanged =
+		features.Get(FEATURE_BINNING_HORIZONTAL, 1) != plan.binning ||
+		features.Get(FEATURE_BINNING_VERTICAL, 1) != plan.binning ||
+		features.Get(FEATURE_DECIMATION_HORIZONTAL, 1) != plan.decimation ||
+		features.Get(FEATURE_DECIMATION_VERTICAL, 1) != plan.decimation ||
+		(!plan.pixelFormat.empty() && plan.pixelFormat != features.Get(FEATURE_PIXEL_FORMAT)) ||
+		features.Get(FEATURE_WIDTH, 0) != plan.width || features.Get(FEATURE_HEIGHT, 0) != plan.height;
+	if (geometryChanged)
+	{
+		features.Set(FEATURE_OFFSET_X, 0);
+		features.Set(FEATURE_OFFSET_Y, 0);
+	}
+	if (!setFactor(FEATURE_BINNING_HORIZONTAL, plan.binning) || !setFactor(FEATURE_BINNING_VERTICAL, plan.binning) ||
+		!setFactor(FEATURE_DECIMATION_HORIZONTAL, plan.decimation) ||
+		!setFactor(FEATURE_DECIMATION_VERTICAL, plan.decimation))
+	{
+		cout << "Error: cannot set binning " << plan.binning << " / decimation " << plan.decimation << endl;
+		return -1;
+	}
+	if (!plan.pixelFormat.empty() && !features.Set(FEATURE_PIXEL_FORMAT, plan.pixelFormat))
+	{
+		cout << "Error: cannot set PixelFormat to " << plan.pixelFormat << endl;
+		return -1;
+	}
+
+	int64_t width = 0;
+	int64_t height = 0;
+	if (!features.Set(FEATURE_WIDTH, plan.width, &width) || !features.Set(FEATURE_HEIGHT, plan.height, &height))
+	{
+		cout << "Error: cannot set ROI to " << plan.width << "x" << plan.height << endl;
+		return -1;
+	}
+	if (width != plan.width || height != plan.height)
+	{
+		cout << "Warning: ROI applied as " << width << "x" << height << " instead of " << plan.width << "x"
+			 << plan.height << endl;
+	}
+
+	// 宽高写好后偏移的最大值即剩余的传感器像素，取一半居中（Set() 按步进向下取整）
+	if (features.IsWritable(FEATURE_OFFSET_X) && features.IsWritable(FEATURE_OFFSET_Y))
+	{
+		features.Set(FEATURE_OFFSET_X, features.Node(FEATURE_OFFSET_X)->GetMax() / 2);
+		features.Set(FEATURE_OFFSET_Y, features.Node(FEATURE_OFFSET_Y)->GetMax() / 2);
+	}
+
+	// frameRate 为 0 时关闭帧率限制
+	features.Set(FEATURE_ACQUISITION_FRAME_RATE_ENABLE, frameRate > 0.0);
+	if (frameRate > 0.0)
+	{
+		features.Set(FEATURE_ACQUISITION_FRAME_RATE, frameRate);
+	}
+	return 0;
+}
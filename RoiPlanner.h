@@ -0,0 +1,51 @@
+﻿#pragma once
+
+#include "CameraFeatures.h"
+#include "Spinnaker.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// 期望的采集区域和帧率。宽高按传感器像素计（即视场大小），合并 / 抽取后实际输出的像素更少
+struct RoiTarget
+{
+	int64_t width = 0;		  // 0 为传感器全宽
+	int64_t height = 0;		  // 0 为传感器全高
+	double frameRate = 0.0;	  // 0 为尽可能快（关闭 AcquisitionFrameRate 限制）
+	int64_t maxBinning = 1;	  // 允许的最大合并倍数（水平、垂直相同），1 为不合并
+	int64_t maxDecimation = 1; // 允许的最大抽取倍数，1 为不抽取
+	std::vector<std::string> pixelFormats; // 候选像素格式，按偏好排序；空为保持相机当前格式
+	double maxBytesPerSecond = 0.0;		   // 输出数据率上限（如预览时给链路留出余量），0 为不限
+};
+
+// 规划结果：输出像素下的尺寸和居中偏移，以及各项限制下的预测帧率（0 表示该项未知或不受限）
+struct RoiPlan
+{
+	int64_t binning = 1;
+	int64_t decimation = 1;
+	std::string pixelFormat;
+	double bitsPerPixel = 0.0;
+	int64_t width = 0;
+	int64_t height = 0;
+	int64_t offsetX = 0;
+	int64_t offsetY = 0;
+	double linkFps = 0.0;	  // DeviceLinkThroughputLimit / 每帧字节数
+	double readoutFps = 0.0;  // 按传感器读出行数估算
+	double exposureFps = 0.0; // 1 / ExposureTime
+	double predictedFps = 0.0;
+};
+
+// 在 Init() 之后、开始采集之前调用：读取传感器尺寸、步进、合并 / 抽取范围、可用像素格式和链路带宽，
+// 从各种组合中选出满足 target 的配置（目标帧率达得到时取数据率上限内画质最好的一个，达不到时取预测帧率最高的一个），
+// 写入相机并使 ROI 在传感器上居中，最后打印预测帧率和 AcquisitionResultingFrameRate。
+// applied 非空时返回实际写入的配置，之后可用 ApplyRoiPlan() 直接切换回来。
+int ConfigureRoi(Spinnaker::CameraPtr pCam, const RoiTarget &target, RoiPlan *applied = nullptr);
+
+// 规划结果与文本互相转换（随相机配置快照保存，恢复快照时不必重新规划）：
+// "合并 抽取 像素格式 宽 高 OffsetX OffsetY"，像素格式为空时写作 "-"
+std::string FormatRoiPlan(const RoiPlan &plan);
+bool ParseRoiPlan(const std::string &text, RoiPlan &plan);
+
+// 写入事先规划好的配置（例如在预览和全分辨率抓拍之间切换）：不探测、不打印，只写与当前值不同的节点。
+// 通过 features 中已解析的句柄写入，不按名称查节点；须在停止采集时调用，frameRate 同 RoiTarget::frameRate
+int ApplyRoiPlan(CameraFeatures &features, const RoiPlan &plan, double frameRate);
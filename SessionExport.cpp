@@ -0,0 +1,202 @@
+﻿#include "Spinnaker.h"
+#include "Mono8Converter.h"
+#include "SessionFile.h"
+#include <opencv2/opencv.hpp>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+using namespace Spinnaker;
+using namespace std;
+
+namespace fs = std::filesystem;
+
+// 把原始采集会话（.spr）中选中的帧导出为 PNG（8 位灰度，与实时程序保存的格式一致），
+// 也可以只打印会话信息和每帧元数据。
+
+struct ExportOptions
+{
+	std::string sessionPath;
+	std::string outFolder;		// 默认为 <会话文件名>_png
+	uint64_t first = 0;			// 帧号范围 [first, last]
+	uint64_t last = UINT64_MAX;
+	uint64_t every = 1;			// 每 n 帧导出一帧
+	uint64_t fromTimestamp = 0; // 非 0 时按相机时间戳选择起始帧
+	bool infoOnly = false;
+};
+
+void PrintUsage()
+{
+	cout << "Usage: session_export <session.spr> [options]" << endl
+		 << "  --out <folder>        output folder (default <session>_png)" << endl
+		 << "  --frames <a>-<b>      frame index range to export (default all)" << endl
+		 << "  --every <n>           export every n-th frame (default 1)" << endl
+		 << "  --from-ts <ns>        start at the first frame whose camera timestamp is >= ns" << endl
+		 << "  --info                print session and per-frame metadata only" << endl;
+}
+
+bool ParseOptions(int argc, char **argv, ExportOptions &options)
+{
+	if (argc < 2 || std::string(argv[1]) == "--help" || std::string(argv[1]) == "-h")
+	{
+		return false;
+	}
+	options.sessionPath = argv[1];
+
+	for (int i = 2; i < argc; i++)
+	{
+		const std::string arg = argv[i];
+		if (arg == "--info")
+		{
+			options.infoOnly = true;
+			continue;
+		}
+		if (i + 1 >= argc)
+		{
+			cout << "Missing value for " << arg << endl;
+			return false;
+		}
+		const std::string value = argv[++i];
+
+		if (arg == "--out")
+		{
+			options.outFolder = value;
+		}
+		else if (arg == "--frames")
+		{
+			const size_t dash = value.find('-');
+			options.first = std::stoull(value.substr(0, dash));
+			options.last = dash == std::string::npos ? options.first : std::stoull(value.substr(dash + 1));
+		}
+		else if (arg == "--every")
+		{
+			options.every = std::max<uint64_t>(1, std::stoull(value));
+		}
+		else if (arg == "--from-ts")
+		{
+			options.fromTimestamp = std::stoull(value);
+		}
+		else
+		{
+			cout << "Unknown option: " << arg << endl;
+			return false;
+		}
+	}
+
+	if (options.outFolder.empty())
+	{
+		const fs::path path(options.sessionPath);
+		options.outFolder = (path.parent_path() / (path.stem().string() + "_png")).string();
+	}
+	return true;
+}
+
+void PrintFrameInfo(const SessionReader &reader, size_t index)
+{
+	const SessionFrameHeader &header = reader.FrameHeader(index);
+	cout << header.frameIndex << ": FrameID " << header.frameId << ", timestamp " << header.timestamp << ", "
+		 << header.width << "x" << header.height << "+" << header.offsetX << "+" << header.offsetY << ", format "
+		 << header.pixelFormat << ", status " << header.imageStatus << ", exposure " << header.exposureUs
+		 << " us, gain " << header.gainDb << " dB" << endl;
+}
+
+int RunExport(const ExportOptions &options)
+{
+	SessionReader reader;
+	if (!reader.Open(options.sessionPath))
+	{
+		cout << "Failed to open " << options.sessionPath << endl;
+		return -1;
+	}
+
+	cout << "Session " << options.sessionPath << ": " << reader.Header().deviceId << ", " << reader.FrameCount()
+		 << " frames" << (reader.HasIndex() ? "" : " (no index, recovered by scanning)") << endl;
+
+	if (reader.FrameCount() == 0)
+	{
+		return 0;
+	}
+
+	size_t first = static_cast<size_t>(std::min<uint64_t>(options.first, reader.FrameCount()));
+	if (options.fromTimestamp != 0)
+	{
+		first = std::max(first, reader.FindByTimestamp(options.fromTimestamp));
+	}
+	const size_t end = static_cast<size_t>(std::min<uint64_t>(options.last, reader.FrameCount() - 1) + 1);
+
+	if (options.infoOnly)
+	{
+		for (size_t i = first; i < end; i += static_cast<size_t>(options.every))
+		{
+			PrintFrameInfo(reader, i);
+		}
+		return 0;
+	}
+
+	std::error_code ec;
+	fs::create_directories(options.outFolder, ec);
+
+	Mono8Converter converter(SPINNAKER_COLOR_PROCESSING_ALGORITHM_HQ_LINEAR);
+	size_t exported = 0;
+	int result = 0;
+	for (size_t i = first; i < end; i += static_cast<size_t>(options.every))
+	{
+		const SessionFrameHeader &header = reader.FrameHeader(i);
+		std::ostringstream filename;
+		filename << options.outFolder << "/" << std::setw(6) << std::setfill('0') << header.frameIndex << ".png";
+
+		// 数据直接来自映射区，转换后写出
+		Mono8Frame mono = converter.Convert(reader.ToImage(i));
+		if (cv::imwrite(filename.str(), mono.mat))
+		{
+			exported++;
+		}
+		else
+		{
+			cout << "Failed to save: " << filename.str() << endl;
+			result = -1;
+		}
+	}
+
+	cout << "Exported " << exported << " frames to " << options.outFolder << endl;
+	return result;
+}
+
+int main(int argc, char **argv)
+{
+	ExportOptions options;
+	bool parsed = false;
+	try
+	{
+		parsed = ParseOptions(argc, argv, options);
+	}
+	catch (std::exception &e)
+	{
+		// std::stoull 等解析失败
+		cout << "Invalid option value: " << e.what() << endl;
+	}
+	if (!parsed)
+	{
+		PrintUsage();
+		return -1;
+	}
+
+	int result = 0;
+	try
+	{
+		result = RunExport(options);
+	}
+	catch (Spinnaker::Exception &e)
+	{
+		cout << "Error: " << e.what() << endl;
+		result = -1;
+	}
+	catch (cv::Exception &e)
+	{
+		cout << "OpenCV error: " << e.what() << endl;
+		result = -1;
+	}
+	return result;
+}
@@ -0,0 +1,527 @@
+﻿#include "SessionFile.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#if defined(WIN32) || defined(WIN64) || defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace Spinnaker;
+using namespace std;
+
+namespace
+{
+const char kFileMagic[8] = {'S', 'P', 'N', 'R', 'A', 'W', '0', '1'};
+const char kFooterMagic[8] = {'S', 'P', 'N', 'I', 'D', 'X', '0', '1'};
+const uint32_t kFrameMagic = 0x454D5246; // "FRME"
+
+size_t RoundUp(size_t value, size_t alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+} // namespace
+
+//=========================== SessionWriter =================================
+
+SessionWriter::SessionWriter(size_t chunkBytes, size_t chunkCount)
+	: m_chunkBytes(RoundUp(std::max(chunkBytes, kSessionAlignment), kSessionAlignment))
+{
+	// 至少两块：一块填充、一块写盘
+	for (size_t i = 0; i < std::max<size_t>(2, chunkCount); i++)
+	{
+		m_free.emplace_back(new Chunk());
+	}
+}
+
+SessionWriter::~SessionWriter()
+{
+	Close();
+}
+
+bool SessionWriter::Open(const std::string &path, const std::string &deviceId)
+{
+	Close();
+
+	m_file = std::fopen(path.c_str(), "wb");
+	if (m_file == nullptr)
+	{
+		cout << "Failed to create session file: " << path << endl;
+		return false;
+	}
+	// 每次写入都是整块，不需要 stdio 再缓冲一次
+	std::setvbuf(m_file, nullptr, _IONBF, 0);
+
+	// 块在打开时才分配，不录制时不占内存
+	for (auto &chunk : m_free)
+	{
+		if (!chunk->data)
+		{
+			chunk->data.reset(new uint8_t[m_chunkBytes]);
+		}
+		chunk->used = 0;
+	}
+
+	m_path = path;
+	m_startTime = std::chrono::steady_clock::now();
+	m_offset = 0;
+	m_index.clear();
+	m_frameCount = 0;
+	m_dropped = 0;
+	m_bytesWritten = 0;
+	m_stopping = false;
+	m_writeFailed = false;
+	TakeFreeChunk();
+
+	// 文件头放在第一块的开头
+	SessionFileHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, kFileMagic, sizeof(header.magic));
+	header.version = 1;
+	header.headerSize = static_cast<uint32_t>(sizeof(header));
+	header.createdNs = static_cast<uint64_t>(
+		std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count());
+	strncpy(header.deviceId, deviceId.c_str(), sizeof(header.deviceId) - 1);
+	memcpy(m_current->data.get(), &header, sizeof(header));
+	m_current->used = sizeof(header);
+	m_offset = sizeof(header);
+
+	m_writer = std::thread(&SessionWriter::WriterLoop, this);
+	m_open.store(true, std::memory_order_release);
+	return true;
+}
+
+void SessionWriter::Close()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_appendMutex);
+		if (!m_open.load(std::memory_order_acquire))
+		{
+			return;
+		}
+		m_open.store(false, std::memory_order_release);
+		SubmitCurrent();
+	}
+
+	// 等后台线程写完所有已满的块
+	{
+		std::lock_guard<std::mutex> lock(m_queueMutex);
+		m_stopping = true;
+	}
+	m_queueChanged.notify_all();
+	m_writer.join();
+
+	// 索引和尾部
+	SessionFooter footer;
+	memcpy(footer.magic, kFooterMagic, sizeof(footer.magic));
+	footer.indexOffset = m_offset;
+	footer.frameCount = m_index.size();
+	bool ok = !m_writeFailed;
+	if (ok && !m_index.empty())
+	{
+		ok = std::fwrite(m_index.data(), sizeof(SessionIndexEntry), m_index.size(), m_file) == m_index.size();
+	}
+	ok = ok && std::fwrite(&footer, sizeof(footer), 1, m_file) == 1;
+	ok = (std::fclose(m_file) == 0) && ok;
+	m_file = nullptr;
+
+	if (!ok)
+	{
+		cout << "Failed to finish session file: " << m_path << endl;
+	}
+	cout << "Session closed: " << m_path << " (" << m_index.size() << " frames, "
+		 << m_bytesWritten / (1024 * 1024) << " MB, dropped " << m_dropped << ")" << endl;
+
+	// 释放块内存
+	for (auto &chunk : m_free)
+	{
+		chunk->data.reset();
+		chunk->used = 0;
+	}
+	m_index.clear();
+	m_index.shrink_to_fit();
+}
+
+bool SessionWriter::Append(const Frame &frame, const SessionFrameInfo &info)
+{
+	if (!m_open.load(std::memory_order_acquire))
+	{
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(m_appendMutex);
+	if (!m_open.load(std::memory_order_relaxed))
+	{
+		return false;
+	}
+
+	const ImagePtr &image = frame.image;
+	const size_t width = image->GetWidth();
+	const size_t height = image->GetHeight();
+	const size_t bitsPerPixel = image->GetBitsPerPixel();
+	const size_t rowBytes = (width * bitsPerPixel + 7) / 8;
+	const size_t dataSize = rowBytes * height;
+	const size_t recordSize = RoundUp(sizeof(SessionFrameHeader) + dataSize, kSessionAlignment);
+
+	// 当前块放不下就交给后台线程；没有空闲块说明磁盘跟不上，丢弃这一帧
+	if (m_current && m_current->used + recordSize > m_chunkBytes)
+	{
+		SubmitCurrent();
+	}
+	if (recordSize > m_chunkBytes || (!m_current && !TakeFreeChunk()))
+	{
+		m_dropped.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+
+	uint8_t *pRecord = m_current->data.get() + m_current->used;
+
+	SessionFrameHeader header;
+	memset(&header, 0, sizeof(header));
+	header.magic = kFrameMagic;
+	header.headerSize = static_cast<uint32_t>(sizeof(header));
+	header.frameIndex = m_index.size();
+	header.frameId = frame.frameId;
+	header.timestamp = frame.timestamp;
+	header.hostTimeNs = static_cast<uint64_t>(std::max<int64_t>(
+		0, std::chrono::duration_cast<std::chrono::nanoseconds>(frame.hostTime - m_startTime).count()));
+	header.exposureUs = info.exposureUs;
+	header.gainDb = info.gainDb;
+	header.pixelFormat = static_cast<uint32_t>(image->GetPixelFormat());
+	header.imageStatus = static_cast<uint32_t>(image->GetImageStatus());
+	header.width = static_cast<uint32_t>(width);
+	header.height = static_cast<uint32_t>(height);
+	header.offsetX = static_cast<uint32_t>(image->GetXOffset());
+	header.offsetY = static_cast<uint32_t>(image->GetYOffset());
+	header.bitsPerPixel = static_cast<uint32_t>(bitsPerPixel);
+	header.dataSize = dataSize;
+	header.recordSize = recordSize;
+	memcpy(pRecord, &header, sizeof(header));
+
+	// 像素数据去掉行填充后紧密排列
+	uint8_t *pDest = pRecord + sizeof(header);
+	const uint8_t *pSrc = static_cast<const uint8_t *>(image->GetData());
+	const size_t stride = image->GetStride() != 0 ? image->GetStride() : rowBytes;
+	if (stride == rowBytes)
+	{
+		memcpy(pDest, pSrc, dataSize);
+	}
+	else
+	{
+		for (size_t y = 0; y < height; y++)
+		{
+			memcpy(pDest + y * rowBytes, pSrc + y * stride, rowBytes);
+		}
+	}
+	memset(pDest + dataSize, 0, recordSize - sizeof(header) - dataSize);
+
+	m_index.push_back(SessionIndexEntry{m_offset, header.frameIndex, header.frameId, header.timestamp});
+	m_current->used += recordSize;
+	m_offset += recordSize;
+	m_frameCount.fetch_add(1, std::memory_order_relaxed);
+	return true;
+}
+
+bool SessionWriter::TakeFreeChunk()
+{
+	std::lock_guard<std::mutex> lock(m_queueMutex);
+	if (m_free.empty())
+	{
+		return false;
+	}
+	m_current = std::move(m_free.front());
+	m_free.pop_front();
+	m_current->used = 0;
+	return true;
+}
+
+void SessionWriter::SubmitCurrent()
+{
+	if (!m_current)
+	{
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(m_queueMutex);
+		if (m_current->used > 0)
+		{
+			m_full.push_back(std::move(m_current));
+		}
+		else
+		{
+			m_free.push_back(std::move(m_current));
+		}
+	}
+	m_queueChanged.notify_all();
+}
+
+void SessionWriter::WriterLoop()
+{
+	while (true)
+	{
+		std::unique_ptr<Chunk> chunk;
+		{
+			std::unique_lock<std::mutex> lock(m_queueMutex);
+			m_queueChanged.wait(lock, [this] { return !m_full.empty() || m_stopping; });
+			if (m_full.empty())
+			{
+				return;
+			}
+			chunk = std::move(m_full.front());
+			m_full.pop_front();
+		}
+
+		// 整块顺序写入
+		if (!m_writeFailed)
+		{
+			if (std::fwrite(chunk->data.get(), 1, chunk->used, m_file) != chunk->used)
+			{
+				cout << "Failed to write session file: " << m_path << endl;
+				m_writeFailed = true;
+			}
+			else
+			{
+				m_bytesWritten.fetch_add(chunk->used, std::memory_order_relaxed);
+			}
+		}
+
+		chunk->used = 0;
+		{
+			std::lock_guard<std::mutex> lock(m_queueMutex);
+			m_free.push_back(std::move(chunk));
+		}
+	}
+}
+
+//=========================== SessionReader =================================
+
+SessionReader::~SessionReader()
+{
+	Close();
+}
+
+bool SessionReader::Open(const std::string &path)
+{
+	Close();
+
+#if defined(WIN32) || defined(WIN64) || defined(_WIN32)
+	HANDLE hFile = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+							   FILE_FLAG_RANDOM_ACCESS, nullptr);
+	if (hFile == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+	m_hFile = hFile;
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(hFile, &size) || size.QuadPart == 0)
+	{
+		Close();
+		return false;
+	}
+	m_hMapping = CreateFileMappingA(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (m_hMapping == nullptr)
+	{
+		Close();
+		return false;
+	}
+	m_pData = static_cast<const uint8_t *>(MapViewOfFile(m_hMapping, FILE_MAP_READ, 0, 0, 0));
+	m_size = static_cast<size_t>(size.QuadPart);
+#else
+	const int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+	{
+		return false;
+	}
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0)
+	{
+		close(fd);
+		return false;
+	}
+	void *pMapped = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+	close(fd); // 映射建立后即可关闭文件描述符
+	if (pMapped == MAP_FAILED)
+	{
+		return false;
+	}
+	m_pData = static_cast<const uint8_t *>(pMapped);
+	m_size = static_cast<size_t>(st.st_size);
+#endif
+	if (m_pData == nullptr || m_size < sizeof(SessionFileHeader) ||
+		memcmp(Header().magic, kFileMagic, sizeof(kFileMagic)) != 0)
+	{
+		cout << "Not a session file: " << path << endl;
+		Close();
+		return false;
+	}
+
+	m_hasIndex = ReadIndex();
+	if (!m_hasIndex)
+	{
+		// 没有正常关闭：顺序扫描记录重建索引
+		ScanRecords();
+	}
+
+	m_timestampsSorted = std::is_sorted(m_index.begin(), m_index.end(),
+										[](const SessionIndexEntry &a, const SessionIndexEntry &b) { return a.timestamp < b.timestamp; });
+	if (!m_timestampsSorted)
+	{
+		cout << "Session timestamps restart (camera reconnected during recording), timestamp lookups scan sequentially" << endl;
+	}
+	return true;
+}
+
+void SessionReader::Close()
+{
+#if defined(WIN32) || defined(WIN64) || defined(_WIN32)
+	if (m_pData != nullptr)
+	{
+		UnmapViewOfFile(m_pData);
+	}
+	if (m_hMapping != nullptr)
+	{
+		CloseHandle(m_hMapping);
+	}
+	if (m_hFile != nullptr)
+	{
+		CloseHandle(m_hFile);
+	}
+	m_hMapping = nullptr;
+	m_hFile = nullptr;
+#else
+	if (m_pData != nullptr)
+	{
+		munmap(const_cast<uint8_t *>(m_pData), m_size);
+	}
+#endif
+	m_pData = nullptr;
+	m_size = 0;
+	m_hasIndex = false;
+	m_timestampsSorted = true;
+	m_index.clear();
+}
+
+bool SessionReader::ReadIndex()
+{
+	if (m_size < sizeof(SessionFileHeader) + sizeof(SessionFooter))
+	{
+		return false;
+	}
+	SessionFooter footer;
+	memcpy(&footer, m_pData + m_size - sizeof(footer), sizeof(footer));
+	if (memcmp(footer.magic, kFooterMagic, sizeof(kFooterMagic)) != 0 || footer.indexOffset > m_size ||
+		footer.frameCount > (m_size - footer.indexOffset) / sizeof(SessionIndexEntry) ||
+		footer.indexOffset + footer.frameCount * sizeof(SessionIndexEntry) + sizeof(footer) != m_size)
+	{
+		return false;
+	}
+	m_index.resize(static_cast<size_t>(footer.frameCount));
+	if (!m_index.empty())
+	{
+		memcpy(m_index.data(), m_pData + footer.indexOffset, m_index.size() * sizeof(SessionIndexEntry));
+	}
+
+	// 索引中的偏移和记录头都不可信：任何一条越界就放弃索引，改为扫描记录
+	for (const SessionIndexEntry &entry : m_index)
+	{
+		SessionFrameHeader header;
+		if (entry.offset > footer.indexOffset || !ValidRecord(entry.offset, header) ||
+			header.recordSize > footer.indexOffset - entry.offset)
+		{
+			cout << "Warning: session index entry at offset " << entry.offset << " is invalid, scanning records..."
+				 << endl;
+			m_index.clear();
+			return false;
+		}
+	}
+	return true;
+}
+
+bool SessionReader::ValidRecord(uint64_t offset, SessionFrameHeader &header) const
+{
+	if (offset < sizeof(SessionFileHeader) || offset > m_size || m_size - offset < sizeof(SessionFrameHeader))
+	{
+		return false;
+	}
+	memcpy(&header, m_pData + offset, sizeof(header));
+	if (header.magic != kFrameMagic || header.headerSize < sizeof(header) || header.recordSize > m_size - offset ||
+		header.dataSize > header.recordSize || header.headerSize > header.recordSize - header.dataSize)
+	{
+		return false;
+	}
+	// ToImage() 按宽高和位深读取像素，不能超过记录中的数据
+	const uint64_t pixels = static_cast<uint64_t>(header.width) * header.height;
+	return header.bitsPerPixel == 0 || pixels <= header.dataSize * 8 / header.bitsPerPixel;
+}
+
+void SessionReader::ScanRecords()
+{
+	size_t offset = sizeof(SessionFileHeader);
+	while (offset + sizeof(SessionFrameHeader) <= m_size)
+	{
+		SessionFrameHeader header;
+		if (!ValidRecord(offset, header))
+		{
+			break; // 最后一块可能只写了一部分
+		}
+		m_index.push_back(SessionIndexEntry{offset, header.frameIndex, header.frameId, header.timestamp});
+		offset += static_cast<size_t>(header.recordSize);
+	}
+}
+
+const SessionFrameHeader &SessionReader::FrameHeader(size_t index) const
+{
+	return *reinterpret_cast<const SessionFrameHeader *>(m_pData + m_index[index].offset);
+}
+
+const uint8_t *SessionReader::FrameData(size_t index) const
+{
+	return m_pData + m_index[index].offset + FrameHeader(index).headerSize;
+}
+
+size_t SessionReader::FindByTimestamp(uint64_t timestamp) const
+{
+	if (!m_timestampsSorted)
+	{
+		auto it = std::find_if(m_index.begin(), m_index.end(),
+							   [timestamp](const SessionIndexEntry &entry) { return entry.timestamp >= timestamp; });
+		return static_cast<size_t>(it - m_index.begin());
+	}
+	auto it = std::lower_bound(m_index.begin(), m_index.end(), timestamp,
+							   [](const SessionIndexEntry &entry, uint64_t value) { return entry.timestamp < value; });
+	return static_cast<size_t>(it - m_index.begin());
+}
+
+void SessionReader::Prefetch(size_t index) const
+{
+	if (index >= m_index.size())
+	{
+		return;
+	}
+	// 按页对齐后交给系统预读
+	const size_t begin = static_cast<size_t>(m_index[index].offset) / kSessionAlignment * kSessionAlignment;
+	const size_t length = std::min(m_size - begin, static_cast<size_t>(FrameHeader(index).recordSize) + kSessionAlignment);
+#if defined(WIN32) || defined(WIN64) || defined(_WIN32)
+	WIN32_MEMORY_RANGE_ENTRY range;
+	range.VirtualAddress = const_cast<uint8_t *>(m_pData + begin);
+	range.NumberOfBytes = length;
+	PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#else
+	madvise(const_cast<uint8_t *>(m_pData + begin), length, MADV_WILLNEED);
+#endif
+}
+
+ImagePtr SessionReader::ToImage(size_t index) const
+{
+	const SessionFrameHeader &header = FrameHeader(index);
+	return Image::Create(header.width, header.height, header.offsetX, header.offsetY,
+						 static_cast<PixelFormatEnums>(header.pixelFormat), const_cast<uint8_t *>(FrameData(index)));
+}
@@ -0,0 +1,199 @@
+﻿#pragma once
+
+#include "Spinnaker.h"
+#include "FrameRing.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// 原始采集会话文件（.spr）：只追加写入的未转换帧 + 每帧元数据 + 文件末尾的索引。
+//
+//   [SessionFileHeader, 4096 字节]
+//   [SessionFrameHeader + 像素数据]   每条记录按 4096 字节对齐，可重复
+//   ...
+//   [SessionIndexEntry x frameCount]
+//   [SessionFooter]
+//
+// 所有字段为小端、定长，读取端直接 mmap 后按偏移访问。
+// 程序异常退出时没有索引和尾部，读取端会顺序扫描记录重建索引。
+
+const size_t kSessionAlignment = 4096;
+
+struct SessionFileHeader
+{
+	char magic[8];		   // "SPNRAW01"
+	uint32_t version;	   // 1
+	uint32_t headerSize;   // kSessionAlignment
+	uint64_t createdNs;	   // 会话开始时间（system_clock，自 1970 起的 ns）
+	char deviceId[64];	   // 相机 DeviceID 或帧来源名称，以 0 结尾
+	uint8_t reserved[4008];
+};
+
+struct SessionFrameHeader
+{
+	uint32_t magic;		   // 'FRME'
+	uint32_t headerSize;   // sizeof(SessionFrameHeader)
+	uint64_t frameIndex;   // 会话内从 0 开始的连续编号
+	uint64_t frameId;	   // 相机 FrameID
+	uint64_t timestamp;	   // 相机时间戳，ns
+	uint64_t hostTimeNs;   // 主机到达时间，相对会话开始
+	double exposureUs;	   // 曝光时间，未知时为 -1
+	double gainDb;		   // 增益，未知时为 -1
+	uint32_t pixelFormat;  // Spinnaker::PixelFormatEnums
+	uint32_t imageStatus;  // Spinnaker::ImageStatus
+	uint32_t width;
+	uint32_t height;
+	uint32_t offsetX;
+	uint32_t offsetY;
+	uint32_t bitsPerPixel;
+	uint32_t reserved;
+	uint64_t dataSize;	   // 像素数据字节数（紧密排列，无行填充）
+	uint64_t recordSize;   // 本条记录总长度（含头和对齐填充），下一条记录从这里开始
+};
+
+struct SessionIndexEntry
+{
+	uint64_t offset;	   // 记录在文件中的偏移
+	uint64_t frameIndex;
+	uint64_t frameId;
+	uint64_t timestamp;
+};
+
+struct SessionFooter
+{
+	char magic[8];		   // "SPNIDX01"
+	uint64_t indexOffset;
+	uint64_t frameCount;
+};
+
+static_assert(sizeof(SessionFileHeader) == kSessionAlignment, "SessionFileHeader must fill one page");
+static_assert(sizeof(SessionFrameHeader) == 104, "SessionFrameHeader layout changed");
+static_assert(sizeof(SessionIndexEntry) == 32, "SessionIndexEntry layout changed");
+static_assert(sizeof(SessionFooter) == 24, "SessionFooter layout changed");
+
+// 写入时随帧附带的、图像本身不包含的元数据
+struct SessionFrameInfo
+{
+	double exposureUs = -1.0;
+	double gainDb = -1.0;
+};
+
+// 会话写入：Append() 只把记录复制进当前的大块缓冲（默认 64 MB），
+// 写满后交给后台线程整块顺序写入，调用方（抓图线程）不做任何磁盘 I/O。
+// 后台来不及写、所有块都在排队时新帧被丢弃并计数，不会阻塞采集。
+class SessionWriter
+{
+public:
+	SessionWriter(size_t chunkBytes = size_t(64) << 20, size_t chunkCount = 4);
+	~SessionWriter();
+
+	SessionWriter(const SessionWriter &) = delete;
+	SessionWriter &operator=(const SessionWriter &) = delete;
+
+	bool Open(const std::string &path, const std::string &deviceId);
+	// 写完剩余数据、索引和尾部后关闭
+	void Close();
+	bool IsOpen() const { return m_open.load(std::memory_order_acquire); }
+
+	// 未打开时直接返回 false；任意线程调用（内部加锁，正常只有抓图线程调用）
+	bool Append(const Frame &frame, const SessionFrameInfo &info);
+
+	const std::string &Path() const { return m_path; }
+	uint64_t FrameCount() const { return m_frameCount.load(std::memory_order_relaxed); }
+	uint64_t Dropped() const { return m_dropped.load(std::memory_order_relaxed); }
+	uint64_t BytesWritten() const { return m_bytesWritten.load(std::memory_order_relaxed); }
+
+private:
+	struct Chunk
+	{
+		std::unique_ptr<uint8_t[]> data;
+		size_t used = 0;
+	};
+
+	bool TakeFreeChunk();
+	void SubmitCurrent();
+	void WriterLoop();
+
+	size_t m_chunkBytes;
+	std::string m_path;
+	std::FILE *m_file = nullptr;
+	std::atomic<bool> m_open{false};
+	std::chrono::steady_clock::time_point m_startTime;
+
+	// 生产者状态，受 m_appendMutex 保护
+	std::mutex m_appendMutex;
+	std::unique_ptr<Chunk> m_current;
+	uint64_t m_offset = 0; // 下一条记录的文件偏移
+	std::vector<SessionIndexEntry> m_index;
+
+	// 块队列，受 m_queueMutex 保护
+	std::mutex m_queueMutex;
+	std::condition_variable m_queueChanged;
+	std::deque<std::unique_ptr<Chunk>> m_free;
+	std::deque<std::unique_ptr<Chunk>> m_full;
+	bool m_stopping = false;
+	bool m_writeFailed = false;
+	std::thread m_writer;
+
+	std::atomic<uint64_t> m_frameCount{0};
+	std::atomic<uint64_t> m_dropped{0};
+	std::atomic<uint64_t> m_bytesWritten{0};
+};
+
+// 会话读取：整个文件以只读方式映射到内存，按帧号或时间戳随机访问，不复制像素数据。
+class SessionReader
+{
+public:
+	SessionReader() = default;
+	~SessionReader();
+
+	SessionReader(const SessionReader &) = delete;
+	SessionReader &operator=(const SessionReader &) = delete;
+
+	bool Open(const std::string &path);
+	void Close();
+
+	const SessionFileHeader &Header() const { return *reinterpret_cast<const SessionFileHeader *>(m_pData); }
+	size_t FrameCount() const { return m_index.size(); }
+	// 索引来自文件尾部为 true，顺序扫描重建为 false
+	bool HasIndex() const { return m_hasIndex; }
+
+	const SessionFrameHeader &FrameHeader(size_t index) const;
+	const uint8_t *FrameData(size_t index) const;
+
+	// 时间戳不早于 timestamp 的第一帧，没有时返回 FrameCount()。
+	// 录制跨过相机重连时时间戳会重新计数，此时不能二分查找，改为顺序查找
+	size_t FindByTimestamp(uint64_t timestamp) const;
+	// 各帧时间戳是否单调不减（打开时检查）
+	bool TimestampsSorted() const { return m_timestampsSorted; }
+
+	// 提示系统预读某一帧（不阻塞），顺序处理时提前一帧调用即可隐藏磁盘延迟
+	void Prefetch(size_t index) const;
+
+	// 包装为 Spinnaker 图像（数据仍指向映射区，Close() 之前有效）
+	Spinnaker::ImagePtr ToImage(size_t index) const;
+
+private:
+	bool ReadIndex();
+	void ScanRecords();
+	// offset 处是否是一条完整落在映射区内的记录（头、像素数据都不越界），是则复制出头
+	bool ValidRecord(uint64_t offset, SessionFrameHeader &header) const;
+
+	const uint8_t *m_pData = nullptr;
+	size_t m_size = 0;
+	bool m_hasIndex = false;
+	bool m_timestampsSorted = true;
+	std::vector<SessionIndexEntry> m_index;
+#if defined(WIN32) || defined(WIN64) || defined(_WIN32)
+	void *m_hFile = nullptr;
+	void *m_hMapping = nullptr;
+#endif
+};
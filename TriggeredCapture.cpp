@@ -0,0 +1,151 @@
+﻿#include "TriggeredCapture.h"
+#include "FrameHistory.h"
+#include "FrameMetadata.h"
+#include <chrono>
+#include <iostream>
+
+using namespace Spinnaker;
+using namespace std;
+
+namespace
+{
+double MillisecondsSince(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+} // namespace
+
+TriggeredCapture::TriggeredCapture(CameraFeatures &features, const std::string &triggerSelector,
+								   const std::string &triggerSource)
+	: m_features(features), m_triggerSelector(triggerSelector), m_triggerSource(triggerSource)
+{
+}
+
+int TriggeredCapture::Prepare(CameraPtr pCam, const RoiPlan &capturePlan, const RoiTarget &previewTarget)
+{
+	int result = 0;
+	m_capturePlan = capturePlan;
+	m_previewFrameRate = previewTarget.frameRate;
+
+	// TriggerSelector / TriggerSource 只在 TriggerMode 为 Off 时可写
+	if (!m_features.Set(FEATURE_TRIGGER_MODE, "Off") || !m_features.Set(FEATURE_TRIGGER_SELECTOR, m_triggerSelector) ||
+		!m_features.Set(FEATURE_TRIGGER_SOURCE, m_triggerSource))
+	{
+		cout << "Error: cannot set trigger " << m_triggerSelector << " to " << m_triggerSource
+			 << ", full-resolution capture disabled." << endl;
+		return -1;
+	}
+
+	cout << "Preview configuration:" << endl;
+	result = ConfigureRoi(pCam, previewTarget, &m_previewPlan);
+	m_prepared = result == 0;
+	if (m_prepared)
+	{
+		cout << "Capture at " << m_capturePlan.width << "x" << m_capturePlan.height << " " << m_capturePlan.pixelFormat
+			 << " on " << m_triggerSelector << " / " << m_triggerSource << ", preview " << m_previewPlan.width << "x"
+			 << m_previewPlan.height << " bin " << m_previewPlan.binning << " dec " << m_previewPlan.decimation << endl;
+	}
+	return result;
+}
+
+bool TriggeredCapture::Capture(FrameSource &source, unsigned chunkFields, uint64_t timeoutMs, Frame &frame,
+							   CaptureTiming &timing)
+{
+	timing = CaptureTiming();
+	bool captured = false;
+	bool disconnected = false;
+
+	auto phaseStart = std::chrono::steady_clock::now();
+	try
+	{
+		// 采集停止时才能改 ROI / 合并 / 像素格式；触发模式下不需要帧率限制
+		const bool switched = source.Restart([this]() {
+			return ApplyRoiPlan(m_features, m_capturePlan, 0.0) == 0 && m_features.Set(FEATURE_TRIGGER_MODE, "On");
+		});
+		timing.switchMs = MillisecondsSince(phaseStart);
+
+		phaseStart = std::chrono::steady_clock::now();
+		if (!switched)
+		{
+			cout << "Error: cannot switch to capture configuration" << endl;
+		}
+		else if (!m_features.Execute(FEATURE_TRIGGER_SOFTWARE))
+		{
+			cout << "Error: TriggerSoftware not executable" << endl;
+		}
+		else
+		{
+			Frame grabbed;
+			std::string message;
+			switch (source.Grab(timeoutMs, grabbed, message))
+			{
+			case GRAB_OK:
+				// 复制出来再归还缓冲，切回预览时相机缓冲会作废
+				frame = grabbed;
+				if (chunkFields != 0)
+				{
+					ReadChunkData(grabbed.image, chunkFields, frame);
+				}
+				frame.image = Image::Create();
+				FrameHistory::CopyImage(grabbed.image, frame.image);
+				source.Release(grabbed.image);
+				captured = true;
+				break;
+			case GRAB_INCOMPLETE:
+				cout << "Capture incomplete: " << message << endl;
+				source.Release(grabbed.image);
+				break;
+			case GRAB_TIMEOUT:
+				cout << "Capture timed out after " << timeoutMs << " ms" << endl;
+				break;
+			case GRAB_DISCONNECTED:
+				cout << "Capture interrupted: " << message << endl;
+				disconnected = true;
+				break;
+			default:
+				cout << "Capture error: " << message << endl;
+			}
+		}
+		timing.triggerMs = MillisecondsSince(phaseStart);
+	}
+	catch (Spinnaker::Exception &e)
+	{
+		cout << "Error: " << e.what() << endl;
+	}
+
+	// 切回预览：先关触发，再写回预览配置和帧率限制。
+	// 相机已断开时不切换，重连来源会按缓存的预览配置恢复
+	phaseStart = std::chrono::steady_clock::now();
+	if (!disconnected)
+	{
+		try
+		{
+			const bool restored = source.Restart([this]() {
+				const bool triggerOff = m_features.Set(FEATURE_TRIGGER_MODE, "Off");
+				return ApplyRoiPlan(m_features, m_previewPlan, m_previewFrameRate) == 0 && triggerOff;
+			});
+			if (!restored)
+			{
+				cout << "Error: cannot restore preview configuration" << endl;
+			}
+		}
+		catch (Spinnaker::Exception &e)
+		{
+			cout << "Error: " << e.what() << endl;
+		}
+	}
+	timing.restoreMs = MillisecondsSince(phaseStart);
+
+	m_switchLatency.Record(static_cast<uint64_t>(timing.switchMs * 1e6));
+	m_triggerLatency.Record(static_cast<uint64_t>(timing.triggerMs * 1e6));
+	m_restoreLatency.Record(static_cast<uint64_t>(timing.restoreMs * 1e6));
+	if (captured)
+	{
+		m_captures++;
+	}
+	else
+	{
+		m_failures++;
+	}
+	return captured;
+}
@@ -0,0 +1,68 @@
+﻿#pragma once
+
+#include "CameraFeatures.h"
+#include "FrameRing.h"
+#include "FrameSource.h"
+#include "LatencyHistogram.h"
+#include "RoiPlanner.h"
+#include "Spinnaker.h"
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// 一次抓拍各阶段的耗时（ms）
+struct CaptureTiming
+{
+	double switchMs = 0.0;	// 停止预览、写入全分辨率配置并重新开始采集
+	double triggerMs = 0.0; // TriggerSoftware 到取到这一帧
+	double restoreMs = 0.0; // 切回预览配置并重新开始采集
+};
+
+// 预览 / 抓拍切换：平时按预览配置（小视场或合并 / 抽取、低帧率）连续采集，抓拍时停止采集，
+// 写入全分辨率配置、打开软件触发取一帧，再切回预览。
+// 两套配置都在 Prepare() 中一次规划好，切换时不再探测，只通过 CameraFeatures 句柄写与当前值不同的节点；
+// 触发选择器和触发源也在 Prepare() 中设好，切换时只改 TriggerMode。
+// 停止 / 重新开始采集由 FrameSource::Restart() 完成，这里不直接操作相机，
+// 重连来源会把切换与重连状态机串行起来。
+class TriggeredCapture
+{
+public:
+	TriggeredCapture(CameraFeatures &features, const std::string &triggerSelector, const std::string &triggerSource);
+
+	TriggeredCapture(const TriggeredCapture &) = delete;
+	TriggeredCapture &operator=(const TriggeredCapture &) = delete;
+
+	// 相机已按全分辨率配置好（capturePlan 为 ConfigureRoi() 返回的配置）、开始采集之前调用：
+	// 设置触发选择器 / 触发源并关闭触发，再按 previewTarget 规划并写入预览配置
+	int Prepare(Spinnaker::CameraPtr pCam, const RoiPlan &capturePlan, const RoiTarget &previewTarget);
+	bool IsPrepared() const { return m_prepared; }
+
+	// 抓图线程停止、来源交付的帧都已归还之后调用：取一帧全分辨率图像（深拷贝，相机缓冲已归还），
+	// chunkFields 非 0 时解析 chunk。除相机断开（交给重连来源恢复）外，无论成功与否都会切回预览并重新开始采集
+	bool Capture(FrameSource &source, unsigned chunkFields, uint64_t timeoutMs, Frame &frame, CaptureTiming &timing);
+
+	const RoiPlan &PreviewPlan() const { return m_previewPlan; }
+	const RoiPlan &CapturePlan() const { return m_capturePlan; }
+
+	uint64_t Captures() const { return m_captures.load(std::memory_order_relaxed); }
+	uint64_t Failures() const { return m_failures.load(std::memory_order_relaxed); }
+	// 各阶段耗时（ns）
+	const LatencyHistogram &SwitchLatency() const { return m_switchLatency; }
+	const LatencyHistogram &TriggerLatency() const { return m_triggerLatency; }
+	const LatencyHistogram &RestoreLatency() const { return m_restoreLatency; }
+
+private:
+	CameraFeatures &m_features;
+	std::string m_triggerSelector;
+	std::string m_triggerSource;
+	RoiPlan m_capturePlan;
+	RoiPlan m_previewPlan;
+	double m_previewFrameRate = 0.0;
+	bool m_prepared = false;
+
+	std::atomic<uint64_t> m_captures{0};
+	std::atomic<uint64_t> m_failures{0};
+	LatencyHistogram m_switchLatency;
+	LatencyHistogram m_triggerLatency;
+	LatencyHistogram m_restoreLatency;
+};
@@ -0,0 +1,246 @@
+﻿#include "VideoRecorder.h"
+#include "FrameHistory.h"
+#include <algorithm>
+#include <iostream>
+
+using namespace Spinnaker;
+using namespace std;
+
+VideoRecorder::~VideoRecorder()
+{
+	Stop();
+}
+
+bool VideoRecorder::Start(const std::string &basePath, const VideoConfig &config, float frameRate)
+{
+	if (IsRecording() || m_encoder.joinable())
+	{
+		return false;
+	}
+
+	m_config = config;
+	m_config.queueCapacity = std::max<size_t>(1, m_config.queueCapacity);
+	m_frameRate = frameRate > 0.0f ? frameRate : 30.0f;
+	m_basePath = basePath;
+	m_slots.clear();
+	m_free.clear();
+	m_queue.clear();
+	m_stopping = false;
+	m_submitting = false;
+	m_videoOpen = false;
+	m_encodeUs = 0;
+	m_encoded = 0;
+	m_dropped = 0;
+	m_failed = false;
+	m_processor.SetColorProcessing(SPINNAKER_COLOR_PROCESSING_ALGORITHM_HQ_LINEAR);
+	m_startTime = std::chrono::steady_clock::now();
+
+	m_encoder = std::thread(&VideoRecorder::EncoderLoop, this);
+	m_recording.store(true, std::memory_order_release);
+	return true;
+}
+
+void VideoRecorder::Stop()
+{
+	if (!m_encoder.joinable())
+	{
+		return;
+	}
+
+	m_recording.store(false, std::memory_order_release);
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stopping = true;
+	}
+	m_queued.notify_all();
+	m_encoder.join();
+
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_startTime).count();
+	cout << "Video " << m_basePath << ": " << Encoded() << " frames encoded in " << seconds << " s";
+	if (Encoded() > 0)
+	{
+		cout << " (avg encode " << m_encodeUs / static_cast<int64_t>(Encoded()) / 1000.0 << " ms)";
+	}
+	cout << ", dropped " << Dropped() << (Failed() ? ", stopped on error" : "") << endl;
+
+	// 释放帧槽占用的内存
+	m_slots.clear();
+	m_free.clear();
+}
+
+bool VideoRecorder::Submit(const Frame &frame)
+{
+	if (!IsRecording())
+	{
+		return false;
+	}
+
+	size_t index;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (m_stopping)
+		{
+			return false;
+		}
+		if (m_slots.empty())
+		{
+			for (size_t i = 0; i < m_config.queueCapacity; i++)
+			{
+				m_slots.push_back(Image::Create());
+				m_free.push_back(i);
+			}
+		}
+
+		if (!m_free.empty())
+		{
+			index = m_free.back();
+			m_free.pop_back();
+		}
+		else if (m_config.policy == VIDEO_DROP_OLDEST && !m_queue.empty())
+		{
+			// 覆盖还没开始编码的最旧一帧
+			index = m_queue.front();
+			m_queue.pop_front();
+			m_dropped++;
+		}
+		else
+		{
+			m_dropped++;
+			return false;
+		}
+		m_submitting = true;
+	}
+
+	// 复制在锁外进行，编码线程此时仍可取走其他帧
+	FrameHistory::CopyImage(frame.image, m_slots[index]);
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_queue.push_back(index);
+		m_submitting = false;
+	}
+	m_queued.notify_all();
+	return true;
+}
+
+size_t VideoRecorder::Backlog() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_queue.size();
+}
+
+void VideoRecorder::OpenVideo(const ImagePtr &first)
+{
+	const unsigned int width = static_cast<unsigned int>(first->GetWidth());
+	const unsigned int height = static_cast<unsigned int>(first->GetHeight());
+
+	m_converted = Image::Create();
+	m_converted->ResetImage(width, height, 0, 0, PixelFormat_Mono8);
+
+	// 需在 Open 之前设置，达到上限时 SpinVideo 自动切换到新文件
+	m_video.SetMaximumFileSize(m_config.maxFileSizeMB);
+	switch (m_config.codec)
+	{
+	case VIDEO_H264:
+	{
+		Video::H264Option option;
+		option.frameRate = m_frameRate;
+		option.bitrate = m_config.h264Bitrate;
+		option.width = width;
+		option.height = height;
+		m_video.Open(m_basePath.c_str(), option);
+		break;
+	}
+	case VIDEO_AVI:
+	{
+		Video::AVIOption option;
+		option.frameRate = m_frameRate;
+		option.width = width;
+		option.height = height;
+		m_video.Open(m_basePath.c_str(), option);
+		break;
+	}
+	default:
+	{
+		Video::MJPGOption option;
+		option.frameRate = m_frameRate;
+		option.quality = m_config.mjpgQuality;
+		option.width = width;
+		option.height = height;
+		m_video.Open(m_basePath.c_str(), option);
+		break;
+	}
+	}
+	m_videoOpen = true;
+}
+
+void VideoRecorder::EncoderLoop()
+{
+	while (true)
+	{
+		size_t index;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_queued.wait(lock, [this] { return !m_queue.empty() || (m_stopping && !m_submitting); });
+
+			// 停止时先把队列编码完
+			if (m_queue.empty())
+			{
+				break;
+			}
+			index = m_queue.front();
+			m_queue.pop_front();
+		}
+
+		const ImagePtr &image = m_slots[index];
+		if (!Failed())
+		{
+			try
+			{
+				const auto start = std::chrono::steady_clock::now();
+				if (!m_videoOpen)
+				{
+					OpenVideo(image);
+				}
+				if (image->GetPixelFormat() == PixelFormat_Mono8)
+				{
+					m_video.Append(image);
+				}
+				else
+				{
+					m_processor.Convert(image, m_converted, PixelFormat_Mono8);
+					m_video.Append(m_converted);
+				}
+				m_encodeUs +=
+					std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+				m_encoded++;
+			}
+			catch (Spinnaker::Exception &e)
+			{
+				cout << "Error: " << e.what() << endl;
+				m_failed = true;
+				m_recording.store(false, std::memory_order_release);
+			}
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_free.push_back(index);
+		}
+	}
+
+	if (m_videoOpen)
+	{
+		try
+		{
+			m_video.Close();
+		}
+		catch (Spinnaker::Exception &e)
+		{
+			cout << "Error: " << e.what() << endl;
+			m_failed = true;
+		}
+		m_videoOpen = false;
+	}
+	m_converted = nullptr;
+}
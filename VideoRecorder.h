@@ -0,0 +1,98 @@
+﻿#pragma once
+
+#include "Spinnaker.h"
+#include "SpinVideo.h"
+#include "FrameRing.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum VideoCodec
+{
+	VIDEO_MJPG, // Motion JPEG（.avi），编码快
+	VIDEO_H264, // H.264（.mp4），文件最小，编码最慢
+	VIDEO_AVI	// 无压缩 AVI，几乎不占 CPU，但文件很大
+};
+
+// 编码跟不上、队列已满时的处理方式。两者都不会让抓图线程等待编码
+enum VideoQueuePolicy
+{
+	VIDEO_DROP_NEWEST, // 丢弃新到的帧，已排队的帧按顺序编码
+	VIDEO_DROP_OLDEST  // 丢弃队列中最旧的帧，视频尽量跟上当前画面
+};
+
+struct VideoConfig
+{
+	VideoCodec codec = VIDEO_MJPG;
+	float frameRate = 0.0f;			   // 写入文件的帧率，0 表示使用相机的实际帧率
+	unsigned int mjpgQuality = 75;	   // 1-100
+	unsigned int h264Bitrate = 10000000; // bit/s
+	unsigned int maxFileSizeMB = 2048; // 超过后自动切换到新文件（SpinVideo 在文件名后加序号），0 为不限
+	size_t queueCapacity = 16;		   // 排队等待编码的帧数（每帧一份原始数据拷贝）
+	VideoQueuePolicy policy = VIDEO_DROP_NEWEST;
+};
+
+// 连续录像：抓图线程把帧环中的帧复制进有界队列（不做转换、不等待），
+// 专用编码线程转换为 Mono8 后交给 SpinVideo，文件的打开、追加和关闭都在编码线程中完成。
+class VideoRecorder
+{
+public:
+	VideoRecorder() = default;
+	~VideoRecorder();
+
+	VideoRecorder(const VideoRecorder &) = delete;
+	VideoRecorder &operator=(const VideoRecorder &) = delete;
+
+	// basePath 不含扩展名，由 SpinVideo 按编码方式添加。文件在第一帧到达时才打开（需要帧的尺寸）
+	bool Start(const std::string &basePath, const VideoConfig &config, float frameRate);
+	// 编码完队列中剩余的帧后关闭文件
+	void Stop();
+	bool IsRecording() const { return m_recording.load(std::memory_order_acquire); }
+
+	// 仅抓图线程调用：复制一帧入队，队列满时按策略丢帧，永不阻塞等待编码
+	bool Submit(const Frame &frame);
+
+	const std::string &BasePath() const { return m_basePath; }
+	uint64_t Encoded() const { return m_encoded.load(std::memory_order_relaxed); }
+	uint64_t Dropped() const { return m_dropped.load(std::memory_order_relaxed); }
+	size_t Backlog() const;
+	// 编码出错后不再接收新帧
+	bool Failed() const { return m_failed.load(std::memory_order_relaxed); }
+
+private:
+	void EncoderLoop();
+	void OpenVideo(const Spinnaker::ImagePtr &first);
+
+	VideoConfig m_config;
+	float m_frameRate = 0.0f;
+	std::string m_basePath;
+	std::atomic<bool> m_recording{false};
+	std::atomic<bool> m_failed{false};
+
+	// 帧槽在第一帧到达时按帧大小分配，之后循环使用
+	std::vector<Spinnaker::ImagePtr> m_slots;
+	mutable std::mutex m_mutex;
+	std::condition_variable m_queued;
+	std::vector<size_t> m_free;
+	std::deque<size_t> m_queue;
+	bool m_stopping = false;
+	bool m_submitting = false; // 抓图线程正在锁外复制，编码线程退出前要等它入队
+	std::thread m_encoder;
+
+	// 仅编码线程访问
+	Spinnaker::Video::SpinVideo m_video;
+	bool m_videoOpen = false;
+	Spinnaker::ImageProcessor m_processor;
+	Spinnaker::ImagePtr m_converted;
+	std::chrono::steady_clock::time_point m_startTime;
+	int64_t m_encodeUs = 0;
+
+	std::atomic<uint64_t> m_encoded{0};
+	std::atomic<uint64_t> m_dropped{0};
+};